@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Generates the benchmark clips from FFmpeg's testsrc2 pattern.
+
+Every resolution is encoded as H.264 (long GOP), VP9 and ProRes 422 (intra)
+so inter and intra decoding are both covered. Needs an ffmpeg binary built
+with libx264, libvpx and prores_ks. HAP clips for the compressed passthrough
+are opt-in (they are large, and need an ffmpeg built with libsnappy):
+
+    python3 benchmark/generate_clips.py [--output benchmark/clips] [--seconds 10]
+    python3 benchmark/generate_clips.py --codecs hap,hap_alpha,hap_q
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+RESOLUTIONS = {
+    "720p": "1280x720",
+    "1080p": "1920x1080",
+    "4k": "3840x2160",
+}
+
+CODECS = {
+    "h264": ("mp4", ["-c:v", "libx264", "-preset", "medium", "-g", "60", "-pix_fmt", "yuv420p"]),
+    "vp9": ("webm", ["-c:v", "libvpx-vp9", "-b:v", "0", "-crf", "32", "-row-mt", "1", "-g", "60", "-pix_fmt", "yuv420p"]),
+    "prores": ("mov", ["-c:v", "prores_ks", "-profile:v", "2", "-pix_fmt", "yuv422p10le"]),
+    "hap": ("mov", ["-c:v", "hap", "-format", "hap"]),
+    "hap_alpha": ("mov", ["-vf", "format=rgba", "-c:v", "hap", "-format", "hap_alpha"]),
+    "hap_q": ("mov", ["-c:v", "hap", "-format", "hap_q", "-chunks", "4"]),
+}
+
+DEFAULT_CODECS = "h264,vp9,prores"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--output", default=os.path.join(os.path.dirname(__file__), "clips"))
+    parser.add_argument("--seconds", type=int, default=10)
+    parser.add_argument("--rate", type=int, default=30)
+    parser.add_argument("--ffmpeg", default="ffmpeg")
+    parser.add_argument("--force", action="store_true", help="Re-encode clips that already exist")
+    parser.add_argument("--codecs", default=DEFAULT_CODECS, help="Comma-separated, from: " + ",".join(CODECS))
+    args = parser.parse_args()
+
+    codec_names = [name for name in args.codecs.split(",") if name]
+    unknown = [name for name in codec_names if name not in CODECS]
+    if unknown:
+        print(f"Unknown codecs: {', '.join(unknown)}", file=sys.stderr)
+        return 2
+
+    os.makedirs(args.output, exist_ok=True)
+    failed = False
+    for resolution_name, size in RESOLUTIONS.items():
+        for codec_name in codec_names:
+            extension, codec_args = CODECS[codec_name]
+            path = os.path.join(args.output, f"testsrc2_{resolution_name}_{codec_name}.{extension}")
+            if os.path.exists(path) and not args.force:
+                print(f"= {path}")
+                continue
+
+            command = [
+                args.ffmpeg, "-hide_banner", "-loglevel", "error", "-y",
+                "-f", "lavfi", "-i", f"testsrc2=size={size}:rate={args.rate}:duration={args.seconds}",
+            ] + codec_args + [path]
+            print(f"+ {path}")
+            if subprocess.run(command).returncode != 0:
+                print(f"Failed to encode {path}", file=sys.stderr)
+                failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,635 @@
+// Headless decode benchmark for Lymo FFmpeg.
+//
+// Decodes clips through FFmpegFrameReader with the same threading setup as
+// FFmpegDecoder and converts every frame through FFmpegFrameConverter, the
+// code the extension runs, without needing a Godot instance.
+//
+//   lymo_ffmpeg_benchmark [--frames N] [--threads 0,1,4] [--modes rgb,yuv,compressed]
+//                         [--size 1920,1080] [--kernels auto,sws,sse4.1,avx2,neon]
+//                         [--verify] [--tolerance 1.0] [--filter yadif] [--json results.json] clip...
+//
+// Clips are made by generate_clips.py. Results are printed as a table and
+// written as JSON for comparison between releases. --kernels picks the RGB
+// conversion path, --verify compares every kernel frame against sws_scale
+// and fails the run when the mean difference exceeds the tolerance. In
+// compressed mode HAP clips are only unwrapped, --verify then decodes the
+// DXT textures on the CPU and compares them against FFmpeg's HAP decoder.
+// --filter runs every decoded frame through the reader's filter stage first,
+// like FFmpegDecoder.video_filter.
+
+#include "decoder/ffmpeg_frame_converter.h"
+#include "decoder/ffmpeg_frame_reader.h"
+#include "decoder/ffmpeg_hap_unpacker.h"
+#include "decoder/ffmpeg_yuv_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libavutil/pixdesc.h>
+}
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using godot::FFmpegFilterGraph;
+using godot::FFmpegFrameConverter;
+using godot::FFmpegFrameReader;
+using godot::FFmpegHapUnpacker;
+using godot::FFmpegYuvKernels;
+
+struct BenchmarkOptions {
+    int max_frames = 0; // 0 = whole clip
+    std::vector<int> thread_counts = { 0, 1 };
+    std::vector<std::string> modes = { "rgb", "yuv" };
+    std::vector<std::string> kernels = { "auto" }; // RGB mode only
+    bool verify = false;
+    double tolerance = 1.0; // Mean absolute difference per channel
+    int output_width = 0; // 0 = decoded size
+    int output_height = 0;
+    std::string filter; // libavfilter graph, empty = none
+    std::string json_path;
+    std::vector<std::string> clips;
+};
+
+struct BenchmarkResult {
+    std::string clip;
+    std::string codec;
+    std::string pixel_format;
+    int width = 0;
+    int height = 0;
+    int output_width = 0;
+    int output_height = 0;
+    std::string mode;
+    std::string kernel; // What converted the frames: sws, an instruction set or hap
+    std::string filter;
+    int threads = 0;
+    int effective_threads = 0;
+    int64_t frames = 0;
+    double seconds = 0.0;
+    double fps = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    double allocations_per_frame = 0.0;
+    int64_t peak_rss_kib = 0;
+    bool verified = false;
+    int max_difference = 0;
+    double mean_difference = 0.0;
+    bool ok = false;
+};
+
+static int64_t get_peak_rss_kib() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (int64_t)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (int64_t)usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return (int64_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static double percentile(std::vector<double> samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+static std::vector<int> parse_int_list(const char *text) {
+    std::vector<int> values;
+    std::string item;
+    for (const char *c = text;; c++) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty()) {
+                values.push_back(atoi(item.c_str()));
+            }
+            item.clear();
+            if (*c == '\0') {
+                break;
+            }
+        } else {
+            item += *c;
+        }
+    }
+    return values;
+}
+
+static std::vector<std::string> parse_string_list(const char *text) {
+    std::vector<std::string> values;
+    std::string item;
+    for (const char *c = text;; c++) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty()) {
+                values.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0') {
+                break;
+            }
+        } else {
+            item += *c;
+        }
+    }
+    return values;
+}
+
+// The buffers stand in for the decoder's pooled images
+static bool unpack_hap_frame(FFmpegHapUnpacker &unpacker, const AVPacket *packet, int width, int height,
+                             std::vector<uint8_t> *buffers, uint64_t &r_allocations) {
+    if (!unpacker.parse_frame(packet->data, packet->size, width, height)) {
+        return false;
+    }
+    for (int i = 0; i < unpacker.get_texture_count(); i++) {
+        size_t size = unpacker.get_texture(i).unpacked_size;
+        if (buffers[i].size() != size) {
+            buffers[i].resize(size);
+            r_allocations++;
+        }
+        if (!unpacker.unpack(i, buffers[i].data(), size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// BC1 colour block, the three-colour mode only exists in DXT1 itself
+static void decode_color_block(const uint8_t *block, bool dxt1, uint8_t r_pixels[16][4]) {
+    int colors[2] = { block[0] | (block[1] << 8), block[2] | (block[3] << 8) };
+    int palette[4][4];
+    for (int i = 0; i < 2; i++) {
+        int r = colors[i] >> 11, g = (colors[i] >> 5) & 63, b = colors[i] & 31;
+        palette[i][0] = (r << 3) | (r >> 2);
+        palette[i][1] = (g << 2) | (g >> 4);
+        palette[i][2] = (b << 3) | (b >> 2);
+        palette[i][3] = 255;
+    }
+    bool three_colors = dxt1 && colors[0] <= colors[1];
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = three_colors ? (palette[0][c] + palette[1][c]) / 2 : (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = three_colors ? 0 : (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    palette[2][3] = 255;
+    palette[3][3] = three_colors ? 0 : 255;
+    
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            r_pixels[i][c] = (uint8_t)palette[(indices >> (2 * i)) & 3][c];
+        }
+    }
+}
+
+// BC3 alpha / BC4 block: two endpoints and 3-bit indices
+static void decode_alpha_block(const uint8_t *block, uint8_t r_values[16]) {
+    int a0 = block[0], a1 = block[1];
+    int palette[8] = { a0, a1 };
+    for (int i = 2; i < 8; i++) {
+        if (a0 > a1) {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        } else {
+            palette[i] = i < 6 ? ((6 - i) * a0 + (i - 1) * a1) / 5 : (i == 6 ? 0 : 255);
+        }
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; i++) {
+        r_values[i] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+// CPU decode of unpacked HAP textures for --verify, false for BC7 (HAP R)
+static bool decode_hap_textures(const FFmpegHapUnpacker &unpacker, const std::vector<uint8_t> *buffers,
+                                int width, int height, std::vector<uint8_t> &r_rgba) {
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+    r_rgba.resize((size_t)width * height * 4);
+    for (int t = 0; t < unpacker.get_texture_count(); t++) {
+        FFmpegHapUnpacker::TextureFormat format = unpacker.get_texture(t).format;
+        if (format == FFmpegHapUnpacker::TEXTURE_BPTC) {
+            return false;
+        }
+        size_t block_size = (format == FFmpegHapUnpacker::TEXTURE_DXT1 || format == FFmpegHapUnpacker::TEXTURE_RGTC1) ? 8 : 16;
+        
+        for (int by = 0; by < blocks_y; by++) {
+            for (int bx = 0; bx < blocks_x; bx++) {
+                const uint8_t *block = buffers[t].data() + ((size_t)by * blocks_x + bx) * block_size;
+                uint8_t pixels[16][4];
+                uint8_t alpha[16];
+                bool alpha_only = format == FFmpegHapUnpacker::TEXTURE_RGTC1;
+                if (format == FFmpegHapUnpacker::TEXTURE_DXT1) {
+                    decode_color_block(block, true, pixels);
+                } else if (alpha_only) {
+                    decode_alpha_block(block, alpha);
+                } else {
+                    decode_alpha_block(block, alpha);
+                    decode_color_block(block + 8, false, pixels);
+                    for (int i = 0; i < 16; i++) {
+                        pixels[i][3] = alpha[i];
+                    }
+                }
+                
+                // Scaled YCoCg, the same integer maths as FFmpeg's HAP Q decoder
+                if (format == FFmpegHapUnpacker::TEXTURE_YCOCG_DXT5) {
+                    for (int i = 0; i < 16; i++) {
+                        int scale = (pixels[i][2] >> 3) + 1;
+                        int y = pixels[i][3];
+                        int co = (pixels[i][0] - 128) / scale;
+                        int cg = (pixels[i][1] - 128) / scale;
+                        pixels[i][0] = (uint8_t)std::max(0, std::min(255, y + co - cg));
+                        pixels[i][1] = (uint8_t)std::max(0, std::min(255, y + cg));
+                        pixels[i][2] = (uint8_t)std::max(0, std::min(255, y - co - cg));
+                        pixels[i][3] = 255;
+                    }
+                }
+                
+                for (int i = 0; i < 16; i++) {
+                    int x = bx * 4 + (i & 3);
+                    int y = by * 4 + (i >> 2);
+                    if (x >= width || y >= height) {
+                        continue;
+                    }
+                    uint8_t *dst = r_rgba.data() + ((size_t)y * width + x) * 4;
+                    if (alpha_only) {
+                        dst[3] = alpha[i];
+                    } else {
+                        memcpy(dst, pixels[i], 4);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool select_kernel(const std::string &kernel) {
+    static const FFmpegYuvKernels::Isa isas[] = {
+        FFmpegYuvKernels::ISA_NONE, FFmpegYuvKernels::ISA_SSE41, FFmpegYuvKernels::ISA_AVX2, FFmpegYuvKernels::ISA_NEON,
+    };
+    if (kernel == "auto") {
+        FFmpegYuvKernels::set_isa(FFmpegYuvKernels::get_default_isa());
+        return true;
+    }
+    for (FFmpegYuvKernels::Isa isa : isas) {
+        if (kernel == (isa == FFmpegYuvKernels::ISA_NONE ? "sws" : FFmpegYuvKernels::get_isa_name(isa))) {
+            FFmpegYuvKernels::set_isa(isa);
+            return FFmpegYuvKernels::get_isa() == isa;
+        }
+    }
+    return false;
+}
+
+// Largest and summed per-channel difference between two RGBA images
+static void compare_rgba(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b,
+                         int &r_max_difference, double &r_difference_sum) {
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        int difference = std::abs((int)a[i] - (int)b[i]);
+        r_max_difference = std::max(r_max_difference, difference);
+        r_difference_sum += difference;
+    }
+}
+
+static BenchmarkResult run_benchmark(const std::string &clip, const std::string &mode, int threads,
+                                     const BenchmarkOptions &options) {
+    int max_frames = options.max_frames;
+    BenchmarkResult result;
+    result.clip = clip;
+    result.mode = mode;
+    result.threads = threads;
+    
+    AVFormatContext *format_context = nullptr;
+    if (avformat_open_input(&format_context, clip.c_str(), nullptr, nullptr) < 0) {
+        fprintf(stderr, "Could not open %s\n", clip.c_str());
+        return result;
+    }
+    
+    const AVCodec *codec = nullptr;
+    int stream_index = -1;
+    AVCodecContext *codec_context = nullptr;
+    if (avformat_find_stream_info(format_context, nullptr) >= 0) {
+        stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    }
+    if (stream_index >= 0) {
+        codec_context = avcodec_alloc_context3(codec);
+    }
+    if (!codec_context || avcodec_parameters_to_context(codec_context, format_context->streams[stream_index]->codecpar) < 0) {
+        fprintf(stderr, "No decodable video stream in %s\n", clip.c_str());
+        avcodec_free_context(&codec_context);
+        avformat_close_input(&format_context);
+        return result;
+    }
+    
+    // Mirrors FFmpegDecoder::is_compressed_passthrough(), other clips are converted to RGB
+    bool compressed = mode == "compressed" && codec->id == AV_CODEC_ID_HAP &&
+                      options.output_width <= 0 && options.output_height <= 0;
+    
+    // Same mapping as FFmpegDecoder::configure_threading() with THREAD_TYPE_AUTO. HAP
+    // passthrough only decodes for --verify, which needs each packet's frame at once.
+    int hardware_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    codec_context->thread_count = threads > 0 ? threads : std::min(hardware_threads, 16);
+    codec_context->thread_type = compressed ? FF_THREAD_SLICE : FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (avcodec_open2(codec_context, codec, nullptr) < 0) {
+        fprintf(stderr, "Could not open codec for %s\n", clip.c_str());
+        avcodec_free_context(&codec_context);
+        avformat_close_input(&format_context);
+        return result;
+    }
+    
+    result.codec = codec->name;
+    result.width = codec_context->width;
+    result.height = codec_context->height;
+    result.effective_threads = codec_context->thread_count;
+    const char *format_name = av_get_pix_fmt_name(codec_context->pix_fmt);
+    result.pixel_format = format_name ? format_name : "unknown";
+    
+    FFmpegFrameReader reader;
+    reader.attach(format_context, codec_context, stream_index);
+    reader.set_filter(compressed ? std::string() : options.filter);
+    const FFmpegFilterGraph &filter_graph = reader.get_filter_graph();
+    AVFrame *reference_frame = av_frame_alloc();
+    FFmpegFrameConverter converter;
+    bool rgb = mode == "rgb" || (mode == "compressed" && !compressed);
+    bool kernel_used = rgb && FFmpegYuvKernels::get_isa() != FFmpegYuvKernels::ISA_NONE &&
+                       FFmpegYuvKernels::is_supported(codec_context->pix_fmt) &&
+                       (options.output_width <= 0 || options.output_width == codec_context->width) &&
+                       (options.output_height <= 0 || options.output_height == codec_context->height);
+    result.filter = filter_graph.get_description();
+    result.kernel = compressed ? "hap" : (kernel_used ? FFmpegYuvKernels::get_isa_name(FFmpegYuvKernels::get_isa()) : "sws");
+    FFmpegHapUnpacker unpacker;
+    std::vector<uint8_t> hap_rgba;
+    
+    // sws_scale reference for --verify, outside the timed part of each frame
+    FFmpegFrameConverter reference_converter;
+    reference_converter.set_use_kernels(false);
+    std::vector<uint8_t> reference_buffer;
+    // A filter can change the format the converter sees, so its frames are always verified
+    bool verify = options.verify && (kernel_used || compressed || filter_graph.is_enabled());
+    double difference_sum = 0.0;
+    uint64_t compared_values = 0;
+    
+    // Output buffers are reused like the decoder's image pool, a resize counts as an allocation
+    std::vector<uint8_t> buffers[FFmpegFrameConverter::MAX_PLANES];
+    uint64_t buffer_allocations = 0;
+    std::vector<double> latencies;
+    
+    auto start = std::chrono::steady_clock::now();
+    while (max_frames <= 0 || (int)latencies.size() < max_frames) {
+        auto frame_start = std::chrono::steady_clock::now();
+        if (compressed) {
+            AVPacket *packet = reader.read_packet();
+            if (!packet || !unpack_hap_frame(unpacker, packet, codec_context->width, codec_context->height, buffers, buffer_allocations)) {
+                break;
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frame_start;
+            latencies.push_back(elapsed.count());
+            result.output_width = codec_context->width;
+            result.output_height = codec_context->height;
+            
+            if (verify) {
+                auto verify_start = std::chrono::steady_clock::now();
+                if (decode_hap_textures(unpacker, buffers, codec_context->width, codec_context->height, hap_rgba) &&
+                    avcodec_send_packet(codec_context, packet) >= 0 && avcodec_receive_frame(codec_context, reference_frame) >= 0) {
+                    reference_buffer.resize(hap_rgba.size());
+                    if (reference_converter.convert_to_rgba(reference_frame, reference_frame->width, reference_frame->height, SWS_BILINEAR,
+                                                            0, 0, reference_buffer.data(), reference_frame->width * 4)) {
+                        compare_rgba(hap_rgba, reference_buffer, result.max_difference, difference_sum);
+                        compared_values += hap_rgba.size();
+                    }
+                }
+                start += std::chrono::steady_clock::now() - verify_start;
+            }
+            continue;
+        }
+        AVFrame *source_frame = reader.read_frame();
+        if (reader.has_filter_failed()) {
+            fprintf(stderr, "Could not apply filter \"%s\"\n", filter_graph.get_description().c_str());
+            break;
+        }
+        if (!source_frame) {
+            break;
+        }
+        
+        int color_range = 0;
+        int color_space = 0;
+        FFmpegFrameConverter::detect_color_properties(source_frame, -1, -1, color_range, color_space);
+        int dst_width = options.output_width > 0 ? options.output_width : source_frame->width;
+        int dst_height = options.output_height > 0 ? options.output_height : source_frame->height;
+        result.output_width = dst_width;
+        result.output_height = dst_height;
+        
+        if (rgb) {
+            size_t size = (size_t)dst_width * dst_height * 4;
+            if (buffers[0].size() != size) {
+                buffers[0].resize(size);
+                buffer_allocations++;
+            }
+            if (!converter.convert_to_rgba(source_frame, dst_width, dst_height, SWS_BILINEAR, color_range, color_space,
+                                           buffers[0].data(), dst_width * 4)) {
+                break;
+            }
+        } else {
+            FFmpegFrameConverter::PlaneLayout layout;
+            const AVFrame *planar_frame = converter.prepare_planes(source_frame, dst_width, dst_height, SWS_BILINEAR, layout);
+            if (!planar_frame) {
+                break;
+            }
+            for (int i = 0; i < layout.count; i++) {
+                size_t size = (size_t)layout.width[i] * layout.height[i] * layout.channels[i];
+                if (buffers[i].size() != size) {
+                    buffers[i].resize(size);
+                    buffer_allocations++;
+                }
+                FFmpegFrameConverter::copy_plane(planar_frame, layout, i, buffers[i].data());
+            }
+        }
+        
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frame_start;
+        latencies.push_back(elapsed.count());
+        
+        if (verify) {
+            auto verify_start = std::chrono::steady_clock::now();
+            reference_buffer.resize(buffers[0].size());
+            if (reference_converter.convert_to_rgba(source_frame, dst_width, dst_height, SWS_BILINEAR, color_range, color_space,
+                                                    reference_buffer.data(), dst_width * 4)) {
+                compare_rgba(buffers[0], reference_buffer, result.max_difference, difference_sum);
+                compared_values += buffers[0].size();
+            }
+            start += std::chrono::steady_clock::now() - verify_start;
+        }
+    }
+    std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+    
+    result.frames = (int64_t)latencies.size();
+    result.seconds = total.count();
+    result.fps = result.seconds > 0 ? result.frames / result.seconds : 0.0;
+    result.p50_ms = percentile(latencies, 0.50);
+    result.p95_ms = percentile(latencies, 0.95);
+    result.p99_ms = percentile(latencies, 0.99);
+    result.max_ms = percentile(latencies, 1.0);
+    result.allocations_per_frame = result.frames > 0 ? (double)(converter.get_allocation_count() + buffer_allocations) / result.frames : 0.0;
+    result.peak_rss_kib = get_peak_rss_kib();
+    result.verified = verify && compared_values > 0;
+    result.mean_difference = compared_values > 0 ? difference_sum / compared_values : 0.0;
+    result.ok = result.frames > 0 && (!result.verified || result.mean_difference <= options.tolerance);
+    
+    reader.attach(nullptr, nullptr, -1);
+    av_frame_free(&reference_frame);
+    avcodec_free_context(&codec_context);
+    avformat_close_input(&format_context);
+    return result;
+}
+
+static std::string json_escape(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static void write_json(FILE *file, const std::vector<BenchmarkResult> &results) {
+    fprintf(file, "{\n  \"version\": 1,\n  \"libavcodec\": \"%s\",\n  \"results\": [\n", LIBAVCODEC_IDENT);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &r = results[i];
+        fprintf(file,
+                "    {\"clip\": \"%s\", \"codec\": \"%s\", \"pixel_format\": \"%s\", \"width\": %d, \"height\": %d, "
+                "\"output_width\": %d, \"output_height\": %d, "
+                "\"mode\": \"%s\", \"kernel\": \"%s\", \"filter\": \"%s\", \"threads\": %d, \"effective_threads\": %d, \"ok\": %s, \"frames\": %lld, "
+                "\"seconds\": %.4f, \"fps\": %.2f, \"latency_ms\": {\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+                "\"allocations_per_frame\": %.4f, \"peak_rss_kib\": %lld",
+                json_escape(r.clip).c_str(), r.codec.c_str(), r.pixel_format.c_str(), r.width, r.height,
+                r.output_width, r.output_height,
+                r.mode.c_str(), r.kernel.c_str(), json_escape(r.filter).c_str(), r.threads, r.effective_threads, r.ok ? "true" : "false", (long long)r.frames,
+                r.seconds, r.fps, r.p50_ms, r.p95_ms, r.p99_ms, r.max_ms,
+                r.allocations_per_frame, (long long)r.peak_rss_kib);
+        if (r.verified) {
+            fprintf(file, ", \"verify\": {\"max_difference\": %d, \"mean_difference\": %.4f}",
+                    r.max_difference, r.mean_difference);
+        }
+        fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+static void print_usage() {
+    fprintf(stderr, "Usage: lymo_ffmpeg_benchmark [--frames N] [--threads 0,1,4] [--modes rgb,yuv,compressed] [--size W,H]\n"
+                    "                             [--kernels auto,sws,sse4.1,avx2,neon] [--verify] [--tolerance T]\n"
+                    "                             [--filter GRAPH] [--json FILE] clip...\n");
+}
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--frames") == 0 && has_value) {
+            options.max_frames = atoi(argv[++i]);
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            options.thread_counts = parse_int_list(argv[++i]);
+        } else if (strcmp(arg, "--modes") == 0 && has_value) {
+            options.modes = parse_string_list(argv[++i]);
+        } else if (strcmp(arg, "--size") == 0 && has_value) {
+            std::vector<int> size = parse_int_list(argv[++i]);
+            options.output_width = size.size() > 0 ? size[0] : 0;
+            options.output_height = size.size() > 1 ? size[1] : 0;
+        } else if (strcmp(arg, "--kernels") == 0 && has_value) {
+            options.kernels = parse_string_list(argv[++i]);
+        } else if (strcmp(arg, "--verify") == 0) {
+            options.verify = true;
+        } else if (strcmp(arg, "--tolerance") == 0 && has_value) {
+            options.tolerance = atof(argv[++i]);
+        } else if (strcmp(arg, "--filter") == 0 && has_value) {
+            options.filter = argv[++i];
+        } else if (strcmp(arg, "--json") == 0 && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg[0] == '-') {
+            print_usage();
+            return 2;
+        } else {
+            options.clips.push_back(arg);
+        }
+    }
+    if (options.clips.empty()) {
+        print_usage();
+        return 2;
+    }
+    
+    av_log_set_level(AV_LOG_ERROR);
+    
+    std::vector<BenchmarkResult> results;
+    bool all_ok = true;
+    fprintf(stderr, "%-28s %-10s %-5s %-6s %3s %8s %8s %8s %8s %10s %10s %s\n",
+            "clip", "codec", "mode", "kernel", "thr", "fps", "p50 ms", "p99 ms", "max ms", "alloc/frm", "rss KiB",
+            options.verify ? "diff max/mean" : "");
+    for (const std::string &clip : options.clips) {
+        for (const std::string &mode : options.modes) {
+            // The kernel choice only matters for RGB output
+            std::vector<std::string> kernels = mode == "rgb" ? options.kernels : std::vector<std::string>{ "auto" };
+            for (const std::string &kernel : kernels) {
+                if (!select_kernel(kernel)) {
+                    fprintf(stderr, "Kernel %s is not available on this CPU, skipped\n", kernel.c_str());
+                    continue;
+                }
+                for (int threads : options.thread_counts) {
+                    BenchmarkResult r = run_benchmark(clip, mode, threads, options);
+                    all_ok = all_ok && r.ok;
+                    std::string name = clip.substr(clip.find_last_of("/\\") + 1);
+                    std::string difference;
+                    if (r.verified) {
+                        char text[32];
+                        snprintf(text, sizeof(text), "%d/%.3f", r.max_difference, r.mean_difference);
+                        difference = text;
+                    }
+                    fprintf(stderr, "%-28s %-10s %-5s %-6s %3d %8.1f %8.2f %8.2f %8.2f %10.3f %10lld %s\n",
+                            name.c_str(), r.codec.c_str(), mode.c_str(), r.kernel.c_str(), r.effective_threads, r.fps,
+                            r.p50_ms, r.p99_ms, r.max_ms, r.allocations_per_frame, (long long)r.peak_rss_kib,
+                            difference.c_str());
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+    FFmpegYuvKernels::shutdown();
+    
+    FILE *json_file = options.json_path.empty() ? stdout : fopen(options.json_path.c_str(), "w");
+    if (!json_file) {
+        fprintf(stderr, "Could not write %s\n", options.json_path.c_str());
+        return 1;
+    }
+    write_json(json_file, results);
+    if (json_file != stdout) {
+        fclose(json_file);
+    }
+    
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+// Scalar against SIMD check of the YUV to RGBA kernels.
+//
+// Converts random frames of every supported format with each kernel the CPU
+// has and compares the result against the scalar reference rows, which use
+// the same fixed-point rounding, so any difference is a kernel bug. Odd widths
+// and heights exercise the scalar tails and the row band split. Then times
+// the scalar rows and each kernel on a 1920x1080 frame.
+//
+//   lymo_yuv_kernels_test [--frames N]
+//
+// Needs the FFmpeg headers only, no FFmpeg libraries and no Godot. Exits
+// non-zero on the first mismatch.
+
+#include "decoder/ffmpeg_yuv_kernels.h"
+#include "decoder/ffmpeg_yuv_kernels_rows.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using godot::FFmpegYuvKernels;
+using namespace godot::yuv_kernels;
+
+struct TestFrame {
+    AVPixelFormat format;
+    int width;
+    int height;
+    std::vector<uint8_t> planes[4];
+    int linesize[4] = {};
+    const uint8_t *data[4] = {};
+};
+
+// Without libavutil's pixdesc, so only the headers are needed
+static const char *format_name(AVPixelFormat format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+            return "yuv420p";
+        case AV_PIX_FMT_YUVJ420P:
+            return "yuvj420p";
+        case AV_PIX_FMT_YUV422P:
+            return "yuv422p";
+        case AV_PIX_FMT_YUVJ422P:
+            return "yuvj422p";
+        case AV_PIX_FMT_YUVA420P:
+            return "yuva420p";
+        case AV_PIX_FMT_NV12:
+            return "nv12";
+        case AV_PIX_FMT_P010LE:
+            return "p010le";
+        default:
+            return "?";
+    }
+}
+
+static bool is_semi_planar(AVPixelFormat format) {
+    return format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_P010LE;
+}
+
+// Random samples, with padded line sizes like decoder output
+static void make_frame(TestFrame &frame, AVPixelFormat format, int width, int height, std::mt19937 &random) {
+    frame.format = format;
+    frame.width = width;
+    frame.height = height;
+    
+    bool ten_bit = format == AV_PIX_FMT_P010LE;
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (format == AV_PIX_FMT_YUV422P || format == AV_PIX_FMT_YUVJ422P) ? height : (height + 1) / 2;
+    int sample_size = ten_bit ? 2 : 1;
+    int line_bytes[4] = { width * sample_size, chroma_width * sample_size, chroma_width, width };
+    int rows[4] = { height, chroma_height, chroma_height, height };
+    int plane_count = 3;
+    if (is_semi_planar(format)) {
+        line_bytes[1] = chroma_width * 2 * sample_size;
+        plane_count = 2;
+    } else if (format == AV_PIX_FMT_YUVA420P) {
+        plane_count = 4;
+    }
+    
+    for (int i = 0; i < 4; i++) {
+        frame.planes[i].clear();
+        frame.linesize[i] = 0;
+        frame.data[i] = nullptr;
+        if (i >= plane_count) {
+            continue;
+        }
+        frame.linesize[i] = (line_bytes[i] + 32 + 63) & ~63;
+        frame.planes[i].resize((size_t)frame.linesize[i] * rows[i]);
+        for (uint8_t &byte : frame.planes[i]) {
+            byte = (uint8_t)random();
+        }
+        frame.data[i] = frame.planes[i].data();
+    }
+}
+
+static uint8_t narrow_p010(const uint8_t *line, int index) {
+    uint16_t sample;
+    memcpy(&sample, line + index * 2, 2);
+    return (uint8_t)std::min((sample + 128) >> 8, 255);
+}
+
+// One pixel at a time through convert_pixel(), the definition the kernels follow
+static void convert_reference(const TestFrame &frame, int color_range, int color_space, std::vector<uint8_t> &dst) {
+    Coefficients c = FFmpegYuvKernels::make_coefficients(color_range, color_space);
+    bool ten_bit = frame.format == AV_PIX_FMT_P010LE;
+    int chroma_shift = (frame.format == AV_PIX_FMT_YUV422P || frame.format == AV_PIX_FMT_YUVJ422P) ? 0 : 1;
+    dst.resize((size_t)frame.width * frame.height * 4);
+    
+    for (int row = 0; row < frame.height; row++) {
+        const uint8_t *y = frame.data[0] + (size_t)row * frame.linesize[0];
+        const uint8_t *u = frame.data[1] + (size_t)(row >> chroma_shift) * frame.linesize[1];
+        const uint8_t *v = frame.data[2] ? frame.data[2] + (size_t)(row >> chroma_shift) * frame.linesize[2] : nullptr;
+        const uint8_t *a = frame.data[3] ? frame.data[3] + (size_t)row * frame.linesize[3] : nullptr;
+        for (int x = 0; x < frame.width; x++) {
+            int luma, cb, cr;
+            if (ten_bit) {
+                luma = narrow_p010(y, x);
+                cb = narrow_p010(u, (x >> 1) * 2);
+                cr = narrow_p010(u, (x >> 1) * 2 + 1);
+            } else if (is_semi_planar(frame.format)) {
+                luma = y[x];
+                cb = u[(x >> 1) * 2];
+                cr = u[(x >> 1) * 2 + 1];
+            } else {
+                luma = y[x];
+                cb = u[x >> 1];
+                cr = v[x >> 1];
+            }
+            convert_pixel(luma, cb, cr, a ? a[x] : 255, dst.data() + ((size_t)row * frame.width + x) * 4, c);
+        }
+    }
+}
+
+static bool check_frame(const TestFrame &frame, FFmpegYuvKernels::Isa isa, int color_range, int color_space) {
+    std::vector<uint8_t> expected;
+    convert_reference(frame, color_range, color_space, expected);
+    
+    std::vector<uint8_t> actual((size_t)frame.width * frame.height * 4, 0);
+    if (!FFmpegYuvKernels::convert(frame.data, frame.linesize, frame.format, frame.width, frame.height,
+                                   color_range, color_space, actual.data(), frame.width * 4)) {
+        printf("FAIL %s %s %dx%d: not converted\n", FFmpegYuvKernels::get_isa_name(isa),
+               format_name(frame.format), frame.width, frame.height);
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (actual[i] != expected[i]) {
+            size_t pixel = i / 4;
+            printf("FAIL %s %s %dx%d range %d space %d: pixel (%d, %d) channel %d is %d, expected %d\n",
+                   FFmpegYuvKernels::get_isa_name(isa), format_name(frame.format), frame.width,
+                   frame.height, color_range, color_space, (int)(pixel % frame.width), (int)(pixel / frame.width),
+                   (int)(i % 4), actual[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Mpix/s of the scalar rows on one thread, the baseline of the kernels
+static double time_scalar(const TestFrame &frame, int frames) {
+    Coefficients c = FFmpegYuvKernels::make_coefficients(0, 1);
+    std::vector<uint8_t> dst((size_t)frame.width * frame.height * 4);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        for (int row = 0; row < frame.height; row++) {
+            const uint8_t *y = frame.data[0] + (size_t)row * frame.linesize[0];
+            const uint8_t *u = frame.data[1] + (size_t)(row >> 1) * frame.linesize[1];
+            uint8_t *out = dst.data() + (size_t)row * frame.width * 4;
+            if (is_semi_planar(frame.format)) {
+                semi_planar_row_c(y, u, out, 0, frame.width, c);
+            } else {
+                planar_row_c(y, u, frame.data[2] + (size_t)(row >> 1) * frame.linesize[2], nullptr, out, 0, frame.width, c);
+            }
+        }
+    }
+    return (double)frame.width * frame.height * frames / seconds_since(start) / 1e6;
+}
+
+static double time_kernel(const TestFrame &frame, int frames) {
+    std::vector<uint8_t> dst((size_t)frame.width * frame.height * 4);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        FFmpegYuvKernels::convert(frame.data, frame.linesize, frame.format, frame.width, frame.height, 0, 1,
+                                  dst.data(), frame.width * 4);
+    }
+    return (double)frame.width * frame.height * frames / seconds_since(start) / 1e6;
+}
+
+int main(int argc, char **argv) {
+    int timed_frames = 60;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            timed_frames = std::max(1, atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "Usage: lymo_yuv_kernels_test [--frames N]\n");
+            return 2;
+        }
+    }
+    
+    static const FFmpegYuvKernels::Isa all_isas[] = {
+        FFmpegYuvKernels::ISA_SSE41, FFmpegYuvKernels::ISA_AVX2, FFmpegYuvKernels::ISA_NEON,
+    };
+    std::vector<FFmpegYuvKernels::Isa> isas;
+    for (FFmpegYuvKernels::Isa isa : all_isas) {
+        FFmpegYuvKernels::set_isa(isa);
+        if (FFmpegYuvKernels::get_isa() == isa) {
+            isas.push_back(isa);
+        }
+    }
+    printf("Detected: %s, default: %s\n", FFmpegYuvKernels::get_isa_name(FFmpegYuvKernels::get_detected_isa()),
+           FFmpegYuvKernels::get_isa_name(FFmpegYuvKernels::get_default_isa()));
+    if (isas.empty()) {
+        printf("No SIMD kernel on this CPU, nothing to compare\n");
+        return 0;
+    }
+    
+    static const AVPixelFormat formats[] = {
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUVA420P, AV_PIX_FMT_NV12, AV_PIX_FMT_P010LE,
+    };
+    // Below, at and around the vector widths, and a banded 1080p frame with odd edges
+    static const int sizes[][2] = {
+        { 1, 1 }, { 2, 2 }, { 7, 3 }, { 15, 5 }, { 16, 4 }, { 17, 9 }, { 31, 2 }, { 32, 6 }, { 33, 7 },
+        { 63, 3 }, { 65, 5 }, { 641, 361 }, { 1921, 1081 },
+    };
+    
+    std::mt19937 random(1234);
+    TestFrame frame;
+    int checks = 0;
+    for (FFmpegYuvKernels::Isa isa : isas) {
+        FFmpegYuvKernels::set_isa(isa);
+        for (AVPixelFormat format : formats) {
+            for (const int *size : sizes) {
+                make_frame(frame, format, size[0], size[1], random);
+                for (int range = 0; range < 2; range++) {
+                    for (int space = 0; space < 4; space++) {
+                        if (!check_frame(frame, isa, range, space)) {
+                            return 1;
+                        }
+                        checks++;
+                    }
+                }
+            }
+        }
+    }
+    printf("%d conversions match the scalar rows\n", checks);
+    
+    printf("\n%-10s %-8s %10s\n", "format", "kernel", "Mpix/s");
+    for (AVPixelFormat format : { AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12 }) {
+        make_frame(frame, format, 1920, 1080, random);
+        printf("%-10s %-8s %10.1f\n", format_name(format), "scalar", time_scalar(frame, timed_frames));
+        for (FFmpegYuvKernels::Isa isa : isas) {
+            FFmpegYuvKernels::set_isa(isa);
+            FFmpegYuvKernels::set_max_threads(1);
+            printf("%-10s %-8s %10.1f\n", format_name(format), FFmpegYuvKernels::get_isa_name(isa),
+                   time_kernel(frame, timed_frames));
+        }
+    }
+    FFmpegYuvKernels::shutdown();
+    return 0;
+}
@@ -1,27 +1,37 @@
 #include "ffmpeg_decoder.h"
+#include "ffmpeg_frame_cache.h"
+#include "ffmpeg_yuv_kernels.h"
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <thread>
+
 using namespace godot;
 
+std::mutex FFmpegDecoder::thread_budget_mutex;
+int FFmpegDecoder::global_thread_cap = 0;
+int FFmpegDecoder::global_threads_in_use = 0;
+
 // Static callback for hardware format selection
 AVPixelFormat FFmpegDecoder::hw_pix_fmt_callback(AVCodecContext *ctx, const AVPixelFormat *pix_fmts) {
     FFmpegDecoder *decoder = static_cast<FFmpegDecoder*>(ctx->opaque);
     return decoder->get_hw_format(ctx, pix_fmts);
 }
 
-FFmpegDecoder::FFmpegDecoder() {
+FFmpegDecoder::FFmpegDecoder() : reader_stats(this) {
     format_context = nullptr;
     codec_context = nullptr;
     codec = nullptr;
-    frame = nullptr;
     hw_frame = nullptr;
-    packet = nullptr;
-    sws_context = nullptr;
     hw_device_ctx = nullptr;
     
     video_stream_index = -1;
     is_open = false;
+    probe_cached = false;
+    io_buffer_size = 64 * 1024;
+    read_ahead_size = 0;
+    read_ahead_hints = true;
+    read_ahead_io = nullptr;
     use_hardware_acceleration = true;
     hw_device_type = AV_HWDEVICE_TYPE_NONE;
     
@@ -31,34 +41,88 @@ FFmpegDecoder::FFmpegDecoder() {
     duration = 0;
     pixel_format = AV_PIX_FMT_NONE;
     has_alpha = false;
+    last_frame_time = -1.0;
+    last_frame_duration = 0.0;
+    
+    frame_index_mode = FRAME_INDEX_ON_DEMAND;
+    index_ready = false;
+    index_cancel = false;
+    
+    held_frame_time = -1.0;
+    held_frame_duration = 0.0;
+    skip_non_reference_frames = false;
+    keyframes_only = false;
+    previous_output_pts = AV_NOPTS_VALUE;
+    discarded_frames = 0;
+    
+    thread_count = 0;
+    thread_type = THREAD_TYPE_AUTO;
+    reserved_threads = 0;
+    parked_threads = 0;
+    
+    output_mode = OUTPUT_MODE_RGB;
+    output_width = 0;
+    output_height = 0;
+    scaling_algorithm = SCALING_BILINEAR;
+    lowres = 0;
+    effective_lowres = 0;
+    convert_full_frame = false;
+    color_range_override = -1;
+    color_space_override = -1;
+    color_range = 0;
+    color_space = 0;
+    
+    frame_pool_size = 8;
+    stats = std::make_shared<FFmpegStats>();
+    allocation_count = 0;
+    last_frame_allocations = 0;
+    use_frame_cache = true;
+    frame_cache_key_dirty = true;
+    held_pts = AV_NOPTS_VALUE;
+    held_link_pts = AV_NOPTS_VALUE;
+    reset_cache_state();
     
     // Allocate frames and packet
-    frame = av_frame_alloc();
     hw_frame = av_frame_alloc();
-    packet = av_packet_alloc();
+    held_frame = av_frame_alloc();
+    held_packet = av_packet_alloc();
+    reader.set_listener(&reader_stats);
+    filter_failed = false;
 }
 
 FFmpegDecoder::~FFmpegDecoder() {
     close();
     
-    if (frame) {
-        av_frame_free(&frame);
-    }
     if (hw_frame) {
         av_frame_free(&hw_frame);
     }
-    if (packet) {
-        av_packet_free(&packet);
+    if (held_frame) {
+        av_frame_free(&held_frame);
+    }
+    if (held_packet) {
+        av_packet_free(&held_packet);
     }
 }
 
 void FFmpegDecoder::_bind_methods() {
     ClassDB::bind_method(D_METHOD("open_file", "path"), &FFmpegDecoder::open_file);
     ClassDB::bind_method(D_METHOD("open_stream", "data"), &FFmpegDecoder::open_stream);
+    ClassDB::bind_method(D_METHOD("open_same_source", "other", "threads"), &FFmpegDecoder::open_same_source, DEFVAL(-1));
+    ClassDB::bind_method(D_METHOD("was_probe_cached"), &FFmpegDecoder::was_probe_cached);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("clear_probe_cache"), &FFmpegDecoder::clear_probe_cache);
     ClassDB::bind_method(D_METHOD("close"), &FFmpegDecoder::close);
+    ClassDB::bind_method(D_METHOD("set_io_buffer_size", "size"), &FFmpegDecoder::set_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("get_io_buffer_size"), &FFmpegDecoder::get_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("set_read_ahead_size", "size"), &FFmpegDecoder::set_read_ahead_size);
+    ClassDB::bind_method(D_METHOD("get_read_ahead_size"), &FFmpegDecoder::get_read_ahead_size);
+    ClassDB::bind_method(D_METHOD("set_read_ahead_hints", "enabled"), &FFmpegDecoder::set_read_ahead_hints);
+    ClassDB::bind_method(D_METHOD("get_read_ahead_hints"), &FFmpegDecoder::get_read_ahead_hints);
+    ClassDB::bind_method(D_METHOD("get_read_ahead_buffered"), &FFmpegDecoder::get_read_ahead_buffered);
+    ClassDB::bind_method(D_METHOD("get_source_path"), &FFmpegDecoder::get_source_path);
     
     ClassDB::bind_method(D_METHOD("decode_next_frame"), &FFmpegDecoder::decode_next_frame);
-    ClassDB::bind_method(D_METHOD("seek_to_time", "time_seconds"), &FFmpegDecoder::seek_to_time);
+    ClassDB::bind_method(D_METHOD("decode_next_planes"), &FFmpegDecoder::decode_next_planes);
+    ClassDB::bind_method(D_METHOD("seek_to_time", "time_seconds", "exact"), &FFmpegDecoder::seek_to_time, DEFVAL(false));
     ClassDB::bind_method(D_METHOD("seek_to_frame", "frame_number"), &FFmpegDecoder::seek_to_frame);
     
     ClassDB::bind_method(D_METHOD("is_file_open"), &FFmpegDecoder::is_file_open);
@@ -67,40 +131,265 @@ void FFmpegDecoder::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_frame_rate"), &FFmpegDecoder::get_frame_rate);
     ClassDB::bind_method(D_METHOD("get_duration"), &FFmpegDecoder::get_duration);
     ClassDB::bind_method(D_METHOD("get_has_alpha"), &FFmpegDecoder::get_has_alpha);
+    ClassDB::bind_method(D_METHOD("get_last_frame_time"), &FFmpegDecoder::get_last_frame_time);
     ClassDB::bind_method(D_METHOD("get_pixel_format_name"), &FFmpegDecoder::get_pixel_format_name);
     
+    ClassDB::bind_method(D_METHOD("set_frame_pool_size", "size"), &FFmpegDecoder::set_frame_pool_size);
+    ClassDB::bind_method(D_METHOD("get_frame_pool_size"), &FFmpegDecoder::get_frame_pool_size);
+    ClassDB::bind_method(D_METHOD("get_allocation_count"), &FFmpegDecoder::get_allocation_count);
+    ClassDB::bind_method(D_METHOD("get_last_frame_allocations"), &FFmpegDecoder::get_last_frame_allocations);
+    ClassDB::bind_method(D_METHOD("set_use_frame_cache", "enabled"), &FFmpegDecoder::set_use_frame_cache);
+    ClassDB::bind_method(D_METHOD("get_use_frame_cache"), &FFmpegDecoder::get_use_frame_cache);
+    ClassDB::bind_method(D_METHOD("set_stats_enabled", "enabled"), &FFmpegDecoder::set_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_stats_enabled"), &FFmpegDecoder::get_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_stats"), &FFmpegDecoder::get_stats);
+    ClassDB::bind_method(D_METHOD("reset_stats"), &FFmpegDecoder::reset_stats);
+    
     ClassDB::bind_method(D_METHOD("set_use_hardware_acceleration", "enabled"), &FFmpegDecoder::set_use_hardware_acceleration);
     ClassDB::bind_method(D_METHOD("get_use_hardware_acceleration"), &FFmpegDecoder::get_use_hardware_acceleration);
+    ClassDB::bind_method(D_METHOD("set_frame_index_mode", "mode"), &FFmpegDecoder::set_frame_index_mode);
+    ClassDB::bind_method(D_METHOD("get_frame_index_mode"), &FFmpegDecoder::get_frame_index_mode);
+    ClassDB::bind_method(D_METHOD("build_frame_index"), &FFmpegDecoder::build_frame_index);
+    ClassDB::bind_method(D_METHOD("has_frame_index"), &FFmpegDecoder::has_frame_index);
+    ClassDB::bind_method(D_METHOD("get_indexed_frame_count"), &FFmpegDecoder::get_indexed_frame_count);
+    ClassDB::bind_method(D_METHOD("get_seek_skipped_frames"), &FFmpegDecoder::get_seek_skipped_frames);
+    ClassDB::bind_method(D_METHOD("set_skip_non_reference_frames", "enabled"), &FFmpegDecoder::set_skip_non_reference_frames);
+    ClassDB::bind_method(D_METHOD("get_skip_non_reference_frames"), &FFmpegDecoder::get_skip_non_reference_frames);
+    ClassDB::bind_method(D_METHOD("set_keyframes_only", "enabled"), &FFmpegDecoder::set_keyframes_only);
+    ClassDB::bind_method(D_METHOD("get_keyframes_only"), &FFmpegDecoder::get_keyframes_only);
+    ClassDB::bind_method(D_METHOD("get_discarded_frames"), &FFmpegDecoder::get_discarded_frames);
+    
+    ClassDB::bind_method(D_METHOD("set_thread_count", "count"), &FFmpegDecoder::set_thread_count);
+    ClassDB::bind_method(D_METHOD("get_thread_count"), &FFmpegDecoder::get_thread_count);
+    ClassDB::bind_method(D_METHOD("set_thread_type", "type"), &FFmpegDecoder::set_thread_type);
+    ClassDB::bind_method(D_METHOD("get_thread_type"), &FFmpegDecoder::get_thread_type);
+    ClassDB::bind_method(D_METHOD("get_effective_thread_count"), &FFmpegDecoder::get_effective_thread_count);
+    ClassDB::bind_method(D_METHOD("get_effective_thread_type"), &FFmpegDecoder::get_effective_thread_type);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("set_global_thread_cap", "threads"), &FFmpegDecoder::set_global_thread_cap);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("get_global_thread_cap"), &FFmpegDecoder::get_global_thread_cap);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("get_global_threads_in_use"), &FFmpegDecoder::get_global_threads_in_use);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("get_conversion_kernel"), &FFmpegDecoder::get_conversion_kernel);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("set_conversion_kernel", "kernel"), &FFmpegDecoder::set_conversion_kernel);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("set_conversion_threads", "threads"), &FFmpegDecoder::set_conversion_threads);
+    ClassDB::bind_static_method("FFmpegDecoder", D_METHOD("get_conversion_threads"), &FFmpegDecoder::get_conversion_threads);
+    
     ClassDB::bind_method(D_METHOD("get_available_hw_decoders"), &FFmpegDecoder::get_available_hw_decoders);
     ClassDB::bind_method(D_METHOD("get_current_hw_decoder"), &FFmpegDecoder::get_current_hw_decoder);
     
+    ClassDB::bind_method(D_METHOD("set_output_mode", "mode"), &FFmpegDecoder::set_output_mode);
+    ClassDB::bind_method(D_METHOD("get_output_mode"), &FFmpegDecoder::get_output_mode);
+    ClassDB::bind_method(D_METHOD("is_compressed_passthrough"), &FFmpegDecoder::is_compressed_passthrough);
+    ClassDB::bind_method(D_METHOD("set_output_width", "width"), &FFmpegDecoder::set_output_width);
+    ClassDB::bind_method(D_METHOD("get_output_width"), &FFmpegDecoder::get_output_width);
+    ClassDB::bind_method(D_METHOD("set_output_height", "height"), &FFmpegDecoder::set_output_height);
+    ClassDB::bind_method(D_METHOD("get_output_height"), &FFmpegDecoder::get_output_height);
+    ClassDB::bind_method(D_METHOD("set_scaling_algorithm", "algorithm"), &FFmpegDecoder::set_scaling_algorithm);
+    ClassDB::bind_method(D_METHOD("get_scaling_algorithm"), &FFmpegDecoder::get_scaling_algorithm);
+    ClassDB::bind_method(D_METHOD("set_lowres", "lowres"), &FFmpegDecoder::set_lowres);
+    ClassDB::bind_method(D_METHOD("get_lowres"), &FFmpegDecoder::get_lowres);
+    ClassDB::bind_method(D_METHOD("set_video_filter", "filter"), &FFmpegDecoder::set_video_filter);
+    ClassDB::bind_method(D_METHOD("get_video_filter"), &FFmpegDecoder::get_video_filter);
+    ClassDB::bind_method(D_METHOD("set_filter_threads", "threads"), &FFmpegDecoder::set_filter_threads);
+    ClassDB::bind_method(D_METHOD("get_filter_threads"), &FFmpegDecoder::get_filter_threads);
+    ClassDB::bind_method(D_METHOD("get_effective_lowres"), &FFmpegDecoder::get_effective_lowres);
+    ClassDB::bind_method(D_METHOD("get_output_size"), &FFmpegDecoder::get_output_size);
+    ClassDB::bind_method(D_METHOD("set_crop_regions", "regions"), &FFmpegDecoder::set_crop_regions);
+    ClassDB::bind_method(D_METHOD("get_crop_regions"), &FFmpegDecoder::get_crop_regions);
+    ClassDB::bind_method(D_METHOD("get_crop_region_count"), &FFmpegDecoder::get_crop_region_count);
+    ClassDB::bind_method(D_METHOD("set_convert_full_frame", "enabled"), &FFmpegDecoder::set_convert_full_frame);
+    ClassDB::bind_method(D_METHOD("get_convert_full_frame"), &FFmpegDecoder::get_convert_full_frame);
     ClassDB::bind_method(D_METHOD("set_color_range", "range"), &FFmpegDecoder::set_color_range);
+    ClassDB::bind_method(D_METHOD("get_color_range"), &FFmpegDecoder::get_color_range);
     ClassDB::bind_method(D_METHOD("set_color_space", "space"), &FFmpegDecoder::set_color_space);
+    ClassDB::bind_method(D_METHOD("get_color_space"), &FFmpegDecoder::get_color_space);
     ClassDB::bind_method(D_METHOD("get_raw_frame_data"), &FFmpegDecoder::get_raw_frame_data);
     
+    BIND_ENUM_CONSTANT(OUTPUT_MODE_RGB);
+    BIND_ENUM_CONSTANT(OUTPUT_MODE_YUV_PLANES);
+    BIND_ENUM_CONSTANT(OUTPUT_MODE_COMPRESSED);
+    BIND_ENUM_CONSTANT(THREAD_TYPE_AUTO);
+    BIND_ENUM_CONSTANT(THREAD_TYPE_FRAME);
+    BIND_ENUM_CONSTANT(THREAD_TYPE_SLICE);
+    BIND_ENUM_CONSTANT(FRAME_INDEX_DISABLED);
+    BIND_ENUM_CONSTANT(FRAME_INDEX_ON_DEMAND);
+    BIND_ENUM_CONSTANT(FRAME_INDEX_BACKGROUND);
+    BIND_ENUM_CONSTANT(SCALING_FAST_BILINEAR);
+    BIND_ENUM_CONSTANT(SCALING_BILINEAR);
+    BIND_ENUM_CONSTANT(SCALING_BICUBIC);
+    BIND_ENUM_CONSTANT(SCALING_AREA);
+    BIND_ENUM_CONSTANT(SCALING_LANCZOS);
+    BIND_ENUM_CONSTANT(SCALING_POINT);
+    
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_hardware_acceleration"), "set_use_hardware_acceleration", "get_use_hardware_acceleration");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "io_buffer_size", PROPERTY_HINT_RANGE, "4096,16777216,4096"), "set_io_buffer_size", "get_io_buffer_size");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "read_ahead_size", PROPERTY_HINT_RANGE, "0,536870912,1048576,suffix:B"), "set_read_ahead_size", "get_read_ahead_size");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "read_ahead_hints"), "set_read_ahead_hints", "get_read_ahead_hints");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "frame_pool_size", PROPERTY_HINT_RANGE, "1,64,1"), "set_frame_pool_size", "get_frame_pool_size");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "use_frame_cache"), "set_use_frame_cache", "get_use_frame_cache");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "stats_enabled"), "set_stats_enabled", "get_stats_enabled");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_mode", PROPERTY_HINT_ENUM, "RGB,YUV Planes,Compressed"), "set_output_mode", "get_output_mode");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_width", PROPERTY_HINT_RANGE, "0,8192,1,suffix:px"), "set_output_width", "get_output_width");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_height", PROPERTY_HINT_RANGE, "0,8192,1,suffix:px"), "set_output_height", "get_output_height");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "scaling_algorithm", PROPERTY_HINT_ENUM, "Fast Bilinear,Bilinear,Bicubic,Area,Lanczos,Point"), "set_scaling_algorithm", "get_scaling_algorithm");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "lowres", PROPERTY_HINT_ENUM, "Full,Half,Quarter,Eighth"), "set_lowres", "get_lowres");
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "video_filter"), "set_video_filter", "get_video_filter");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "filter_threads", PROPERTY_HINT_RANGE, "0,64,1"), "set_filter_threads", "get_filter_threads");
+    ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "crop_regions", PROPERTY_HINT_ARRAY_TYPE, "Rect2i"), "set_crop_regions", "get_crop_regions");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "convert_full_frame"), "set_convert_full_frame", "get_convert_full_frame");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "thread_count", PROPERTY_HINT_RANGE, "0,64,1"), "set_thread_count", "get_thread_count");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "thread_type", PROPERTY_HINT_ENUM, "Auto,Frame,Slice"), "set_thread_type", "get_thread_type");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "skip_non_reference_frames"), "set_skip_non_reference_frames", "get_skip_non_reference_frames");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "keyframes_only"), "set_keyframes_only", "get_keyframes_only");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "frame_index_mode", PROPERTY_HINT_ENUM, "Disabled,On Demand,Background"), "set_frame_index_mode", "get_frame_index_mode");
 }
 
 bool FFmpegDecoder::open_file(const String &path) {
     close();
     
-    // Open input file
-    const char* file_path = path.utf8().get_data();
-    if (avformat_open_input(&format_context, file_path, nullptr, nullptr) < 0) {
+    // A file opened before skips container detection and stream probing
+    String key = FFmpegProbeCache::make_key(path);
+    std::shared_ptr<const FFmpegProbeInfo> probe = FFmpegProbeCache::find(key);
+    if (!open_source(path, PackedByteArray(), io_context, &format_context, probe ? probe->input_format : nullptr, read_ahead_size > 0)) {
         UtilityFunctions::print("Error: Could not open file ", path);
+        close();
         return false;
     }
+    read_ahead_io = dynamic_cast<FFmpegReadAheadIO *>(io_context.get());
+    if (read_ahead_io) {
+        read_ahead_io->set_stats(stats);
+    }
     
-    // Retrieve stream information
-    if (avformat_find_stream_info(format_context, nullptr) < 0) {
-        UtilityFunctions::print("Error: Could not find stream information");
+    source_path = path;
+    probe_key = key;
+    return open_codec(probe.get());
+}
+
+bool FFmpegDecoder::open_stream(const PackedByteArray &data) {
+    close();
+    
+    if (data.is_empty() || !open_source(String(), data, io_context, &format_context)) {
+        UtilityFunctions::print("Error: Could not open memory stream");
         close();
         return false;
     }
     
-    // Find video stream
-    video_stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
-    if (video_stream_index < 0) {
+    source_data = data;
+    return open_codec();
+}
+
+bool FFmpegDecoder::open_same_source(const Ref<FFmpegDecoder> &other, int threads) {
+    if (other.is_null() || other.ptr() == this) {
+        return false;
+    }
+    
+    copy_settings(other);
+    if (threads >= 0) {
+        thread_count = threads;
+    }
+    // The index is loaded from the sidecar written by the other decoder
+    frame_index_mode = other->frame_index_mode == FRAME_INDEX_DISABLED ? FRAME_INDEX_DISABLED : FRAME_INDEX_ON_DEMAND;
+    
+    // In-memory input is shared, not copied
+    if (!other->source_data.is_empty()) {
+        return open_stream(other->source_data);
+    }
+    if (other->source_path.is_empty()) {
+        return false;
+    }
+    return open_file(other->source_path);
+}
+
+bool FFmpegDecoder::open_source(const String &path, const PackedByteArray &data,
+                                std::unique_ptr<FFmpegIOContext> &r_io, AVFormatContext **r_context,
+                                const AVInputFormat *input_format, bool use_read_ahead) const {
+    CharString file_path;
+    const char *url = nullptr;
+    
+    if (!data.is_empty()) {
+        FFmpegMemoryIO *memory_io = new FFmpegMemoryIO();
+        r_io.reset(memory_io);
+        if (!memory_io->open(data, io_buffer_size)) {
+            return false;
+        }
+    } else if (use_read_ahead && (path.begins_with("res://") || path.begins_with("user://") || path.find("://") < 0)) {
+        // Local and Godot paths, URLs keep FFmpeg's own protocol handling
+        FFmpegReadAheadIO *read_ahead = new FFmpegReadAheadIO();
+        r_io.reset(read_ahead);
+        if (!read_ahead->open(path, io_buffer_size, read_ahead_size, read_ahead_hints)) {
+            return false;
+        }
+    } else if (path.begins_with("res://") || path.begins_with("user://")) {
+        // Godot virtual paths (and anything inside an exported pack) go through FileAccess
+        FFmpegFileAccessIO *file_io = new FFmpegFileAccessIO();
+        r_io.reset(file_io);
+        if (!file_io->open(path, io_buffer_size)) {
+            return false;
+        }
+    } else {
+        file_path = path.utf8();
+        url = file_path.get_data();
+    }
+    
+    if (r_io) {
+        *r_context = avformat_alloc_context();
+        if (!*r_context) {
+            return false;
+        }
+        (*r_context)->pb = r_io->get_avio_context();
+        (*r_context)->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    
+    // On failure avformat_open_input frees the context, custom I/O stays with the caller
+    return avformat_open_input(r_context, url, (AVInputFormat *)input_format, nullptr) >= 0;
+}
+
+bool FFmpegDecoder::open_codec(const FFmpegProbeInfo *probe) {
+    // Streams that only appear while probing (MPEG-TS) are not restored
+    probe_cached = probe && probe->video_stream_index < (int)format_context->nb_streams &&
+                   format_context->streams[probe->video_stream_index]->codecpar->codec_id == probe->codecpar->codec_id;
+    
+    if (probe_cached) {
+        // Restore what avformat_find_stream_info found the last time, it
+        // would otherwise read and decode the start of the file again
+        AVStream *probed_stream = format_context->streams[probe->video_stream_index];
+        if (avcodec_parameters_copy(probed_stream->codecpar, probe->codecpar) < 0) {
+            UtilityFunctions::print("Error: Could not restore stream information");
+            close();
+            return false;
+        }
+        probed_stream->r_frame_rate = probe->r_frame_rate;
+        probed_stream->avg_frame_rate = probe->avg_frame_rate;
+        if (format_context->duration == AV_NOPTS_VALUE) {
+            format_context->duration = probe->duration;
+        }
+        if (format_context->start_time == AV_NOPTS_VALUE) {
+            format_context->start_time = probe->start_time;
+        }
+        // Without the start time, frame times and seek targets would be off by the stream's first pts
+        if (probed_stream->start_time == AV_NOPTS_VALUE) {
+            probed_stream->start_time = probe->stream_start_time;
+        }
+        if (probed_stream->duration == AV_NOPTS_VALUE) {
+            probed_stream->duration = probe->stream_duration;
+        }
+        video_stream_index = probe->video_stream_index;
+        codec = (AVCodec *)avcodec_find_decoder(probed_stream->codecpar->codec_id);
+    } else {
+        // Retrieve stream information
+        if (avformat_find_stream_info(format_context, nullptr) < 0) {
+            UtilityFunctions::print("Error: Could not find stream information");
+            close();
+            return false;
+        }
+        
+        // Find video stream
+        video_stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+        if (video_stream_index >= 0) {
+            FFmpegProbeCache::store(probe_key, format_context, video_stream_index);
+        }
+    }
+    
+    if (video_stream_index < 0 || !codec) {
         UtilityFunctions::print("Error: Could not find video stream");
         close();
         return false;
@@ -144,6 +433,13 @@ bool FFmpegDecoder::open_file(const String &path) {
         init_hardware_acceleration();
     }
     
+    configure_threading();
+    apply_frame_skipping();
+    
+    // Reduced resolution decode (JPEG, MJPEG, some intra codecs), never with a hardware decoder
+    effective_lowres = hw_device_ctx ? 0 : MIN(lowres, (int)codec->max_lowres);
+    codec_context->lowres = effective_lowres;
+    
     // Open codec
     if (avcodec_open2(codec_context, codec, nullptr) < 0) {
         UtilityFunctions::print("Error: Could not open codec");
@@ -152,22 +448,43 @@ bool FFmpegDecoder::open_file(const String &path) {
     }
     
     is_open = true;
-    UtilityFunctions::print("Successfully opened video: ", width, "x", height, " @ ", frame_rate, " fps");
+    frame_cache_key_dirty = true;
+    reader.attach(format_context, codec_context, video_stream_index);
+    UtilityFunctions::print("Successfully opened video: ", width, "x", height, " @ ", frame_rate, " fps (",
+                            get_effective_thread_count(), " ", get_effective_thread_type(), " threads)");
+    
+    if (frame_index_mode == FRAME_INDEX_BACKGROUND) {
+        index_thread = std::thread(&FFmpegDecoder::build_frame_index_internal, this);
+    }
     
     return true;
 }
 
-bool FFmpegDecoder::open_stream(const PackedByteArray &data) {
-    // TODO: Implement memory-based stream opening
-    UtilityFunctions::print("Stream opening not yet implemented");
-    return false;
-}
-
 void FFmpegDecoder::close() {
-    if (sws_context) {
-        sws_freeContext(sws_context);
-        sws_context = nullptr;
+    stop_index_thread();
+    {
+        std::lock_guard<std::mutex> lock(frame_index_mutex);
+        frame_index.clear();
+    }
+    index_ready = false;
+    
+    converter.reset();
+    for (const std::unique_ptr<FFmpegFrameConverter> &crop_converter : crop_converters) {
+        crop_converter->reset();
+    }
+    effective_lowres = 0;
+    if (held_frame) {
+        av_frame_unref(held_frame);
+    }
+    av_packet_unref(held_packet);
+    if (hw_frame) {
+        av_frame_unref(hw_frame);
     }
+    // Before the contexts it reads from are freed
+    reader.attach(nullptr, nullptr, -1);
+    filter_failed = false;
+    previous_output_pts = AV_NOPTS_VALUE;
+    reset_cache_state();
     
     if (codec_context) {
         avcodec_free_context(&codec_context);
@@ -176,71 +493,690 @@ void FFmpegDecoder::close() {
     if (format_context) {
         avformat_close_input(&format_context);
     }
+    io_context.reset();
+    read_ahead_io = nullptr;
+    source_path = String();
+    source_data = PackedByteArray();
+    probe_key = String();
     
     cleanup_hardware_acceleration();
+    release_threads();
+    parked_threads = 0;
+    
+    last_frame = DecodedFrame();
+    image_pool.clear();
     
     is_open = false;
+    frame_cache_key_dirty = true;
     video_stream_index = -1;
     width = height = 0;
     frame_rate = 0.0;
     duration = 0;
     pixel_format = AV_PIX_FMT_NONE;
     has_alpha = false;
+    last_frame_time = -1.0;
+    last_frame_duration = 0.0;
 }
 
-Ref<Image> FFmpegDecoder::decode_next_frame() {
+AVFrame *FFmpegDecoder::read_next_frame() {
     if (!is_open) {
-        return Ref<Image>();
+        return nullptr;
     }
     
-    while (av_read_frame(format_context, packet) >= 0) {
-        if (packet->stream_index == video_stream_index) {
-            int ret = avcodec_send_packet(codec_context, packet);
-            if (ret < 0) {
-                av_packet_unref(packet);
-                continue;
-            }
-            
-            ret = avcodec_receive_frame(codec_context, frame);
-            if (ret == 0) {
-                av_packet_unref(packet);
-                
-                // Handle hardware decoded frame
-                AVFrame *display_frame = frame;
-                if (frame->format == hw_device_type && hw_frame) {
-                    if (av_hwframe_transfer_data(hw_frame, frame, 0) < 0) {
-                        UtilityFunctions::print("Error transferring hardware frame to system memory");
-                        continue;
-                    }
-                    display_frame = hw_frame;
-                }
-                
-                return convert_frame_to_image(display_frame);
-            }
+    AVFrame *decoded_frame = reader.read_frame();
+    if (reader.has_filter_failed() && !filter_failed) {
+        UtilityFunctions::print("Error: Could not apply video filter \"", video_filter, "\", frames are shown unfiltered");
+        filter_failed = true;
+        frame_cache_key_dirty = true;
+    }
+    if (decoded_frame) {
+        count_discarded_frames(decoded_frame->best_effort_timestamp);
+        update_frame_time(decoded_frame->best_effort_timestamp, reader.get_frame_duration(decoded_frame));
+    }
+    return decoded_frame;
+}
+
+void FFmpegDecoder::update_frame_time(int64_t pts, int64_t duration) {
+    // Stamp the frame with its presentation time relative to the stream start
+    AVStream *video_stream = format_context->streams[video_stream_index];
+    last_frame_duration = duration > 0 ? duration * av_q2d(video_stream->time_base) : 0.0;
+    if (pts != AV_NOPTS_VALUE) {
+        if (video_stream->start_time != AV_NOPTS_VALUE) {
+            pts -= video_stream->start_time;
+        }
+        last_frame_time = pts * av_q2d(video_stream->time_base);
+    } else if (frame_rate > 0) {
+        last_frame_time = last_frame_time < 0 ? 0.0 : last_frame_time + 1.0 / frame_rate;
+    }
+}
+
+bool FFmpegDecoder::decode_frame(DecodedFrame &r_frame, bool convert) {
+    String cache_key = get_frame_cache_key();
+    if (take_cached_frame(cache_key, r_frame, convert)) {
+        return true;
+    }
+    if (is_compressed_passthrough()) {
+        return read_compressed_frame(cache_key, r_frame, convert);
+    }
+    
+    while (true) {
+        AVFrame *decoded_frame = read_next_frame();
+        if (!decoded_frame) {
+            mark_cached_end_of_stream(cache_key);
+            return false;
+        }
+        
+        int64_t pts = decoded_frame->best_effort_timestamp;
+        if (find_cached_frame(cache_key, pts, r_frame, convert)) {
+            return true;
+        }
+        int64_t link_pts = cache_link_pts;
+        cache_link_pts = AV_NOPTS_VALUE;
+        
+        if (!convert) {
+            // Keep a reference so the caller can still convert this frame once it knows it will be shown
+            av_frame_unref(held_frame);
+            av_packet_unref(held_packet);
+            av_frame_ref(held_frame, decoded_frame);
+            hold_for_conversion(cache_key, pts, link_pts, r_frame);
+            return true;
+        }
+        
+        if (convert_frame(decoded_frame, last_frame_time, r_frame)) {
+            r_frame.duration = last_frame_duration;
+            store_cached_frame(cache_key, pts, link_pts, r_frame);
+            return true;
+        }
+        // A frame that cannot be transferred or converted is skipped
+    }
+}
+
+bool FFmpegDecoder::convert_held_frame(DecodedFrame &r_frame) {
+    if (has_held_cached_frame) {
+        r_frame = held_cached_frame;
+        last_frame = r_frame;
+        held_cached_frame = DecodedFrame();
+        has_held_cached_frame = false;
+        return true;
+    }
+    
+    bool converted;
+    if (held_packet->data) {
+        converted = convert_compressed_packet(held_packet, held_frame_time, r_frame);
+        av_packet_unref(held_packet);
+    } else if (held_frame->buf[0]) {
+        converted = convert_frame(held_frame, held_frame_time, r_frame);
+        av_frame_unref(held_frame);
+    } else {
+        return false;
+    }
+    
+    if (converted) {
+        r_frame.duration = held_frame_duration;
+        store_cached_frame(held_cache_key, held_pts, held_link_pts, r_frame);
+    }
+    return converted;
+}
+
+void FFmpegDecoder::hold_for_conversion(const String &cache_key, int64_t pts, int64_t link_pts, DecodedFrame &r_frame) {
+    held_frame_time = last_frame_time;
+    held_frame_duration = last_frame_duration;
+    held_cache_key = cache_key;
+    held_pts = pts;
+    held_link_pts = link_pts;
+    held_cached_frame = DecodedFrame();
+    has_held_cached_frame = false;
+    r_frame = DecodedFrame();
+    r_frame.time = last_frame_time;
+    r_frame.duration = last_frame_duration;
+}
+
+String FFmpegDecoder::get_frame_cache_key() {
+    if (!FFmpegFrameCache::is_enabled()) {
+        return String();
+    }
+    // Built again only when a setting in it changes. A filter's output size
+    // is known once its graph has seen a frame.
+    const FFmpegFilterGraph &filter_graph = reader.get_filter_graph();
+    Vector2i filter_size(filter_graph.get_output_width(), filter_graph.get_output_height());
+    if (frame_cache_key_dirty || filter_size != frame_cache_key_filter_size) {
+        frame_cache_key = make_frame_cache_key();
+        frame_cache_key_filter_size = filter_size;
+        frame_cache_key_dirty = false;
+    }
+    return frame_cache_key;
+}
+
+String FFmpegDecoder::make_frame_cache_key() const {
+    // Files only, in-memory input has no identity. Everything that changes the images is part of the key.
+    if (!use_frame_cache || probe_key.is_empty() || !is_open) {
+        return String();
+    }
+    
+    int mode = is_compressed_passthrough() ? OUTPUT_MODE_COMPRESSED : (output_mode == OUTPUT_MODE_YUV_PLANES ? OUTPUT_MODE_YUV_PLANES : OUTPUT_MODE_RGB);
+    Vector2i size = get_output_size();
+    String key = probe_key + "|" + itos(mode) + "|" + itos(size.x) + "x" + itos(size.y) + "|" + itos(scaling_algorithm) +
+            "|" + itos(color_range_override) + "|" + itos(color_space_override) + "|" + itos(hw_device_ctx != nullptr);
+    if (!video_filter.is_empty() && !filter_failed) {
+        key += "|" + video_filter;
+    }
+    if (!crop_regions.empty()) {
+        key += "|" + itos(convert_full_frame);
+        for (const Rect2i &region : crop_regions) {
+            key += "|" + itos(region.position.x) + "," + itos(region.position.y) + "," + itos(region.size.x) + "," + itos(region.size.y);
+        }
+    }
+    return key;
+}
+
+bool FFmpegDecoder::take_cached_frame(const String &cache_key, DecodedFrame &r_frame, bool convert) {
+    if (cache_key.is_empty()) {
+        return false;
+    }
+    
+    int64_t next_pts = cache_next_pts;
+    if (next_pts == FFmpegFrameCache::END_OF_STREAM) {
+        cache_next_pts = AV_NOPTS_VALUE;
+        if (cache_served_pts != AV_NOPTS_VALUE) {
+            // The cached run ended with the last frame of the file: nothing
+            // to catch up on, the demuxer stays where it is
+            reader.finish();
+            reset_cache_state();
         }
+        return false;
+    }
+    if (next_pts != AV_NOPTS_VALUE && find_cached_frame(cache_key, next_pts, r_frame, convert)) {
+        cache_served_pts = next_pts;
+        return true;
+    }
+    if (cache_served_pts == AV_NOPTS_VALUE) {
+        cache_next_pts = AV_NOPTS_VALUE;
+        return false;
+    }
+    
+    // The cached run ended: bring the demuxer to the frame after the last one served
+    int64_t served_pts = cache_served_pts;
+    int64_t target_pts = next_pts != AV_NOPTS_VALUE ? next_pts : served_pts + 1;
+    if (!seek_to_pts(target_pts, target_pts)) {
+        // Nothing left to decode, rather than frames from the old position
+        reader.finish();
+        reset_cache_state();
+        return false;
+    }
+    cache_link_pts = served_pts;
+    return false;
+}
+
+bool FFmpegDecoder::find_cached_frame(const String &cache_key, int64_t pts, DecodedFrame &r_frame, bool convert) {
+    DecodedFrame cached;
+    int64_t next_pts;
+    if (!FFmpegFrameCache::find(cache_key, pts, cached, next_pts)) {
+        return false;
+    }
+    
+    av_frame_unref(held_frame);
+    av_packet_unref(held_packet);
+    last_frame_time = cached.time;
+    last_frame_duration = cached.duration;
+    cache_link_pts = pts;
+    cache_next_pts = next_pts;
+    stats->add(FFmpegStats::COUNTER_FRAMES_CACHED);
+    
+    if (convert) {
+        r_frame = cached;
+        last_frame = cached;
+        held_cached_frame = DecodedFrame();
+        has_held_cached_frame = false;
+    } else {
+        held_cached_frame = cached;
+        has_held_cached_frame = true;
+        r_frame = DecodedFrame();
+        r_frame.time = cached.time;
+        r_frame.duration = cached.duration;
+    }
+    return true;
+}
+
+void FFmpegDecoder::store_cached_frame(const String &cache_key, int64_t pts, int64_t link_pts, const DecodedFrame &frame) {
+    if (cache_key.is_empty() || pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    // Frames dropped inside the codec would leave holes in a cached run
+    FFmpegFrameCache::store(cache_key, pts, frame, skip_non_reference_frames || keyframes_only ? AV_NOPTS_VALUE : link_pts);
+    cache_link_pts = pts;
+}
+
+void FFmpegDecoder::mark_cached_end_of_stream(const String &cache_key) {
+    // Only at the real end, and only when every frame was delivered
+    if (cache_link_pts == AV_NOPTS_VALUE || !reader.is_input_exhausted() || skip_non_reference_frames || keyframes_only) {
+        return;
+    }
+    FFmpegFrameCache::mark_end_of_stream(cache_key, cache_link_pts);
+    cache_link_pts = AV_NOPTS_VALUE;
+}
+
+void FFmpegDecoder::reset_cache_state() {
+    cache_next_pts = AV_NOPTS_VALUE;
+    cache_served_pts = AV_NOPTS_VALUE;
+    cache_link_pts = AV_NOPTS_VALUE;
+    held_cached_frame = DecodedFrame();
+    has_held_cached_frame = false;
+}
+
+void FFmpegDecoder::set_use_frame_cache(bool enabled) {
+    use_frame_cache = enabled;
+    frame_cache_key_dirty = true;
+    reset_cache_state();
+}
+
+bool FFmpegDecoder::is_compressed_passthrough() const {
+    if (!is_open || output_mode != OUTPUT_MODE_COMPRESSED || codec_context->codec_id != AV_CODEC_ID_HAP ||
+        !crop_regions.empty() || !video_filter.is_empty()) {
+        return false;
+    }
+    int dst_width, dst_height;
+    resolve_output_size(width, height, dst_width, dst_height);
+    return dst_width == width && dst_height == height;
+}
+
+bool FFmpegDecoder::read_compressed_frame(const String &cache_key, DecodedFrame &r_frame, bool convert) {
+    while (AVPacket *packet = reader.read_packet()) {
+        int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        update_frame_time(pts, packet->duration);
+        
+        if (find_cached_frame(cache_key, pts, r_frame, convert)) {
+            av_packet_unref(packet);
+            return true;
+        }
+        int64_t link_pts = cache_link_pts;
+        cache_link_pts = AV_NOPTS_VALUE;
+        
+        if (!convert) {
+            av_frame_unref(held_frame);
+            av_packet_unref(held_packet);
+            av_packet_move_ref(held_packet, packet);
+            hold_for_conversion(cache_key, pts, link_pts, r_frame);
+            return true;
+        }
+        
+        bool converted = convert_compressed_packet(packet, last_frame_time, r_frame);
         av_packet_unref(packet);
+        if (converted) {
+            r_frame.duration = last_frame_duration;
+            store_cached_frame(cache_key, pts, link_pts, r_frame);
+            return true;
+        }
+        // A packet that is not a supported HAP frame is skipped
+    }
+    mark_cached_end_of_stream(cache_key);
+    return false;
+}
+
+bool FFmpegDecoder::convert_compressed_packet(AVPacket *src_packet, double frame_time, DecodedFrame &r_frame) {
+    int64_t allocations_before = get_allocation_count();
+    FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_SCALE);
+    if (!hap_unpacker.parse_frame(src_packet->data, src_packet->size, width, height)) {
+        return false;
     }
     
-    return Ref<Image>();
+    r_frame = DecodedFrame();
+    for (int i = 0; i < hap_unpacker.get_texture_count() && i < MAX_PLANES; i++) {
+        const FFmpegHapUnpacker::Texture &texture = hap_unpacker.get_texture(i);
+        Image::Format format;
+        switch (texture.format) {
+            case FFmpegHapUnpacker::TEXTURE_DXT1:
+                format = Image::FORMAT_DXT1;
+                break;
+            case FFmpegHapUnpacker::TEXTURE_RGTC1:
+                format = Image::FORMAT_RGTC_R;
+                break;
+            case FFmpegHapUnpacker::TEXTURE_BPTC:
+                format = Image::FORMAT_BPTC_RGBA;
+                break;
+            default:
+                format = Image::FORMAT_DXT5;
+                break;
+        }
+        
+        // The textures are padded to whole blocks, just like Godot stores them
+        size_t size = texture.unpacked_size;
+        Ref<Image> image = acquire_pool_image(width, height, format, (int64_t)size);
+        if (image.is_null() || !hap_unpacker.unpack(i, image->ptrw(), size)) {
+            return false;
+        }
+        r_frame.planes[i] = image;
+        r_frame.plane_count = i + 1;
+    }
+    
+    r_frame.ycocg = hap_unpacker.get_texture(0).format == FFmpegHapUnpacker::TEXTURE_YCOCG_DXT5;
+    r_frame.time = frame_time;
+    last_frame = r_frame;
+    stats->add(FFmpegStats::COUNTER_FRAMES_CONVERTED);
+    last_frame_allocations = (int)(get_allocation_count() - allocations_before);
+    return true;
+}
+
+AVFrame *FFmpegDecoder::transfer_frame(AVFrame *src_frame) {
+    // Handle hardware decoded frame
+    if (!src_frame->hw_frames_ctx) {
+        return src_frame;
+    }
+    
+    av_frame_unref(hw_frame);
+    FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_HW_TRANSFER);
+    if (av_hwframe_transfer_data(hw_frame, src_frame, 0) < 0) {
+        UtilityFunctions::print("Error transferring hardware frame to system memory");
+        return nullptr;
+    }
+    av_frame_copy_props(hw_frame, src_frame);
+    return hw_frame;
+}
+
+void FFmpegDecoder::count_discarded_frames(int64_t pts) {
+    // Frames dropped inside the codec leave gaps in the output timestamps
+    if (skip_non_reference_frames && pts != AV_NOPTS_VALUE && previous_output_pts != AV_NOPTS_VALUE && frame_rate > 0) {
+        AVStream *video_stream = format_context->streams[video_stream_index];
+        double gap = (pts - previous_output_pts) * av_q2d(video_stream->time_base) * frame_rate;
+        int64_t missing = (int64_t)(gap + 0.5) - 1;
+        if (missing > 0) {
+            discarded_frames += missing;
+        }
+    }
+    if (pts != AV_NOPTS_VALUE) {
+        previous_output_pts = pts;
+    }
+}
+
+void FFmpegDecoder::set_skip_non_reference_frames(bool enabled) {
+    skip_non_reference_frames = enabled;
+    apply_frame_skipping();
+}
+
+void FFmpegDecoder::set_keyframes_only(bool enabled) {
+    keyframes_only = enabled;
+    apply_frame_skipping();
+}
+
+void FFmpegDecoder::apply_frame_skipping() {
+    if (!codec_context) {
+        return;
+    }
+    // Keyframes decode on their own, so with keyframes_only a seek costs a single frame
+    if (keyframes_only) {
+        codec_context->skip_frame = AVDISCARD_NONKEY;
+    } else {
+        codec_context->skip_frame = skip_non_reference_frames ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    }
+    codec_context->skip_loop_filter = skip_non_reference_frames ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+}
+
+Ref<Image> FFmpegDecoder::decode_next_frame() {
+    // In YUV plane mode this is the luma plane, see decode_next_planes()
+    DecodedFrame decoded;
+    if (!decode_frame(decoded)) {
+        return Ref<Image>();
+    }
+    return decoded.planes[0];
 }
 
-bool FFmpegDecoder::seek_to_time(double time_seconds) {
+TypedArray<Image> FFmpegDecoder::decode_next_planes() {
+    TypedArray<Image> result;
+    DecodedFrame decoded;
+    if (decode_frame(decoded)) {
+        for (int i = 0; i < decoded.plane_count; i++) {
+            result.push_back(decoded.planes[i]);
+        }
+    }
+    return result;
+}
+
+bool FFmpegDecoder::seek_to_time(double time_seconds, bool exact) {
     if (!is_open) return false;
     
+    if (exact) {
+        // Land on the frame displayed at time_seconds rather than the keyframe before it
+        AVStream *video_stream = format_context->streams[video_stream_index];
+        int64_t start_pts = video_stream->start_time != AV_NOPTS_VALUE ? video_stream->start_time : 0;
+        int64_t target_pts = start_pts + av_rescale_q((int64_t)(MAX(time_seconds, 0.0) * AV_TIME_BASE), AV_TIME_BASE_Q, video_stream->time_base);
+        int64_t keyframe_pts = target_pts;
+        
+        if (index_ready) {
+            std::lock_guard<std::mutex> lock(frame_index_mutex);
+            // The frame on screen at target_pts started at or before it
+            int64_t frame_pts = frame_index.get_frame_pts(frame_index.find_frame_number(target_pts));
+            if (frame_pts != AV_NOPTS_VALUE) {
+                target_pts = frame_pts;
+            }
+            keyframe_pts = frame_index.find_keyframe_pts(target_pts);
+        } else if (frame_rate > 0) {
+            // Without an index keep one nominal frame of margin so the frame on screen is not skipped
+            target_pts -= av_rescale_q(1, av_inv_q(av_d2q(frame_rate, 100000)), video_stream->time_base);
+        }
+        return seek_to_pts(keyframe_pts, target_pts);
+    }
+    
     int64_t timestamp = (int64_t)(time_seconds * AV_TIME_BASE);
     if (av_seek_frame(format_context, -1, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
         return false;
     }
     
-    avcodec_flush_buffers(codec_context);
+    reader.reset();
+    reset_decode_state();
     return true;
 }
 
 bool FFmpegDecoder::seek_to_frame(int64_t frame_number) {
-    if (!is_open || frame_rate <= 0) return false;
+    if (!is_open || frame_rate <= 0 || frame_number < 0) return false;
+    
+    AVStream *video_stream = format_context->streams[video_stream_index];
+    int64_t target_pts;
+    int64_t keyframe_pts;
+    
+    if (ensure_frame_index()) {
+        std::lock_guard<std::mutex> lock(frame_index_mutex);
+        target_pts = frame_index.get_frame_pts(frame_number);
+        if (target_pts == AV_NOPTS_VALUE) {
+            return false;
+        }
+        keyframe_pts = frame_index.find_keyframe_pts(target_pts);
+    } else {
+        // No index yet: estimate the pts from the nominal frame rate
+        int64_t start_pts = video_stream->start_time != AV_NOPTS_VALUE ? video_stream->start_time : 0;
+        target_pts = start_pts + av_rescale_q(frame_number, av_inv_q(av_d2q(frame_rate, 100000)), video_stream->time_base);
+        keyframe_pts = target_pts;
+    }
     
-    double time_seconds = frame_number / frame_rate;
-    return seek_to_time(time_seconds);
+    return seek_to_pts(keyframe_pts, target_pts);
+}
+
+bool FFmpegDecoder::seek_to_pts(int64_t keyframe_pts, int64_t target_pts) {
+    if (av_seek_frame(format_context, video_stream_index, keyframe_pts, AVSEEK_FLAG_BACKWARD) < 0) {
+        return false;
+    }
+    
+    // Decode forward from the keyframe; the reader drops everything before the target
+    reader.reset(target_pts);
+    reset_decode_state();
+    return true;
+}
+
+void FFmpegDecoder::reset_decode_state() {
+    last_frame_time = -1.0;
+    last_frame_duration = 0.0;
+    previous_output_pts = AV_NOPTS_VALUE;
+    av_frame_unref(held_frame);
+    av_packet_unref(held_packet);
+    reset_cache_state();
+}
+
+void FFmpegDecoder::copy_settings(const Ref<FFmpegDecoder> &other) {
+    if (other.is_null() || other.ptr() == this) {
+        return;
+    }
+    
+    use_hardware_acceleration = other->use_hardware_acceleration;
+    output_mode = other->output_mode;
+    output_width = other->output_width;
+    output_height = other->output_height;
+    scaling_algorithm = other->scaling_algorithm;
+    lowres = other->lowres;
+    crop_regions = other->crop_regions;
+    if (crop_converters.size() > crop_regions.size()) {
+        crop_converters.resize(crop_regions.size());
+    }
+    convert_full_frame = other->convert_full_frame;
+    // Through the setters, an open decoder applies them right away
+    set_color_range(other->color_range_override);
+    set_color_space(other->color_space_override);
+    thread_count = other->thread_count;
+    thread_type = other->thread_type;
+    io_buffer_size = other->io_buffer_size;
+    read_ahead_size = other->read_ahead_size;
+    read_ahead_hints = other->read_ahead_hints;
+    frame_pool_size = other->frame_pool_size;
+    frame_index_mode = other->frame_index_mode;
+    use_frame_cache = other->use_frame_cache;
+    set_video_filter(other->video_filter);
+    set_filter_threads(other->get_filter_threads());
+    set_stats_recorder(other->stats);
+    set_skip_non_reference_frames(false);
+    frame_cache_key_dirty = true;
+}
+
+String FFmpegDecoder::make_reuse_key(const String &path, bool hardware, int threads, ThreadType type, int io_buffer, int read_ahead, int lowres_level) {
+    // Everything applied when the codec opens; output settings can change on an open decoder
+    String file_key = FFmpegProbeCache::make_key(path);
+    if (file_key.is_empty()) {
+        return String();
+    }
+    return file_key + "|" + itos(hardware) + "|" + itos(threads) + "|" + itos(type) + "|" + itos(io_buffer) + "|" + itos(read_ahead) + "|" + itos(lowres_level);
+}
+
+bool FFmpegDecoder::rewind_for_reuse() {
+    if (!is_open || !seek_to_time(0.0)) {
+        return false;
+    }
+    
+    // Back to what a fresh open would give, the codec, scalers and image pool stay warm
+    keyframes_only = false;
+    set_skip_non_reference_frames(false);
+    discarded_frames = 0;
+    reader.clear_skipped_frames();
+    crop_regions.clear();
+    crop_converters.clear();
+    convert_full_frame = false;
+    frame_cache_key_dirty = true;
+    last_frame = DecodedFrame();
+    set_stats_recorder(std::make_shared<FFmpegStats>());
+    
+    // Idle codec threads only wait, other decoders may use the budget until checkout
+    int threads = reserved_threads;
+    release_threads();
+    parked_threads = threads;
+    return true;
+}
+
+bool FFmpegDecoder::resume_from_pool() {
+    std::lock_guard<std::mutex> lock(thread_budget_mutex);
+    // The codec's thread count is fixed once it is open, so it is all or nothing
+    if (global_thread_cap > 0 && global_threads_in_use + parked_threads > global_thread_cap) {
+        return false;
+    }
+    reserved_threads = parked_threads;
+    global_threads_in_use += reserved_threads;
+    parked_threads = 0;
+    return true;
+}
+
+void FFmpegDecoder::clear_probe_cache() {
+    FFmpegProbeCache::clear();
+}
+
+void FFmpegDecoder::set_frame_index_mode(FrameIndexMode mode) {
+    frame_index_mode = mode;
+}
+
+bool FFmpegDecoder::build_frame_index() {
+    if (!is_open) {
+        return false;
+    }
+    
+    stop_index_thread();
+    if (!index_ready) {
+        build_frame_index_internal();
+    }
+    return index_ready;
+}
+
+int64_t FFmpegDecoder::get_indexed_frame_count() {
+    std::lock_guard<std::mutex> lock(frame_index_mutex);
+    return frame_index.get_frame_count();
+}
+
+bool FFmpegDecoder::ensure_frame_index() {
+    if (index_ready) {
+        return true;
+    }
+    
+    // Seeks never wait for the scan, they estimate from the frame rate until it is done
+    if (frame_index_mode != FRAME_INDEX_DISABLED && !index_thread.joinable()) {
+        index_thread = std::thread(&FFmpegDecoder::build_frame_index_internal, this);
+    }
+    return false;
+}
+
+void FFmpegDecoder::stop_index_thread() {
+    if (index_thread.joinable()) {
+        index_cancel = true;
+        index_thread.join();
+        index_cancel = false;
+    }
+}
+
+void FFmpegDecoder::build_frame_index_internal() {
+    FFmpegFrameIndex index;
+    bool built = false;
+    
+    // Files are identified by size and modification time so edits invalidate the sidecar
+    String sidecar_path;
+    uint64_t file_size = 0;
+    uint64_t modified_time = 0;
+    if (!source_path.is_empty()) {
+        Ref<FileAccess> file = FileAccess::open(source_path, FileAccess::READ);
+        if (file.is_valid()) {
+            file_size = file->get_length();
+            modified_time = FileAccess::get_modified_time(source_path);
+            sidecar_path = FFmpegFrameIndex::get_sidecar_path(source_path);
+            built = index.load(sidecar_path, file_size, modified_time);
+        }
+    }
+    
+    if (!built) {
+        std::unique_ptr<FFmpegIOContext> scan_io;
+        AVFormatContext *scan_context = nullptr;
+        if (open_source(source_path, source_data, scan_io, &scan_context)) {
+            // Some containers only expose their streams after probing
+            if ((int)scan_context->nb_streams <= video_stream_index) {
+                avformat_find_stream_info(scan_context, nullptr);
+            }
+            if ((int)scan_context->nb_streams > video_stream_index) {
+                built = index.build(scan_context, video_stream_index, &index_cancel);
+            }
+        }
+        if (scan_context) {
+            avformat_close_input(&scan_context);
+        }
+        
+        if (built && !sidecar_path.is_empty()) {
+            index.save(sidecar_path, file_size, modified_time);
+        }
+    }
+    
+    if (built) {
+        std::lock_guard<std::mutex> lock(frame_index_mutex);
+        frame_index = std::move(index);
+        index_ready = true;
+    }
 }
 
 String FFmpegDecoder::get_pixel_format_name() const {
@@ -248,6 +1184,138 @@ String FFmpegDecoder::get_pixel_format_name() const {
     return String(av_get_pix_fmt_name(pixel_format));
 }
 
+void FFmpegDecoder::set_io_buffer_size(int size) {
+    io_buffer_size = CLAMP(size, 4096, 16 * 1024 * 1024);
+}
+
+void FFmpegDecoder::set_read_ahead_size(int size) {
+    read_ahead_size = CLAMP(size, 0, 512 * 1024 * 1024);
+}
+
+void FFmpegDecoder::set_read_ahead_hints(bool enabled) {
+    read_ahead_hints = enabled;
+}
+
+int64_t FFmpegDecoder::get_read_ahead_buffered() const {
+    return read_ahead_io ? read_ahead_io->get_buffered_bytes() : 0;
+}
+
+void FFmpegDecoder::configure_threading() {
+    int requested = thread_count;
+    if (requested <= 0) {
+        // Same ceiling libavcodec applies to its own automatic thread count
+        requested = MIN(MAX((int)std::thread::hardware_concurrency(), 1), 16);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(thread_budget_mutex);
+        int granted = requested;
+        if (global_thread_cap > 0) {
+            granted = MIN(requested, global_thread_cap - global_threads_in_use);
+        }
+        // With the cap used up the codec still gets one thread, but that one
+        // decodes on the calling thread and is not counted against the cap
+        reserved_threads = MAX(granted, 0);
+        global_threads_in_use += reserved_threads;
+    }
+    
+    codec_context->thread_count = MAX(reserved_threads, 1);
+    switch (thread_type) {
+        case THREAD_TYPE_FRAME:
+            codec_context->thread_type = FF_THREAD_FRAME;
+            break;
+        case THREAD_TYPE_SLICE:
+            codec_context->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            codec_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+    }
+}
+
+void FFmpegDecoder::release_threads() {
+    if (reserved_threads == 0) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(thread_budget_mutex);
+    global_threads_in_use -= reserved_threads;
+    reserved_threads = 0;
+}
+
+void FFmpegDecoder::set_thread_count(int count) {
+    thread_count = MAX(0, count);
+}
+
+void FFmpegDecoder::set_thread_type(ThreadType type) {
+    thread_type = type;
+}
+
+int FFmpegDecoder::get_effective_thread_count() const {
+    if (!codec_context) {
+        return 0;
+    }
+    return codec_context->active_thread_type ? codec_context->thread_count : 1;
+}
+
+String FFmpegDecoder::get_effective_thread_type() const {
+    if (!codec_context) {
+        return "none";
+    }
+    if (codec_context->active_thread_type & FF_THREAD_FRAME) {
+        return "frame";
+    }
+    if (codec_context->active_thread_type & FF_THREAD_SLICE) {
+        return "slice";
+    }
+    return "none";
+}
+
+void FFmpegDecoder::set_global_thread_cap(int threads) {
+    std::lock_guard<std::mutex> lock(thread_budget_mutex);
+    global_thread_cap = MAX(0, threads);
+}
+
+int FFmpegDecoder::get_global_thread_cap() {
+    std::lock_guard<std::mutex> lock(thread_budget_mutex);
+    return global_thread_cap;
+}
+
+int FFmpegDecoder::get_global_threads_in_use() {
+    std::lock_guard<std::mutex> lock(thread_budget_mutex);
+    return global_threads_in_use;
+}
+
+String FFmpegDecoder::get_conversion_kernel() {
+    return FFmpegYuvKernels::get_isa_name(FFmpegYuvKernels::get_isa());
+}
+
+bool FFmpegDecoder::set_conversion_kernel(const String &kernel) {
+    static const FFmpegYuvKernels::Isa isas[] = {
+        FFmpegYuvKernels::ISA_NONE, FFmpegYuvKernels::ISA_SSE41, FFmpegYuvKernels::ISA_AVX2, FFmpegYuvKernels::ISA_NEON,
+    };
+    if (kernel == "auto") {
+        FFmpegYuvKernels::set_isa(FFmpegYuvKernels::get_default_isa());
+        return true;
+    }
+    for (FFmpegYuvKernels::Isa isa : isas) {
+        if (kernel == FFmpegYuvKernels::get_isa_name(isa)) {
+            FFmpegYuvKernels::set_isa(isa);
+            return FFmpegYuvKernels::get_isa() == isa;
+        }
+    }
+    UtilityFunctions::print("Error: Unknown conversion kernel: ", kernel);
+    return false;
+}
+
+void FFmpegDecoder::set_conversion_threads(int threads) {
+    FFmpegYuvKernels::set_max_threads(threads);
+}
+
+int FFmpegDecoder::get_conversion_threads() {
+    return FFmpegYuvKernels::get_max_threads();
+}
+
 bool FFmpegDecoder::init_hardware_acceleration() {
     // Try common hardware acceleration types
     AVHWDeviceType types[] = {
@@ -294,54 +1362,221 @@ AVPixelFormat FFmpegDecoder::get_hw_format(AVCodecContext *ctx, const AVPixelFor
     return AV_PIX_FMT_NONE;
 }
 
-Ref<Image> FFmpegDecoder::convert_frame_to_image(AVFrame *src_frame) {
-    if (!src_frame) return Ref<Image>();
+bool FFmpegDecoder::convert_frame(AVFrame *decoded_frame, double frame_time, DecodedFrame &r_frame) {
+    int64_t allocations_before = get_allocation_count();
     
-    // Setup scaler for RGB conversion
-    AVPixelFormat target_format = has_alpha ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
-    if (!setup_scaler((AVPixelFormat)src_frame->format, src_frame->width, src_frame->height)) {
-        return Ref<Image>();
+    AVFrame *src_frame = transfer_frame(decoded_frame);
+    if (!src_frame) {
+        return false;
     }
     
-    // Allocate destination frame
-    AVFrame *rgb_frame = av_frame_alloc();
-    int bytes_per_pixel = has_alpha ? 4 : 3;
-    int buffer_size = av_image_get_buffer_size(target_format, width, height, 1);
-    uint8_t *buffer = (uint8_t*)av_malloc(buffer_size);
+    detect_color_properties(src_frame);
     
-    av_image_fill_arrays(rgb_frame->data, rgb_frame->linesize, buffer, target_format, width, height, 1);
+    r_frame = DecodedFrame();
+    if (crop_regions.empty() || convert_full_frame) {
+        if (output_mode == OUTPUT_MODE_YUV_PLANES) {
+            if (!extract_planes(src_frame, r_frame)) {
+                return false;
+            }
+        } else {
+            r_frame.planes[0] = convert_frame_to_image(src_frame);
+            if (r_frame.planes[0].is_null()) {
+                return false;
+            }
+            r_frame.plane_count = 1;
+        }
+    }
+    if (!crop_regions.empty() && !convert_crop_regions(src_frame, r_frame)) {
+        return false;
+    }
     
-    // Convert frame
-    sws_scale(sws_context, src_frame->data, src_frame->linesize, 0, height,
-              rgb_frame->data, rgb_frame->linesize);
+    r_frame.time = frame_time;
+    r_frame.color_range = color_range;
+    r_frame.color_space = color_space;
+    last_frame = r_frame;
+    stats->add(FFmpegStats::COUNTER_FRAMES_CONVERTED);
     
-    // Create Godot Image
-    PackedByteArray image_data;
-    image_data.resize(width * height * bytes_per_pixel);
-    memcpy(image_data.ptrw(), buffer, buffer_size);
+    last_frame_allocations = (int)(get_allocation_count() - allocations_before);
+    return true;
+}
+
+void FFmpegDecoder::detect_color_properties(AVFrame *src_frame) {
+    FFmpegFrameConverter::detect_color_properties(src_frame, color_range_override, color_space_override, color_range, color_space);
+}
+
+bool FFmpegDecoder::extract_planes(AVFrame *src_frame, DecodedFrame &r_frame) {
+    FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_SCALE);
+    FFmpegFrameConverter::PlaneLayout layout;
+    int dst_width, dst_height;
+    resolve_output_size(src_frame->width, src_frame->height, dst_width, dst_height);
+    const AVFrame *planar_frame = converter.prepare_planes(src_frame, dst_width, dst_height, get_scale_flags(), layout);
+    if (!planar_frame) {
+        return false;
+    }
     
-    Image::Format godot_format = has_alpha ? Image::FORMAT_RGBA8 : Image::FORMAT_RGB8;
-    Ref<Image> image = Image::create_from_data(width, height, false, godot_format, image_data);
+    r_frame.interleaved_chroma = layout.interleaved_chroma;
+    r_frame.plane_count = layout.count;
     
-    // Cleanup
-    av_free(buffer);
-    av_frame_free(&rgb_frame);
+    for (int i = 0; i < layout.count; i++) {
+        Image::Format plane_format = layout.channels[i] == 2 ? Image::FORMAT_RG8 : Image::FORMAT_R8;
+        Ref<Image> plane = acquire_pool_image(layout.width[i], layout.height[i], plane_format,
+                                              (int64_t)layout.width[i] * layout.height[i] * layout.channels[i]);
+        if (plane.is_null()) {
+            return false;
+        }
+        
+        FFmpegFrameConverter::copy_plane(planar_frame, layout, i, plane->ptrw());
+        r_frame.planes[i] = plane;
+    }
+    
+    return true;
+}
+
+Ref<Image> FFmpegDecoder::convert_frame_to_image(AVFrame *src_frame) {
+    if (!src_frame) return Ref<Image>();
+    
+    // Always RGBA8: an RGB8 image would be expanded to RGBA on every texture upload
+    int dst_width, dst_height;
+    resolve_output_size(src_frame->width, src_frame->height, dst_width, dst_height);
+    Ref<Image> image = acquire_pool_image(dst_width, dst_height, Image::FORMAT_RGBA8, (int64_t)dst_width * dst_height * 4);
+    if (image.is_null()) {
+        return Ref<Image>();
+    }
+    
+    // Convert straight into the image buffer, no intermediate copy
+    FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_SCALE);
+    if (!converter.convert_to_rgba(src_frame, dst_width, dst_height, get_scale_flags(), color_range, color_space,
+                                   image->ptrw(), dst_width * 4)) {
+        return Ref<Image>();
+    }
     
     return image;
 }
 
-bool FFmpegDecoder::setup_scaler(AVPixelFormat src_format, int src_width, int src_height) {
-    AVPixelFormat target_format = has_alpha ? AV_PIX_FMT_RGBA : AV_PIX_FMT_RGB24;
+bool FFmpegDecoder::convert_crop_regions(AVFrame *src_frame, DecodedFrame &r_frame) {
+    while (crop_converters.size() < crop_regions.size()) {
+        crop_converters.push_back(std::make_unique<FFmpegFrameConverter>());
+    }
+    
+    r_frame.crops.resize(crop_regions.size());
+    for (size_t i = 0; i < crop_regions.size(); i++) {
+        // Regions are given in video pixels, lowres decodes a smaller frame
+        const Rect2i &region = crop_regions[i];
+        int x = region.position.x >> effective_lowres;
+        int y = region.position.y >> effective_lowres;
+        int region_width = region.size.x >> effective_lowres;
+        int region_height = region.size.y >> effective_lowres;
+        if (!FFmpegFrameConverter::clip_region(src_frame, x, y, region_width, region_height)) {
+            continue;
+        }
+        
+        Ref<Image> image = acquire_pool_image(region_width, region_height, Image::FORMAT_RGBA8,
+                                              (int64_t)region_width * region_height * 4);
+        if (image.is_null()) {
+            return false;
+        }
+        
+        // Only the region is read and converted, the rest of the frame is skipped
+        FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_SCALE);
+        if (!crop_converters[i]->convert_region_to_rgba(src_frame, x, y, region_width, region_height,
+                                                        region_width, region_height, get_scale_flags(),
+                                                        color_range, color_space, image->ptrw(), region_width * 4)) {
+            return false;
+        }
+        r_frame.crops[i] = image;
+    }
+    
+    return true;
+}
+
+Ref<Image> FFmpegDecoder::acquire_pool_image(int p_width, int p_height, Image::Format p_format, int64_t p_data_size) {
+    int free_index = -1;
+    for (size_t i = 0; i < image_pool.size(); i++) {
+        const Ref<Image> &pooled = image_pool[i];
+        // Still referenced by a queue, texture upload or script
+        if (pooled->get_reference_count() > 1) {
+            continue;
+        }
+        if (pooled->get_width() == p_width && pooled->get_height() == p_height && pooled->get_format() == p_format) {
+            return pooled;
+        }
+        free_index = (int)i;
+    }
     
-    if (sws_context) {
-        sws_freeContext(sws_context);
+    Ref<Image> image;
+    {
+        FFmpegStats::Scope scope(stats.get(), FFmpegStats::STAGE_IMAGE_CREATE);
+        PackedByteArray data;
+        data.resize(p_data_size);
+        image = Image::create_from_data(p_width, p_height, false, p_format, data);
     }
+    allocation_count++;
     
-    sws_context = sws_getContext(src_width, src_height, src_format,
-                                width, height, target_format,
-                                SWS_BILINEAR, nullptr, nullptr, nullptr);
+    // Replace an idle image of the wrong size, grow the pool, or hand out an
+    // unpooled image when every pooled one is still in use
+    if (free_index >= 0) {
+        image_pool[free_index] = image;
+    } else if ((int)image_pool.size() < frame_pool_size) {
+        image_pool.push_back(image);
+    }
     
-    return sws_context != nullptr;
+    return image;
+}
+
+void FFmpegDecoder::set_frame_pool_size(int size) {
+    frame_pool_size = MAX(1, size);
+    if ((int)image_pool.size() > frame_pool_size) {
+        image_pool.resize(frame_pool_size);
+    }
+}
+
+int64_t FFmpegDecoder::get_allocation_count() const {
+    uint64_t total = allocation_count + converter.get_allocation_count();
+    for (const std::unique_ptr<FFmpegFrameConverter> &crop_converter : crop_converters) {
+        total += crop_converter->get_allocation_count();
+    }
+    return (int64_t)total;
+}
+
+void FFmpegDecoder::set_stats_enabled(bool enabled) {
+    stats->set_enabled(enabled);
+}
+
+Dictionary FFmpegDecoder::get_stats() {
+    Dictionary result = stats->to_dictionary();
+    if (read_ahead_io) {
+        result["read_ahead_buffered"] = read_ahead_io->get_buffered_bytes();
+        result["read_ahead_size"] = read_ahead_io->get_capacity();
+    }
+    return result;
+}
+
+void FFmpegDecoder::set_stats_recorder(const std::shared_ptr<FFmpegStats> &recorder) {
+    stats = recorder;
+    if (read_ahead_io) {
+        read_ahead_io->set_stats(stats);
+    }
+}
+
+void FFmpegDecoder::reset_stats() {
+    stats->reset();
+}
+
+bool FFmpegDecoder::ReaderStats::is_timing() {
+    return decoder->stats->is_enabled();
+}
+
+void FFmpegDecoder::ReaderStats::record_stage(FFmpegFrameReader::Stage stage, std::chrono::steady_clock::duration elapsed) {
+    static const FFmpegStats::Stage STAGES[] = { FFmpegStats::STAGE_READ, FFmpegStats::STAGE_DECODE, FFmpegStats::STAGE_FILTER };
+    decoder->stats->record(STAGES[stage], elapsed);
+}
+
+void FFmpegDecoder::ReaderStats::count_decoded_frame() {
+    decoder->stats->add(FFmpegStats::COUNTER_FRAMES_DECODED);
+}
+
+void FFmpegDecoder::ReaderStats::count_read_bytes(int64_t bytes) {
+    decoder->stats->add(FFmpegStats::COUNTER_BYTES_READ, bytes);
 }
 
 void FFmpegDecoder::set_use_hardware_acceleration(bool enabled) {
@@ -366,15 +1601,140 @@ String FFmpegDecoder::get_current_hw_decoder() {
     return "Software";
 }
 
+void FFmpegDecoder::set_output_mode(OutputMode mode) {
+    output_mode = mode;
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::set_output_width(int p_width) {
+    output_width = MAX(0, p_width);
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::set_output_height(int p_height) {
+    output_height = MAX(0, p_height);
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::set_scaling_algorithm(ScalingAlgorithm algorithm) {
+    scaling_algorithm = algorithm;
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::set_lowres(int p_lowres) {
+    lowres = CLAMP(p_lowres, 0, 3);
+}
+
+void FFmpegDecoder::set_video_filter(const String &filter) {
+    video_filter = filter.strip_edges();
+    reader.set_filter(video_filter.utf8().get_data());
+    filter_failed = false;
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::set_filter_threads(int threads) {
+    reader.get_filter_graph().set_threads(MAX(0, threads));
+}
+
+void FFmpegDecoder::set_crop_regions(const TypedArray<Rect2i> &regions) {
+    crop_regions.clear();
+    for (int i = 0; i < regions.size(); i++) {
+        crop_regions.push_back(regions[i]);
+    }
+    // Converters are kept per index, so an unchanged region keeps its scaler
+    if (crop_converters.size() > crop_regions.size()) {
+        crop_converters.resize(crop_regions.size());
+    }
+    frame_cache_key_dirty = true;
+}
+
+TypedArray<Rect2i> FFmpegDecoder::get_crop_regions() const {
+    TypedArray<Rect2i> result;
+    for (const Rect2i &region : crop_regions) {
+        result.push_back(region);
+    }
+    return result;
+}
+
+void FFmpegDecoder::set_convert_full_frame(bool enabled) {
+    convert_full_frame = enabled;
+    frame_cache_key_dirty = true;
+}
+
+void FFmpegDecoder::resolve_output_size(int src_width, int src_height, int &r_width, int &r_height) const {
+    r_width = src_width;
+    r_height = src_height;
+    if (src_width <= 0 || src_height <= 0) {
+        return;
+    }
+    
+    if (output_width > 0 && output_height > 0) {
+        r_width = output_width;
+        r_height = output_height;
+    } else if (output_width > 0) {
+        r_width = output_width;
+        r_height = MAX(2, (int)((int64_t)src_height * output_width / src_width) & ~1);
+    } else if (output_height > 0) {
+        r_height = output_height;
+        r_width = MAX(2, (int)((int64_t)src_width * output_height / src_height) & ~1);
+    }
+}
+
+int FFmpegDecoder::get_scale_flags() const {
+    switch (scaling_algorithm) {
+        case SCALING_FAST_BILINEAR:
+            return SWS_FAST_BILINEAR;
+        case SCALING_BICUBIC:
+            return SWS_BICUBIC;
+        case SCALING_AREA:
+            return SWS_AREA;
+        case SCALING_LANCZOS:
+            return SWS_LANCZOS;
+        case SCALING_POINT:
+            return SWS_POINT;
+        default:
+            return SWS_BILINEAR;
+    }
+}
+
+Vector2i FFmpegDecoder::get_output_size() const {
+    int decoded_width = AV_CEIL_RSHIFT(width, effective_lowres);
+    int decoded_height = AV_CEIL_RSHIFT(height, effective_lowres);
+    // A filter can change the size (crop, transpose), known once its graph has seen a frame
+    const FFmpegFilterGraph &filter_graph = reader.get_filter_graph();
+    if (filter_graph.get_output_width() > 0 && !filter_failed) {
+        decoded_width = filter_graph.get_output_width();
+        decoded_height = filter_graph.get_output_height();
+    }
+    int result_width, result_height;
+    resolve_output_size(decoded_width, decoded_height, result_width, result_height);
+    return Vector2i(result_width, result_height);
+}
+
 void FFmpegDecoder::set_color_range(int range) {
-    // TODO: Implement color range setting for YUV processing
+    color_range_override = CLAMP(range, -1, 1);
+    frame_cache_key_dirty = true;
+    if (color_range_override >= 0) {
+        color_range = color_range_override;
+    }
 }
 
 void FFmpegDecoder::set_color_space(int space) {
-    // TODO: Implement color space setting
+    color_space_override = CLAMP(space, -1, 3);
+    frame_cache_key_dirty = true;
+    if (color_space_override >= 0) {
+        color_space = color_space_override;
+    }
 }
 
 PackedByteArray FFmpegDecoder::get_raw_frame_data() {
-    // TODO: Return raw frame data for custom shader processing
-    return PackedByteArray();
-}
\ No newline at end of file
+    if (last_frame.plane_count == 1) {
+        return last_frame.planes[0]->get_data();
+    }
+    
+    PackedByteArray result;
+    for (int i = 0; i < last_frame.plane_count; i++) {
+        result.append_array(last_frame.planes[i]->get_data());
+    }
+    return result;
+}
@@ -5,6 +5,25 @@
 #include <godot_cpp/classes/image.hpp>
 #include <godot_cpp/variant/string.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+#include "ffmpeg_frame_converter.h"
+#include "ffmpeg_frame_index.h"
+#include "ffmpeg_frame_reader.h"
+#include "ffmpeg_hap_unpacker.h"
+#include "ffmpeg_io_context.h"
+#include "ffmpeg_probe_cache.h"
+#include "ffmpeg_read_ahead_io.h"
+#include "ffmpeg_stats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 extern "C" {
     #include <libavcodec/avcodec.h>
@@ -20,17 +39,74 @@ namespace godot {
 class FFmpegDecoder : public RefCounted {
     GDCLASS(FFmpegDecoder, RefCounted)
 
+public:
+    enum OutputMode {
+        OUTPUT_MODE_RGB,        // Converted on the CPU to RGBA8
+        OUTPUT_MODE_YUV_PLANES, // Native planes as R8 (and RG8 for NV12 chroma) for yuv_to_rgb.gdshader
+        OUTPUT_MODE_COMPRESSED, // HAP frames unwrapped to DXT1/DXT5/BPTC without decoding, other codecs as RGB
+    };
+    
+    enum ThreadType {
+        THREAD_TYPE_AUTO,  // Let the codec use frame and/or slice threading
+        THREAD_TYPE_FRAME, // Throughput: one frame per thread, adds thread_count frames of latency
+        THREAD_TYPE_SLICE, // Latency: slices of one frame in parallel, needs a sliced bitstream
+    };
+    
+    enum FrameIndexMode {
+        FRAME_INDEX_DISABLED,   // seek_to_frame() estimates from the nominal frame rate
+        FRAME_INDEX_ON_DEMAND,  // Built (or loaded from its sidecar) in the background from the first frame seek
+        FRAME_INDEX_BACKGROUND, // Built on a worker thread as soon as the file opens
+    };
+    
+    enum ScalingAlgorithm {
+        SCALING_FAST_BILINEAR,
+        SCALING_BILINEAR,
+        SCALING_BICUBIC,
+        SCALING_AREA,    // Best for large downscales (4K master to a preview)
+        SCALING_LANCZOS,
+        SCALING_POINT,
+    };
+    
+    static const int MAX_PLANES = 4;
+    
+    // A converted frame: one RGB image, or the Y/U/V(/A) planes (Y/UV for NV12),
+    // plus one RGBA8 image per crop region
+    struct DecodedFrame {
+        Ref<Image> planes[MAX_PLANES];
+        int plane_count = 0;
+        std::vector<Ref<Image>> crops; // Null where a region lies outside the frame
+        double time = -1.0;
+        double duration = 0.0; // Until the next frame, 0 when the container does not say
+        bool interleaved_chroma = false;
+        bool ycocg = false; // HAP Q: plane 0 is scaled YCoCg DXT5, plane 1 the optional RGTC alpha
+        int color_range = 0;
+        int color_space = 0;
+    };
+
 private:
     AVFormatContext *format_context;
     AVCodecContext *codec_context;
     AVCodec *codec;
-    AVFrame *frame;
     AVFrame *hw_frame;
-    AVPacket *packet;
-    SwsContext *sws_context;
     
     int video_stream_index;
     bool is_open;
+    
+    // Input source, custom I/O is used for Godot paths and in-memory data
+    std::unique_ptr<FFmpegIOContext> io_context;
+    int io_buffer_size;
+    int read_ahead_size; // 0 reads on the decoding thread
+    bool read_ahead_hints;
+    FFmpegReadAheadIO *read_ahead_io; // io_context when it reads ahead
+    String source_path;
+    PackedByteArray source_data;
+    bool open_source(const String &path, const PackedByteArray &data,
+                     std::unique_ptr<FFmpegIOContext> &r_io, AVFormatContext **r_context,
+                     const AVInputFormat *input_format = nullptr, bool use_read_ahead = false) const;
+    bool open_codec(const FFmpegProbeInfo *probe = nullptr);
+    String probe_key;
+    bool probe_cached;
+    String reuse_key;
     bool use_hardware_acceleration;
     AVHWDeviceType hw_device_type;
     AVBufferRef *hw_device_ctx;
@@ -42,6 +118,58 @@ private:
     int64_t duration;
     AVPixelFormat pixel_format;
     bool has_alpha;
+    double last_frame_time;
+    double last_frame_duration;
+    
+    // Output and colour handling, overrides of -1 follow the decoded frame
+    OutputMode output_mode;
+    int color_range_override;
+    int color_space_override;
+    int color_range;
+    int color_space;
+    DecodedFrame last_frame;
+    
+    // Output size, resized in the conversion pass. 0 follows the decoded
+    // size, one side alone keeps the aspect ratio.
+    int output_width;
+    int output_height;
+    ScalingAlgorithm scaling_algorithm;
+    int lowres;
+    int effective_lowres;
+    void resolve_output_size(int src_width, int src_height, int &r_width, int &r_height) const;
+    int get_scale_flags() const;
+    
+    // Crop outputs: sub-rectangles converted on their own, each keeps its
+    // scaler cached, so one decode feeds several outputs
+    std::vector<Rect2i> crop_regions;
+    std::vector<std::unique_ptr<FFmpegFrameConverter>> crop_converters;
+    bool convert_full_frame;
+    bool convert_crop_regions(AVFrame *frame, DecodedFrame &r_frame);
+    
+    // Packet index for frame-accurate seeking, built from a second demuxer
+    // so the background scan never disturbs decoding
+    FrameIndexMode frame_index_mode;
+    FFmpegFrameIndex frame_index;
+    std::mutex frame_index_mutex;
+    std::thread index_thread;
+    std::atomic<bool> index_ready;
+    std::atomic<bool> index_cancel;
+    void reset_decode_state();
+    void build_frame_index_internal();
+    void stop_index_thread();
+    bool ensure_frame_index(); // Starts the background scan, never waits for it
+    bool seek_to_pts(int64_t keyframe_pts, int64_t target_pts);
+    
+    // Decoder threading, reservations are counted against a process-wide cap
+    int thread_count;
+    ThreadType thread_type;
+    int reserved_threads;
+    int parked_threads; // Codec threads of a pooled decoder, not counted while it is idle
+    static std::mutex thread_budget_mutex;
+    static int global_thread_cap;
+    static int global_threads_in_use;
+    void configure_threading();
+    void release_threads();
     
     // Hardware acceleration methods
     bool init_hardware_acceleration();
@@ -49,9 +177,89 @@ private:
     AVPixelFormat get_hw_format(AVCodecContext *ctx, const AVPixelFormat *pix_fmts);
     static AVPixelFormat hw_pix_fmt_callback(AVCodecContext *ctx, const AVPixelFormat *pix_fmts);
     
+    // Deferred conversion and catch-up: a frame decoded without conversion is
+    // held so it can still be converted if it turns out to be displayed
+    AVFrame *held_frame;
+    double held_frame_time;
+    double held_frame_duration;
+    bool skip_non_reference_frames;
+    bool keyframes_only;
+    void apply_frame_skipping();
+    int64_t previous_output_pts;
+    uint64_t discarded_frames;
+    void count_discarded_frames(int64_t pts);
+    
+    // Reading, decoding and the optional libavfilter stage, the same loop the
+    // benchmark times. Filtered frames are references into the graph's
+    // buffers, never copies.
+    class ReaderStats : public FFmpegFrameReader::Listener {
+        FFmpegDecoder *decoder;
+    
+    public:
+        ReaderStats(FFmpegDecoder *p_decoder) : decoder(p_decoder) {}
+        virtual bool is_timing() override;
+        virtual void record_stage(FFmpegFrameReader::Stage stage, std::chrono::steady_clock::duration elapsed) override;
+        virtual void count_decoded_frame() override;
+        virtual void count_read_bytes(int64_t bytes) override;
+    };
+    ReaderStats reader_stats;
+    FFmpegFrameReader reader;
+    String video_filter;
+    bool filter_failed; // Reported once, frames then pass unfiltered
+    AVFrame *read_next_frame();
+    
     // Frame conversion
+    FFmpegFrameConverter converter;
+    AVFrame *transfer_frame(AVFrame *frame);
+    void update_frame_time(int64_t pts, int64_t duration);
+    bool convert_frame(AVFrame *frame, double frame_time, DecodedFrame &r_frame);
     Ref<Image> convert_frame_to_image(AVFrame *frame);
-    bool setup_scaler(AVPixelFormat src_format, int src_width, int src_height);
+    bool extract_planes(AVFrame *frame, DecodedFrame &r_frame);
+    void detect_color_properties(AVFrame *frame);
+    
+    // HAP passthrough: packets are unwrapped straight into compressed images,
+    // the codec never sees them. Crops and resizing need decoded frames.
+    FFmpegHapUnpacker hap_unpacker;
+    AVPacket *held_packet;
+    bool read_compressed_frame(const String &cache_key, DecodedFrame &r_frame, bool convert);
+    bool convert_compressed_packet(AVPacket *packet, double frame_time, DecodedFrame &r_frame);
+    
+    // Recycled output images: an image is reused once nobody but the pool
+    // references it, so steady-state conversion performs no allocation
+    std::vector<Ref<Image>> image_pool;
+    int frame_pool_size;
+    uint64_t allocation_count;
+    int last_frame_allocations;
+    Ref<Image> acquire_pool_image(int p_width, int p_height, Image::Format p_format, int64_t p_data_size);
+    
+    // Shared frame cache: a decoded frame found there skips conversion, and
+    // while the frames after it are cached too they are served without
+    // reading the file. The demuxer catches up when the cached run ends.
+    bool use_frame_cache;
+    int64_t cache_next_pts;   // Frame after the last one delivered, if known
+    int64_t cache_served_pts; // Last frame served while the demuxer stayed behind
+    int64_t cache_link_pts;   // Last frame delivered if it is cached, the next one is linked to it
+    String held_cache_key;
+    int64_t held_pts;
+    int64_t held_link_pts;
+    bool has_held_cached_frame;
+    DecodedFrame held_cached_frame;
+    String frame_cache_key;
+    bool frame_cache_key_dirty; // Set by every setting that is part of the key
+    Vector2i frame_cache_key_filter_size;
+    String get_frame_cache_key(); // Empty when the cache does not apply
+    String make_frame_cache_key() const;
+    bool take_cached_frame(const String &cache_key, DecodedFrame &r_frame, bool convert);
+    bool find_cached_frame(const String &cache_key, int64_t pts, DecodedFrame &r_frame, bool convert);
+    void store_cached_frame(const String &cache_key, int64_t pts, int64_t link_pts, const DecodedFrame &frame);
+    void mark_cached_end_of_stream(const String &cache_key);
+    void hold_for_conversion(const String &cache_key, int64_t pts, int64_t link_pts, DecodedFrame &r_frame);
+    void reset_cache_state();
+    
+    // Stage timings and counters, shared with the playback and with a
+    // decoder opened on the same source
+    std::shared_ptr<FFmpegStats> stats;
+    void set_stats_recorder(const std::shared_ptr<FFmpegStats> &recorder);
     
 protected:
     static void _bind_methods();
@@ -63,13 +271,54 @@ public:
     // Core functionality
     bool open_file(const String &path);
     bool open_stream(const PackedByteArray &data);
+    bool open_same_source(const Ref<FFmpegDecoder> &other, int threads = -1); // Second read position on another decoder's input, -1 = its thread count
+    void copy_settings(const Ref<FFmpegDecoder> &other); // Everything but the input, e.g. for the next clip of a playlist
     void close();
+    void set_io_buffer_size(int size);
+    int get_io_buffer_size() const { return io_buffer_size; }
+    
+    // Read-ahead for slow storage, applied when a file is opened: a thread
+    // keeps up to read_ahead_size bytes buffered ahead of the demuxer
+    void set_read_ahead_size(int size); // 0 disables
+    int get_read_ahead_size() const { return read_ahead_size; }
+    void set_read_ahead_hints(bool enabled); // posix_fadvise() prefetch hints for local files
+    bool get_read_ahead_hints() const { return read_ahead_hints; }
+    int64_t get_read_ahead_buffered() const; // Fill level in bytes
+    String get_source_path() const { return source_path; }
+    bool was_probe_cached() const { return probe_cached; } // The last open skipped stream probing
+    static void clear_probe_cache();
+    
+    // Reuse by FFmpegDecoderPool: the key describes the file and open-time
+    // settings, rewinding drops everything a playback changed
+    static String make_reuse_key(const String &path, bool hardware, int threads, ThreadType type, int io_buffer, int read_ahead, int lowres_level);
+    void set_reuse_key(const String &key) { reuse_key = key; }
+    String get_reuse_key() const { return reuse_key; }
+    bool rewind_for_reuse(); // Also gives the thread reservation back while the decoder is idle
+    bool resume_from_pool(); // Reserves the threads again, false if the cap has no room for them
     
     // Decoding
+    bool decode_frame(DecodedFrame &r_frame, bool convert = true);
+    bool convert_held_frame(DecodedFrame &r_frame); // Converts the last frame decoded with convert = false
     Ref<Image> decode_next_frame();
-    bool seek_to_time(double time_seconds);
+    TypedArray<Image> decode_next_planes();
+    bool seek_to_time(double time_seconds, bool exact = false);
     bool seek_to_frame(int64_t frame_number);
     
+    // Frame index
+    void set_frame_index_mode(FrameIndexMode mode);
+    FrameIndexMode get_frame_index_mode() const { return frame_index_mode; }
+    bool build_frame_index();
+    bool has_frame_index() const { return index_ready; }
+    int64_t get_indexed_frame_count();
+    int64_t get_seek_skipped_frames() const { return (int64_t)reader.get_skipped_frames(); }
+    
+    // Catch-up: drop non-reference frames and loop filtering inside the codec
+    void set_skip_non_reference_frames(bool enabled);
+    bool get_skip_non_reference_frames() const { return skip_non_reference_frames; }
+    int64_t get_discarded_frames() const { return (int64_t)discarded_frames; }
+    void set_keyframes_only(bool enabled); // AVDISCARD_NONKEY: only keyframes come out, for thumbnails
+    bool get_keyframes_only() const { return keyframes_only; }
+    
     // Properties
     bool is_file_open() const { return is_open; }
     int get_width() const { return width; }
@@ -77,8 +326,40 @@ public:
     double get_frame_rate() const { return frame_rate; }
     double get_duration() const { return duration > 0 ? (double)duration / AV_TIME_BASE : 0.0; }
     bool get_has_alpha() const { return has_alpha; }
+    double get_last_frame_time() const { return last_frame_time; } // Presentation time of the last decoded frame
+    bool is_input_exhausted() const { return reader.is_input_exhausted(); } // Only frames still inside the codec are left
     String get_pixel_format_name() const;
     
+    // Buffer recycling
+    void set_frame_pool_size(int size);
+    int get_frame_pool_size() const { return frame_pool_size; }
+    int64_t get_allocation_count() const;
+    int get_last_frame_allocations() const { return last_frame_allocations; }
+    void set_use_frame_cache(bool enabled); // Read and fill the shared frame cache, see FFmpegVideoStream.set_frame_cache_budget()
+    bool get_use_frame_cache() const { return use_frame_cache; }
+    
+    // Instrumentation
+    void set_stats_enabled(bool enabled);
+    bool get_stats_enabled() const { return stats->is_enabled(); }
+    Dictionary get_stats();
+    void reset_stats();
+    FFmpegStats *get_stats_recorder() const { return stats.get(); }
+    
+    // Threading, applied when the file is opened
+    void set_thread_count(int count); // 0 = one per CPU core
+    int get_thread_count() const { return thread_count; }
+    void set_thread_type(ThreadType type);
+    ThreadType get_thread_type() const { return thread_type; }
+    int get_effective_thread_count() const;
+    String get_effective_thread_type() const;
+    static void set_global_thread_cap(int threads); // 0 = unlimited
+    static int get_global_thread_cap();
+    static int get_global_threads_in_use();
+    static String get_conversion_kernel(); // Instruction set of the RGBA kernels, "none" = sws_scale
+    static bool set_conversion_kernel(const String &kernel); // "auto", "none" or one the CPU has, e.g. "neon" to opt in
+    static void set_conversion_threads(int threads); // 0 = up to four, for frames of a megapixel or more
+    static int get_conversion_threads();
+    
     // Hardware acceleration
     void set_use_hardware_acceleration(bool enabled);
     bool get_use_hardware_acceleration() const { return use_hardware_acceleration; }
@@ -86,11 +367,40 @@ public:
     String get_current_hw_decoder();
     
     // Advanced features for projection mapping
-    void set_color_range(int range); // For YUV color range handling
-    void set_color_space(int space); // For color space conversion
-    PackedByteArray get_raw_frame_data(); // For custom shader processing
+    void set_output_mode(OutputMode mode);
+    OutputMode get_output_mode() const { return output_mode; }
+    bool is_compressed_passthrough() const; // HAP frames currently skip decoding
+    void set_output_width(int p_width);
+    int get_output_width() const { return output_width; }
+    void set_output_height(int p_height);
+    int get_output_height() const { return output_height; }
+    void set_scaling_algorithm(ScalingAlgorithm algorithm);
+    ScalingAlgorithm get_scaling_algorithm() const { return scaling_algorithm; }
+    void set_lowres(int p_lowres); // Decode at 1/2^lowres size where the codec supports it, applied on open
+    int get_lowres() const { return lowres; }
+    int get_effective_lowres() const { return effective_lowres; }
+    Vector2i get_output_size() const; // Size of the images produced for the open file
+    void set_video_filter(const String &filter); // libavfilter graph such as "yadif" or "transpose=clock", empty = none
+    String get_video_filter() const { return video_filter; }
+    void set_filter_threads(int threads); // Threads of the filter graph, 0 = one per CPU core
+    int get_filter_threads() const { return reader.get_filter_graph().get_threads(); }
+    void set_crop_regions(const TypedArray<Rect2i> &regions); // In video pixels, one RGBA8 image each
+    TypedArray<Rect2i> get_crop_regions() const;
+    int get_crop_region_count() const { return (int)crop_regions.size(); }
+    void set_convert_full_frame(bool enabled); // With crop regions, also produce the whole frame
+    bool get_convert_full_frame() const { return convert_full_frame; }
+    void set_color_range(int range); // 0 = TV range, 1 = full range, -1 = from stream
+    int get_color_range() const { return color_range; }
+    void set_color_space(int space); // 0 = BT.601, 1 = BT.709, 2 = BT.2020, 3 = SMPTE-240M, -1 = from stream
+    int get_color_space() const { return color_space; }
+    PackedByteArray get_raw_frame_data(); // Tightly packed planes of the last frame, for custom shader processing
 };
 
 }
 
+VARIANT_ENUM_CAST(FFmpegDecoder::OutputMode);
+VARIANT_ENUM_CAST(FFmpegDecoder::ThreadType);
+VARIANT_ENUM_CAST(FFmpegDecoder::FrameIndexMode);
+VARIANT_ENUM_CAST(FFmpegDecoder::ScalingAlgorithm);
+
 #endif // FFMPEG_DECODER_H
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "ffmpeg_decoder_pool.h"
+
+using namespace godot;
+
+std::mutex FFmpegDecoderPool::mutex;
+std::deque<Ref<FFmpegDecoder>> FFmpegDecoderPool::idle_decoders;
+int FFmpegDecoderPool::max_size = 4;
+
+Ref<FFmpegDecoder> FFmpegDecoderPool::checkout(const String &key) {
+    if (key.is_empty()) {
+        return Ref<FFmpegDecoder>();
+    }
+    
+    Ref<FFmpegDecoder> decoder;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = idle_decoders.begin(); it != idle_decoders.end(); ++it) {
+            if ((*it)->get_reuse_key() == key) {
+                decoder = *it;
+                idle_decoders.erase(it);
+                break;
+            }
+        }
+    }
+    
+    // Idle decoders hold no thread reservation. One the cap has no room for
+    // is closed, the caller then opens a new one with what the cap grants.
+    if (decoder.is_valid() && !decoder->resume_from_pool()) {
+        return Ref<FFmpegDecoder>();
+    }
+    return decoder;
+}
+
+void FFmpegDecoderPool::give_back(const Ref<FFmpegDecoder> &decoder) {
+    // Never pool a decoder somebody else still holds (the caller's reference is one)
+    if (decoder.is_null() || decoder->get_reuse_key().is_empty() || decoder->get_reference_count() > 1) {
+        return;
+    }
+    if (!decoder->rewind_for_reuse()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_size <= 0) {
+        return;
+    }
+    while ((int)idle_decoders.size() >= max_size) {
+        idle_decoders.pop_front();
+    }
+    idle_decoders.push_back(decoder);
+}
+
+void FFmpegDecoderPool::set_max_size(int size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_size = MAX(0, size);
+    while ((int)idle_decoders.size() > max_size) {
+        idle_decoders.pop_front();
+    }
+}
+
+int FFmpegDecoderPool::get_max_size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return max_size;
+}
+
+int FFmpegDecoderPool::get_idle_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)idle_decoders.size();
+}
+
+void FFmpegDecoderPool::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    idle_decoders.clear();
+}
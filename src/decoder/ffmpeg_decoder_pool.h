@@ -0,0 +1,31 @@
+#ifndef FFMPEG_DECODER_POOL_H
+#define FFMPEG_DECODER_POOL_H
+
+#include "ffmpeg_decoder.h"
+
+#include <deque>
+#include <mutex>
+
+namespace godot {
+
+// Opened decoders kept after their playback ends, so the next playback of
+// the same file with the same open-time settings skips opening entirely.
+// Only decoders with a reuse key are kept, oldest are closed first.
+class FFmpegDecoderPool {
+    static std::mutex mutex;
+    static std::deque<Ref<FFmpegDecoder>> idle_decoders;
+    static int max_size;
+
+public:
+    static Ref<FFmpegDecoder> checkout(const String &key); // Null if none is idle
+    static void give_back(const Ref<FFmpegDecoder> &decoder);
+    
+    static void set_max_size(int size);
+    static int get_max_size();
+    static int get_idle_count();
+    static void clear();
+};
+
+}
+
+#endif // FFMPEG_DECODER_POOL_H
@@ -0,0 +1,228 @@
+#include "ffmpeg_filter_graph.h"
+
+#include <cstdio>
+
+extern "C" {
+    #include <libavfilter/buffersink.h>
+    #include <libavfilter/buffersrc.h>
+    #include <libavutil/hwcontext.h>
+    #include <libavutil/mem.h>
+}
+
+using namespace godot;
+
+FFmpegFilterGraph::FFmpegFilterGraph() {
+    threads = 0;
+    graph = nullptr;
+    source = nullptr;
+    sink = nullptr;
+    flushed = false;
+    build_count = 0;
+    input_width = 0;
+    input_height = 0;
+    input_format = -1;
+    input_hw_frames = nullptr;
+    download_hardware = false;
+    download_frame = av_frame_alloc();
+}
+
+FFmpegFilterGraph::~FFmpegFilterGraph() {
+    release();
+    clear_pending();
+    av_frame_free(&download_frame);
+}
+
+void FFmpegFilterGraph::set_description(const std::string &p_description) {
+    if (p_description == description) {
+        return;
+    }
+    description = p_description;
+    download_hardware = false;
+    release();
+}
+
+void FFmpegFilterGraph::set_threads(int p_threads) {
+    threads = p_threads < 0 ? 0 : p_threads;
+    release();
+}
+
+void FFmpegFilterGraph::release() {
+    // Freeing the graph frees its filters and the frames they hold
+    avfilter_graph_free(&graph);
+    source = nullptr;
+    sink = nullptr;
+    flushed = false;
+    input_width = 0;
+    input_height = 0;
+    input_format = -1;
+    av_buffer_unref(&input_hw_frames);
+}
+
+void FFmpegFilterGraph::clear_pending() {
+    for (AVFrame *pending : pending_frames) {
+        av_frame_free(&pending);
+    }
+    pending_frames.clear();
+}
+
+void FFmpegFilterGraph::reset() {
+    release();
+    clear_pending();
+}
+
+bool FFmpegFilterGraph::build(const AVFrame *frame, AVRational time_base, AVRational frame_rate) {
+    release();
+    graph = avfilter_graph_alloc();
+    if (!graph) {
+        return false;
+    }
+    graph->nb_threads = threads;
+    
+    AVRational aspect = frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : AVRational{ 1, 1 };
+    char args[256];
+    snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+             frame->width, frame->height, frame->format, time_base.num, time_base.den, aspect.num, aspect.den);
+    if (avfilter_graph_create_filter(&source, avfilter_get_by_name("buffer"), "in", args, nullptr, graph) < 0 ||
+        avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"), "out", nullptr, nullptr, graph) < 0) {
+        release();
+        return false;
+    }
+    
+    // Hardware frames stay on the GPU when every filter in the graph accepts them
+    AVBufferSrcParameters *parameters = av_buffersrc_parameters_alloc();
+    if (!parameters) {
+        release();
+        return false;
+    }
+    parameters->frame_rate = frame_rate;
+    parameters->hw_frames_ctx = frame->hw_frames_ctx;
+    int ret = av_buffersrc_parameters_set(source, parameters);
+    av_free(parameters);
+    
+    AVFilterInOut *outputs = avfilter_inout_alloc();
+    AVFilterInOut *inputs = avfilter_inout_alloc();
+    if (ret >= 0 && outputs && inputs) {
+        outputs->name = av_strdup("in");
+        outputs->filter_ctx = source;
+        outputs->pad_idx = 0;
+        outputs->next = nullptr;
+        inputs->name = av_strdup("out");
+        inputs->filter_ctx = sink;
+        inputs->pad_idx = 0;
+        inputs->next = nullptr;
+        ret = avfilter_graph_parse_ptr(graph, description.c_str(), &inputs, &outputs, nullptr);
+        if (ret >= 0) {
+            ret = avfilter_graph_config(graph, nullptr);
+        }
+    } else if (ret >= 0) {
+        ret = AVERROR(ENOMEM);
+    }
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0) {
+        release();
+        return false;
+    }
+    
+    input_width = frame->width;
+    input_height = frame->height;
+    input_format = frame->format;
+    if (frame->hw_frames_ctx) {
+        input_hw_frames = av_buffer_ref(frame->hw_frames_ctx);
+    }
+    build_count++;
+    return true;
+}
+
+bool FFmpegFilterGraph::push(const AVFrame *frame, AVRational time_base, AVRational frame_rate) {
+    if (!is_enabled() || flushed) {
+        return false;
+    }
+    
+    const AVFrame *input = frame;
+    if (frame->hw_frames_ctx && download_hardware) {
+        av_frame_unref(download_frame);
+        if (av_hwframe_transfer_data(download_frame, frame, 0) < 0) {
+            return false;
+        }
+        av_frame_copy_props(download_frame, frame);
+        input = download_frame;
+    }
+    
+    bool hw_changed = (input->hw_frames_ctx ? input->hw_frames_ctx->data : nullptr) !=
+                      (input_hw_frames ? input_hw_frames->data : nullptr);
+    if (!graph || input->width != input_width || input->height != input_height || input->format != input_format || hw_changed) {
+        if (graph) {
+            drain(time_base);
+        }
+        if (!build(input, time_base, frame_rate)) {
+            // Software filters reject hardware frames, download them from now on
+            if (input->hw_frames_ctx && !download_hardware) {
+                download_hardware = true;
+                return push(frame, time_base, frame_rate);
+            }
+            return false;
+        }
+    }
+    
+    // KEEP_REF: the graph takes its own reference, the codec's frame is left alone
+    return av_buffersrc_add_frame_flags(source, const_cast<AVFrame *>(input), AV_BUFFERSRC_FLAG_KEEP_REF) >= 0;
+}
+
+void FFmpegFilterGraph::flush() {
+    if (graph && !flushed) {
+        av_buffersrc_add_frame_flags(source, nullptr, 0);
+    }
+    flushed = true;
+}
+
+void FFmpegFilterGraph::drain(AVRational time_base) {
+    // End the old graph's input so filters holding frames back (yadif, fps) release them
+    av_buffersrc_add_frame_flags(source, nullptr, 0);
+    while (true) {
+        AVFrame *pending = av_frame_alloc();
+        if (!pending || read_sink(pending, time_base) < 0) {
+            av_frame_free(&pending);
+            break;
+        }
+        pending_frames.push_back(pending);
+    }
+}
+
+int FFmpegFilterGraph::pull(AVFrame *frame, AVRational time_base) {
+    if (!pending_frames.empty()) {
+        AVFrame *pending = pending_frames.front();
+        pending_frames.pop_front();
+        av_frame_unref(frame);
+        av_frame_move_ref(frame, pending);
+        av_frame_free(&pending);
+        return 0;
+    }
+    if (!graph) {
+        return flushed ? AVERROR_EOF : AVERROR(EAGAIN);
+    }
+    
+    av_frame_unref(frame);
+    return read_sink(frame, time_base);
+}
+
+int FFmpegFilterGraph::read_sink(AVFrame *frame, AVRational time_base) {
+    int ret = av_buffersink_get_frame(sink, frame);
+    if (ret < 0) {
+        return ret;
+    }
+    // Rate changing filters (yadif=1, fps) work in their own time base
+    if (frame->pts != AV_NOPTS_VALUE) {
+        frame->pts = av_rescale_q(frame->pts, av_buffersink_get_time_base(sink), time_base);
+    }
+    frame->best_effort_timestamp = frame->pts;
+    return 0;
+}
+
+int FFmpegFilterGraph::get_output_width() const {
+    return sink ? av_buffersink_get_w(sink) : 0;
+}
+
+int FFmpegFilterGraph::get_output_height() const {
+    return sink ? av_buffersink_get_h(sink) : 0;
+}
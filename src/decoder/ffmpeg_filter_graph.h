@@ -0,0 +1,82 @@
+#ifndef FFMPEG_FILTER_GRAPH_H
+#define FFMPEG_FILTER_GRAPH_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+extern "C" {
+    #include <libavfilter/avfilter.h>
+    #include <libavutil/frame.h>
+    #include <libavutil/rational.h>
+}
+
+namespace godot {
+
+// Optional libavfilter stage between the codec and the converter, described
+// by a filter string such as "yadif,crop=1920:800". The graph is built for
+// the first frame and rebuilt when the input size or format changes, after
+// draining what the old graph still holds. Like the converter it does not
+// depend on Godot, so the benchmark runs the same code.
+class FFmpegFilterGraph {
+    std::string description;
+    int threads;
+    
+    AVFilterGraph *graph;
+    AVFilterContext *source;
+    AVFilterContext *sink;
+    bool flushed;
+    uint64_t build_count;
+    
+    // Input the graph was built for
+    int input_width;
+    int input_height;
+    int input_format;
+    AVBufferRef *input_hw_frames;
+    
+    // Hardware frames go in as they are, unless the graph cannot take them
+    bool download_hardware;
+    AVFrame *download_frame;
+    
+    // Output of a replaced graph, pulled before the new graph's frames
+    std::deque<AVFrame *> pending_frames;
+    
+    bool build(const AVFrame *frame, AVRational time_base, AVRational frame_rate);
+    void drain(AVRational time_base);
+    int read_sink(AVFrame *frame, AVRational time_base);
+    void release();
+    void clear_pending();
+
+public:
+    FFmpegFilterGraph();
+    ~FFmpegFilterGraph();
+    
+    // Empty disables the stage, a change takes effect with the next frame
+    void set_description(const std::string &p_description);
+    const std::string &get_description() const { return description; }
+    bool is_enabled() const { return !description.empty(); }
+    void set_threads(int p_threads); // Slice threads of the graph, 0 = one per CPU core
+    int get_threads() const { return threads; }
+    
+    // The frame is referenced, not copied. False if the graph cannot be built
+    // or rejects the frame, the caller may then pass frames on unfiltered.
+    bool push(const AVFrame *frame, AVRational time_base, AVRational frame_rate);
+    void flush(); // End of input, the frames still held come out
+    bool is_flushed() const { return flushed; }
+    
+    // 0 with a frame whose pts is in time_base, AVERROR(EAGAIN) when it
+    // needs more input, AVERROR_EOF once flushed and drained
+    int pull(AVFrame *frame, AVRational time_base);
+    
+    // Drops the frames held for a seek, the graph is rebuilt with the next frame
+    void reset();
+    
+    // Output of the current graph, 0 before the first frame
+    int get_output_width() const;
+    int get_output_height() const;
+    uint64_t get_build_count() const { return build_count; }
+};
+
+}
+
+#endif // FFMPEG_FILTER_GRAPH_H
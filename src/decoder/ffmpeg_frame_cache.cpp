@@ -0,0 +1,137 @@
+#include "ffmpeg_frame_cache.h"
+
+using namespace godot;
+
+std::mutex FFmpegFrameCache::mutex;
+std::list<FFmpegFrameCache::Entry> FFmpegFrameCache::entries;
+std::map<FFmpegFrameCache::EntryId, std::list<FFmpegFrameCache::Entry>::iterator> FFmpegFrameCache::entry_map;
+std::atomic<int64_t> FFmpegFrameCache::budget(0);
+int64_t FFmpegFrameCache::used_bytes = 0;
+uint64_t FFmpegFrameCache::hits = 0;
+uint64_t FFmpegFrameCache::misses = 0;
+uint64_t FFmpegFrameCache::evictions = 0;
+
+bool FFmpegFrameCache::find(const String &key, int64_t pts, FFmpegDecoder::DecodedFrame &r_frame, int64_t &r_next_pts) {
+    if (key.is_empty() || pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entry_map.find(EntryId(key, pts));
+    if (found == entry_map.end()) {
+        misses++;
+        return false;
+    }
+    
+    entries.splice(entries.begin(), entries, found->second);
+    r_frame = found->second->frame;
+    r_next_pts = found->second->next_pts;
+    hits++;
+    return true;
+}
+
+void FFmpegFrameCache::store(const String &key, int64_t pts, const FFmpegDecoder::DecodedFrame &frame, int64_t previous_pts) {
+    if (key.is_empty() || pts == AV_NOPTS_VALUE || !is_enabled()) {
+        return;
+    }
+    int64_t size = get_frame_size(frame);
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size <= 0 || size > budget) {
+        return;
+    }
+    
+    // Link the frame decoded just before, which makes the run playable from the cache
+    if (previous_pts != AV_NOPTS_VALUE) {
+        auto previous = entry_map.find(EntryId(key, previous_pts));
+        if (previous != entry_map.end()) {
+            previous->second->next_pts = pts;
+        }
+    }
+    
+    // Another decoder of the same file may have stored it first
+    EntryId id(key, pts);
+    auto existing = entry_map.find(id);
+    if (existing != entry_map.end()) {
+        entries.splice(entries.begin(), entries, existing->second);
+        return;
+    }
+    
+    evict_to(budget - size);
+    Entry entry;
+    entry.key = key;
+    entry.pts = pts;
+    entry.next_pts = AV_NOPTS_VALUE;
+    entry.frame = frame;
+    entry.size = size;
+    entries.push_front(entry);
+    entry_map[id] = entries.begin();
+    used_bytes += size;
+}
+
+void FFmpegFrameCache::mark_end_of_stream(const String &key, int64_t pts) {
+    if (key.is_empty() || pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entry_map.find(EntryId(key, pts));
+    if (found != entry_map.end()) {
+        found->second->next_pts = END_OF_STREAM;
+    }
+}
+
+void FFmpegFrameCache::evict_to(int64_t size) {
+    while (used_bytes > MAX(size, 0) && !entries.empty()) {
+        const Entry &oldest = entries.back();
+        used_bytes -= oldest.size;
+        entry_map.erase(EntryId(oldest.key, oldest.pts));
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+int64_t FFmpegFrameCache::get_frame_size(const FFmpegDecoder::DecodedFrame &frame) {
+    int64_t size = 0;
+    for (int i = 0; i < frame.plane_count; i++) {
+        const Ref<Image> &plane = frame.planes[i];
+        if (plane.is_valid()) {
+            size += Image::get_image_data_size(plane->get_width(), plane->get_height(), plane->get_format(), false);
+        }
+    }
+    for (const Ref<Image> &crop : frame.crops) {
+        if (crop.is_valid()) {
+            size += Image::get_image_data_size(crop->get_width(), crop->get_height(), crop->get_format(), false);
+        }
+    }
+    return size;
+}
+
+void FFmpegFrameCache::set_budget(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = MAX((int64_t)0, bytes);
+    evict_to(budget);
+}
+
+int64_t FFmpegFrameCache::get_budget() {
+    return budget;
+}
+
+Dictionary FFmpegFrameCache::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Dictionary result;
+    result["hits"] = (int64_t)hits;
+    result["misses"] = (int64_t)misses;
+    result["evictions"] = (int64_t)evictions;
+    result["frames"] = (int64_t)entries.size();
+    result["bytes"] = used_bytes;
+    result["budget"] = budget.load();
+    return result;
+}
+
+void FFmpegFrameCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entry_map.clear();
+    entries.clear();
+    used_bytes = 0;
+}
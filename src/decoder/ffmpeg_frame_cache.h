@@ -0,0 +1,61 @@
+#ifndef FFMPEG_FRAME_CACHE_H
+#define FFMPEG_FRAME_CACHE_H
+
+#include "ffmpeg_decoder.h"
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace godot {
+
+// Converted frames shared by every decoder in the process, so clips and
+// frames that keep coming back are decoded once. Entries are keyed by file
+// and output settings plus pts. Each remembers the pts of the frame that
+// followed it, so a decoder can play a cached run without reading the file.
+// The last frame of a file is marked, a run then ends without a seek.
+// Least recently used frames are dropped once the byte budget is exceeded.
+class FFmpegFrameCache {
+    struct Entry {
+        String key;
+        int64_t pts;
+        int64_t next_pts; // AV_NOPTS_VALUE until the following frame is stored, END_OF_STREAM after the last
+        FFmpegDecoder::DecodedFrame frame;
+        int64_t size;
+    };
+    typedef std::pair<String, int64_t> EntryId;
+    
+    static std::mutex mutex;
+    static std::list<Entry> entries; // Most recently used first
+    static std::map<EntryId, std::list<Entry>::iterator> entry_map;
+    static std::atomic<int64_t> budget;
+    static int64_t used_bytes;
+    static uint64_t hits;
+    static uint64_t misses;
+    static uint64_t evictions;
+    static void evict_to(int64_t size);
+
+public:
+    static const int64_t END_OF_STREAM = INT64_MAX;
+    
+    static int64_t get_frame_size(const FFmpegDecoder::DecodedFrame &frame); // Bytes held by its images
+    static bool is_enabled() { return budget.load(std::memory_order_relaxed) > 0; }
+    
+    static bool find(const String &key, int64_t pts, FFmpegDecoder::DecodedFrame &r_frame, int64_t &r_next_pts);
+    static void store(const String &key, int64_t pts, const FFmpegDecoder::DecodedFrame &frame, int64_t previous_pts);
+    static void mark_end_of_stream(const String &key, int64_t pts); // No frame follows the one at pts
+    
+    static void set_budget(int64_t bytes); // 0 disables and frees everything
+    static int64_t get_budget();
+    static Dictionary get_stats(); // hits, misses, evictions, frames, bytes, budget
+    static void clear(); // Drops every frame, the counters keep running
+};
+
+}
+
+#endif // FFMPEG_FRAME_CACHE_H
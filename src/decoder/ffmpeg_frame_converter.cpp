@@ -0,0 +1,254 @@
+#include "ffmpeg_frame_converter.h"
+#include "ffmpeg_yuv_kernels.h"
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+}
+
+using namespace godot;
+
+FFmpegFrameConverter::FFmpegFrameConverter() {
+    rgb_context = nullptr;
+    plane_context = nullptr;
+    plane_frame = av_frame_alloc();
+    scaler_color_range = -1;
+    scaler_color_space = -1;
+    allocation_count = 0;
+    use_kernels = true;
+}
+
+FFmpegFrameConverter::~FFmpegFrameConverter() {
+    reset();
+    if (plane_frame) {
+        av_frame_free(&plane_frame);
+    }
+}
+
+void FFmpegFrameConverter::reset() {
+    if (rgb_context) {
+        sws_freeContext(rgb_context);
+        rgb_context = nullptr;
+    }
+    if (plane_context) {
+        sws_freeContext(plane_context);
+        plane_context = nullptr;
+    }
+    if (plane_frame) {
+        av_frame_unref(plane_frame);
+    }
+    scaler_color_range = -1;
+    scaler_color_space = -1;
+}
+
+void FFmpegFrameConverter::detect_color_properties(const AVFrame *frame, int range_override, int space_override,
+                                                   int &r_color_range, int &r_color_space) {
+    if (range_override >= 0) {
+        r_color_range = range_override;
+    } else {
+        AVPixelFormat format = (AVPixelFormat)frame->format;
+        bool jpeg_format = format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_YUVJ422P || format == AV_PIX_FMT_YUVJ444P;
+        r_color_range = (frame->color_range == AVCOL_RANGE_JPEG || jpeg_format) ? 1 : 0;
+    }
+    
+    if (space_override >= 0) {
+        r_color_space = space_override;
+        return;
+    }
+    
+    switch (frame->colorspace) {
+        case AVCOL_SPC_BT709:
+            r_color_space = 1;
+            break;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            r_color_space = 2;
+            break;
+        case AVCOL_SPC_SMPTE240M:
+            r_color_space = 3;
+            break;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+        case AVCOL_SPC_FCC:
+            r_color_space = 0;
+            break;
+        default:
+            // Untagged content: HD and above is almost always BT.709
+            r_color_space = frame->height >= 720 ? 1 : 0;
+            break;
+    }
+}
+
+bool FFmpegFrameConverter::convert_to_rgba(const AVFrame *frame, int dst_width, int dst_height, int scale_flags,
+                                           int color_range, int color_space, uint8_t *dst, int dst_linesize) {
+    return scale_to_rgba(frame->data, frame->linesize, (AVPixelFormat)frame->format, frame->width, frame->height,
+                         dst_width, dst_height, scale_flags, color_range, color_space, dst, dst_linesize);
+}
+
+bool FFmpegFrameConverter::clip_region(const AVFrame *frame, int &r_x, int &r_y, int &r_width, int &r_height) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    // Sub-byte and palette formats cannot be addressed by a plane offset
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL))) {
+        return false;
+    }
+    
+    int right = FFMIN(r_x + r_width, frame->width);
+    int bottom = FFMIN(r_y + r_height, frame->height);
+    r_x = FFMAX(0, r_x) & ~((1 << desc->log2_chroma_w) - 1);
+    r_y = FFMAX(0, r_y) & ~((1 << desc->log2_chroma_h) - 1);
+    r_width = right - r_x;
+    r_height = bottom - r_y;
+    return r_width > 0 && r_height > 0;
+}
+
+bool FFmpegFrameConverter::convert_region_to_rgba(const AVFrame *frame, int x, int y, int width, int height,
+                                                  int dst_width, int dst_height, int scale_flags,
+                                                  int color_range, int color_space, uint8_t *dst, int dst_linesize) {
+    if (!clip_region(frame, x, y, width, height)) {
+        return false;
+    }
+    
+    // Point every plane at the region origin, the scaler then sees a smaller
+    // frame with the original line strides
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    int pixel_steps[4];
+    av_image_fill_max_pixsteps(pixel_steps, nullptr, desc);
+    
+    const uint8_t *region_data[4] = {};
+    int plane_count = av_pix_fmt_count_planes(format);
+    for (int i = 0; i < plane_count && i < 4; i++) {
+        bool chroma_plane = (i == 1 || i == 2);
+        int plane_x = chroma_plane ? x >> desc->log2_chroma_w : x;
+        int plane_y = chroma_plane ? y >> desc->log2_chroma_h : y;
+        region_data[i] = frame->data[i] + (ptrdiff_t)plane_y * frame->linesize[i] + (ptrdiff_t)plane_x * pixel_steps[i];
+    }
+    
+    return scale_to_rgba(region_data, frame->linesize, format, width, height,
+                         dst_width, dst_height, scale_flags, color_range, color_space, dst, dst_linesize);
+}
+
+bool FFmpegFrameConverter::scale_to_rgba(const uint8_t *const src_data[4], const int src_linesize[4], AVPixelFormat src_format,
+                                         int src_width, int src_height, int dst_width, int dst_height, int scale_flags,
+                                         int color_range, int color_space, uint8_t *dst, int dst_linesize) {
+    // No resize: the hand-written kernels beat sws_scale's generic path
+    if (use_kernels && src_width == dst_width && src_height == dst_height &&
+        FFmpegYuvKernels::convert(src_data, src_linesize, src_format, src_width, src_height,
+                                  color_range, color_space, dst, dst_linesize)) {
+        return true;
+    }
+    
+    AVPixelFormat target_format = AV_PIX_FMT_RGBA;
+    
+    // Reuse the scaler unless the source format or size changed
+    SwsContext *previous_context = rgb_context;
+    rgb_context = sws_getCachedContext(rgb_context,
+                                       src_width, src_height, src_format,
+                                       dst_width, dst_height, target_format,
+                                       scale_flags, nullptr, nullptr, nullptr);
+    if (!rgb_context) {
+        return false;
+    }
+    if (rgb_context != previous_context) {
+        allocation_count++;
+        scaler_color_range = -1;
+        scaler_color_space = -1;
+    }
+    
+    // Apply the detected matrix and range only when they change
+    if (scaler_color_range != color_range || scaler_color_space != color_space) {
+        static const int sws_color_spaces[] = { SWS_CS_ITU601, SWS_CS_ITU709, SWS_CS_BT2020, SWS_CS_SMPTE240M };
+        const int *coefficients = sws_getCoefficients(sws_color_spaces[color_space < 0 ? 0 : (color_space > 3 ? 3 : color_space)]);
+        sws_setColorspaceDetails(rgb_context, coefficients, color_range, sws_getCoefficients(SWS_CS_DEFAULT), 1,
+                                 0, 1 << 16, 1 << 16);
+        scaler_color_range = color_range;
+        scaler_color_space = color_space;
+    }
+    
+    // Convert straight into the destination, no intermediate copy
+    uint8_t *dst_data[4] = { dst, nullptr, nullptr, nullptr };
+    int dst_linesizes[4] = { dst_linesize, 0, 0, 0 };
+    sws_scale(rgb_context, src_data, src_linesize, 0, src_height, dst_data, dst_linesizes);
+    return true;
+}
+
+const AVFrame *FFmpegFrameConverter::prepare_planes(const AVFrame *frame, int dst_width, int dst_height, int scale_flags,
+                                                    PlaneLayout &r_layout) {
+    const AVFrame *planar_frame = frame;
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    bool resize = dst_width != frame->width || dst_height != frame->height;
+    
+    switch (resize ? AV_PIX_FMT_NONE : format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_YUVA420P:
+        case AV_PIX_FMT_YUVA422P:
+        case AV_PIX_FMT_YUVA444P:
+        case AV_PIX_FMT_NV12:
+            break;
+        default: {
+            // High bit depth and packed formats are brought down to 8-bit planes,
+            // resizing happens in the same pass
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+            bool source_alpha = desc && (desc->flags & AV_PIX_FMT_FLAG_ALPHA);
+            AVPixelFormat target_format = source_alpha ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P;
+            
+            SwsContext *previous_context = plane_context;
+            plane_context = sws_getCachedContext(plane_context,
+                                                 frame->width, frame->height, format,
+                                                 dst_width, dst_height, target_format,
+                                                 scale_flags, nullptr, nullptr, nullptr);
+            if (!plane_context) {
+                return nullptr;
+            }
+            if (plane_context != previous_context) {
+                allocation_count++;
+            }
+            
+            if (plane_frame->width != dst_width || plane_frame->height != dst_height ||
+                plane_frame->format != target_format) {
+                av_frame_unref(plane_frame);
+                plane_frame->width = dst_width;
+                plane_frame->height = dst_height;
+                plane_frame->format = target_format;
+                if (av_frame_get_buffer(plane_frame, 0) < 0) {
+                    return nullptr;
+                }
+                allocation_count++;
+            }
+            
+            sws_scale(plane_context, frame->data, frame->linesize, 0, frame->height,
+                      plane_frame->data, plane_frame->linesize);
+            planar_frame = plane_frame;
+            format = target_format;
+            break;
+        }
+    }
+    
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    int chroma_width = AV_CEIL_RSHIFT(planar_frame->width, desc->log2_chroma_w);
+    int chroma_height = AV_CEIL_RSHIFT(planar_frame->height, desc->log2_chroma_h);
+    
+    r_layout = PlaneLayout();
+    r_layout.interleaved_chroma = format == AV_PIX_FMT_NV12;
+    r_layout.count = av_pix_fmt_count_planes(format);
+    for (int i = 0; i < r_layout.count; i++) {
+        bool chroma_plane = (i == 1 || i == 2);
+        r_layout.width[i] = chroma_plane ? chroma_width : planar_frame->width;
+        r_layout.height[i] = chroma_plane ? chroma_height : planar_frame->height;
+        r_layout.channels[i] = (r_layout.interleaved_chroma && i == 1) ? 2 : 1;
+    }
+    
+    return planar_frame;
+}
+
+void FFmpegFrameConverter::copy_plane(const AVFrame *planar_frame, const PlaneLayout &layout, int plane, uint8_t *dst) {
+    // Strip the decoder's line padding while copying
+    int row_bytes = layout.width[plane] * layout.channels[plane];
+    av_image_copy_plane(dst, row_bytes, planar_frame->data[plane], planar_frame->linesize[plane],
+                        row_bytes, layout.height[plane]);
+}
@@ -0,0 +1,86 @@
+#ifndef FFMPEG_FRAME_CONVERTER_H
+#define FFMPEG_FRAME_CONVERTER_H
+
+#include <cstdint>
+
+extern "C" {
+    #include <libavutil/frame.h>
+    #include <libavutil/pixfmt.h>
+    #include <libswscale/swscale.h>
+}
+
+namespace godot {
+
+// Pixel conversion of decoded frames into caller-owned buffers. It does not
+// depend on Godot so the headless benchmark runs exactly the same code.
+class FFmpegFrameConverter {
+public:
+    static const int MAX_PLANES = 4;
+    
+    // Planes handed out by prepare_planes(), without line padding
+    struct PlaneLayout {
+        int count = 0;
+        bool interleaved_chroma = false; // NV12: plane 1 holds U and V
+        int width[MAX_PLANES] = {};
+        int height[MAX_PLANES] = {};
+        int channels[MAX_PLANES] = {};
+    };
+
+private:
+    SwsContext *rgb_context;
+    SwsContext *plane_context;
+    AVFrame *plane_frame;
+    int scaler_color_range;
+    int scaler_color_space;
+    uint64_t allocation_count;
+    bool use_kernels;
+    
+    bool scale_to_rgba(const uint8_t *const src_data[4], const int src_linesize[4], AVPixelFormat src_format,
+                       int src_width, int src_height, int dst_width, int dst_height, int scale_flags,
+                       int color_range, int color_space, uint8_t *dst, int dst_linesize);
+
+public:
+    FFmpegFrameConverter();
+    ~FFmpegFrameConverter();
+    
+    // Frees the scalers, the next conversion sets them up again
+    void reset();
+    
+    // 0 = TV range / 1 = full range, 0-3 = BT.601 / BT.709 / BT.2020 / SMPTE-240M.
+    // Overrides of -1 follow the frame.
+    static void detect_color_properties(const AVFrame *frame, int range_override, int space_override,
+                                        int &r_color_range, int &r_color_space);
+    
+    // Converts to RGBA of the given size, opaque sources get alpha 255. RGBA is
+    // what the GPU stores, so uploading it needs no further conversion.
+    // Resizing happens in the same sws_scale pass, scale_flags are SWS_* flags.
+    // Without resizing, common YUV formats go through FFmpegYuvKernels instead.
+    bool convert_to_rgba(const AVFrame *frame, int dst_width, int dst_height, int scale_flags,
+                         int color_range, int color_space, uint8_t *dst, int dst_linesize);
+    
+    // Same as convert_to_rgba() but reads only a sub-rectangle of the frame,
+    // the rest is never touched. The origin is moved down to the chroma
+    // subsampling grid, clip_region() gives the rectangle actually read.
+    bool convert_region_to_rgba(const AVFrame *frame, int x, int y, int width, int height,
+                                int dst_width, int dst_height, int scale_flags,
+                                int color_range, int color_space, uint8_t *dst, int dst_linesize);
+    static bool clip_region(const AVFrame *frame, int &r_x, int &r_y, int &r_width, int &r_height);
+    
+    // Native 8-bit YUV planes at the requested size are used as they are,
+    // anything else is scaled/converted to yuv420p/yuva420p first. The
+    // returned frame stays valid until the next call.
+    const AVFrame *prepare_planes(const AVFrame *frame, int dst_width, int dst_height, int scale_flags,
+                                  PlaneLayout &r_layout);
+    static void copy_plane(const AVFrame *planar_frame, const PlaneLayout &layout, int plane, uint8_t *dst);
+    
+    // Same-size conversions through FFmpegYuvKernels when the CPU allows it, on by default
+    void set_use_kernels(bool enabled) { use_kernels = enabled; }
+    bool get_use_kernels() const { return use_kernels; }
+    
+    // Scaler and intermediate buffer (re)allocations
+    uint64_t get_allocation_count() const { return allocation_count; }
+};
+
+}
+
+#endif // FFMPEG_FRAME_CONVERTER_H
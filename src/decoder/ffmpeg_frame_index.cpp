@@ -0,0 +1,222 @@
+#include "ffmpeg_frame_index.h"
+
+#include <godot_cpp/classes/dir_access.hpp>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace godot;
+
+static const uint32_t INDEX_MAGIC = 0x5849594C; // "LYIX"
+static const uint32_t INDEX_VERSION = 1;
+static const char *INDEX_DIRECTORY = "user://lymo_ffmpeg/index";
+
+bool FFmpegFrameIndex::build(AVFormatContext *format_context, int stream_index, const std::atomic<bool> *cancel) {
+    clear();
+    
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        return false;
+    }
+    
+    bool cancelled = false;
+    while (av_read_frame(format_context, packet) >= 0) {
+        if (packet->stream_index == stream_index) {
+            // Containers without pts (AVI) still carry a usable dts
+            int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            if (pts != AV_NOPTS_VALUE) {
+                entries.push_back({ pts, packet->pos, (packet->flags & AV_PKT_FLAG_KEY) != 0 });
+            }
+        }
+        av_packet_unref(packet);
+        
+        if (cancel && cancel->load()) {
+            cancelled = true;
+            break;
+        }
+    }
+    av_packet_free(&packet);
+    
+    if (cancelled) {
+        clear();
+        return false;
+    }
+    
+    finalize();
+    return !is_empty();
+}
+
+void FFmpegFrameIndex::finalize() {
+    sorted_pts.clear();
+    keyframe_pts.clear();
+    sorted_pts.reserve(entries.size());
+    
+    for (const Entry &entry : entries) {
+        sorted_pts.push_back(entry.pts);
+        if (entry.keyframe) {
+            keyframe_pts.push_back(entry.pts);
+        }
+    }
+    
+    std::sort(sorted_pts.begin(), sorted_pts.end());
+    std::sort(keyframe_pts.begin(), keyframe_pts.end());
+    
+    // An index without keyframes cannot drive seeking
+    if (keyframe_pts.empty()) {
+        clear();
+    }
+}
+
+void FFmpegFrameIndex::clear() {
+    entries.clear();
+    sorted_pts.clear();
+    keyframe_pts.clear();
+}
+
+int64_t FFmpegFrameIndex::get_frame_pts(int64_t frame_number) const {
+    if (frame_number < 0 || frame_number >= (int64_t)sorted_pts.size()) {
+        return AV_NOPTS_VALUE;
+    }
+    return sorted_pts[frame_number];
+}
+
+int64_t FFmpegFrameIndex::find_frame_number(int64_t pts) const {
+    auto it = std::upper_bound(sorted_pts.begin(), sorted_pts.end(), pts);
+    if (it == sorted_pts.begin()) {
+        return 0;
+    }
+    return (int64_t)(it - sorted_pts.begin()) - 1;
+}
+
+int64_t FFmpegFrameIndex::find_keyframe_pts(int64_t pts) const {
+    if (keyframe_pts.empty()) {
+        return AV_NOPTS_VALUE;
+    }
+    
+    auto it = std::upper_bound(keyframe_pts.begin(), keyframe_pts.end(), pts);
+    if (it == keyframe_pts.begin()) {
+        return keyframe_pts.front();
+    }
+    return *(it - 1);
+}
+
+String FFmpegFrameIndex::get_sidecar_path(const String &source_path) {
+    return String(INDEX_DIRECTORY) + "/" + source_path.md5_text() + ".idx";
+}
+
+// Sidecar layout: a fixed header followed by one 9-byte record per packet
+// (pts delta as int32, byte position delta as int32, keyframe flag).
+// Deltas that do not fit 32 bits make the index too irregular to cache.
+
+bool FFmpegFrameIndex::save(const String &sidecar_path, uint64_t file_size, uint64_t modified_time) const {
+    if (entries.empty()) {
+        return false;
+    }
+    
+    const int64_t header_size = 4 + 4 + 8 + 8 + 8 + 8 + 8;
+    const int64_t record_size = 9;
+    PackedByteArray buffer;
+    buffer.resize(header_size + (int64_t)entries.size() * record_size);
+    uint8_t *dst = buffer.ptrw();
+    
+    auto write = [&dst](const void *value, size_t size) {
+        memcpy(dst, value, size);
+        dst += size;
+    };
+    
+    uint64_t entry_count = entries.size();
+    write(&INDEX_MAGIC, 4);
+    write(&INDEX_VERSION, 4);
+    write(&file_size, 8);
+    write(&modified_time, 8);
+    write(&entry_count, 8);
+    write(&entries.front().pts, 8);
+    write(&entries.front().pos, 8);
+    
+    int64_t previous_pts = entries.front().pts;
+    int64_t previous_pos = entries.front().pos;
+    for (const Entry &entry : entries) {
+        int64_t pts_delta = entry.pts - previous_pts;
+        int64_t pos_delta = entry.pos - previous_pos;
+        if (pts_delta != (int32_t)pts_delta || pos_delta != (int32_t)pos_delta) {
+            return false;
+        }
+        
+        int32_t packed_pts = (int32_t)pts_delta;
+        int32_t packed_pos = (int32_t)pos_delta;
+        uint8_t flags = entry.keyframe ? 1 : 0;
+        write(&packed_pts, 4);
+        write(&packed_pos, 4);
+        write(&flags, 1);
+        
+        previous_pts = entry.pts;
+        previous_pos = entry.pos;
+    }
+    
+    DirAccess::make_dir_recursive_absolute(INDEX_DIRECTORY);
+    Ref<FileAccess> file = FileAccess::open(sidecar_path, FileAccess::WRITE);
+    if (file.is_null()) {
+        return false;
+    }
+    
+    file->store_buffer(buffer);
+    return true;
+}
+
+bool FFmpegFrameIndex::load(const String &sidecar_path, uint64_t file_size, uint64_t modified_time) {
+    clear();
+    
+    if (!FileAccess::file_exists(sidecar_path)) {
+        return false;
+    }
+    
+    PackedByteArray buffer = FileAccess::get_file_as_bytes(sidecar_path);
+    const int64_t header_size = 4 + 4 + 8 + 8 + 8 + 8 + 8;
+    const int64_t record_size = 9;
+    if (buffer.size() < header_size) {
+        return false;
+    }
+    
+    const uint8_t *src = buffer.ptr();
+    auto read = [&src](void *value, size_t size) {
+        memcpy(value, src, size);
+        src += size;
+    };
+    
+    uint32_t magic, version;
+    uint64_t stored_size, stored_time, entry_count;
+    int64_t pts, pos;
+    read(&magic, 4);
+    read(&version, 4);
+    read(&stored_size, 8);
+    read(&stored_time, 8);
+    read(&entry_count, 8);
+    read(&pts, 8);
+    read(&pos, 8);
+    
+    // A stale sidecar belongs to an older version of the file
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || stored_size != file_size || stored_time != modified_time) {
+        return false;
+    }
+    if (buffer.size() != header_size + (int64_t)entry_count * record_size) {
+        return false;
+    }
+    
+    entries.reserve(entry_count);
+    for (uint64_t i = 0; i < entry_count; i++) {
+        int32_t pts_delta, pos_delta;
+        uint8_t flags;
+        read(&pts_delta, 4);
+        read(&pos_delta, 4);
+        read(&flags, 1);
+        
+        pts += pts_delta;
+        pos += pos_delta;
+        entries.push_back({ pts, pos, (flags & 1) != 0 });
+    }
+    
+    finalize();
+    return !is_empty();
+}
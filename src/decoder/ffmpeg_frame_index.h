@@ -0,0 +1,59 @@
+#ifndef FFMPEG_FRAME_INDEX_H
+#define FFMPEG_FRAME_INDEX_H
+
+#include <godot_cpp/variant/string.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+namespace godot {
+
+// Packet index of one video stream: pts, byte position and keyframe flag of
+// every packet, plus the presentation order used to map frame numbers to pts.
+// All timestamps are in the stream time base.
+class FFmpegFrameIndex {
+public:
+    struct Entry {
+        int64_t pts;
+        int64_t pos;
+        bool keyframe;
+    };
+    
+private:
+    std::vector<Entry> entries;      // Demux order
+    std::vector<int64_t> sorted_pts; // Presentation order
+    std::vector<int64_t> keyframe_pts; // Sorted
+    
+    void finalize();
+    
+public:
+    // Demuxes the whole stream without decoding. Returns false if cancelled
+    // or if the container carries no usable timestamps.
+    bool build(AVFormatContext *format_context, int stream_index, const std::atomic<bool> *cancel = nullptr);
+    
+    // Sidecar cache, keyed by the size and modification time of the source
+    bool load(const String &sidecar_path, uint64_t file_size, uint64_t modified_time);
+    bool save(const String &sidecar_path, uint64_t file_size, uint64_t modified_time) const;
+    static String get_sidecar_path(const String &source_path);
+    
+    void clear();
+    bool is_empty() const { return sorted_pts.empty(); }
+    int64_t get_frame_count() const { return (int64_t)sorted_pts.size(); }
+    const std::vector<int64_t> &get_presentation_pts() const { return sorted_pts; }
+    
+    // pts of the Nth frame in presentation order, AV_NOPTS_VALUE if out of range
+    int64_t get_frame_pts(int64_t frame_number) const;
+    // Presentation index of the last frame at or before pts
+    int64_t find_frame_number(int64_t pts) const;
+    // Last keyframe at or before pts, the first keyframe if pts precedes them all
+    int64_t find_keyframe_pts(int64_t pts) const;
+};
+
+}
+
+#endif // FFMPEG_FRAME_INDEX_H
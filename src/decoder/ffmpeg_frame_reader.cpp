@@ -0,0 +1,213 @@
+#include "ffmpeg_frame_reader.h"
+
+using namespace godot;
+
+FFmpegFrameReader::Scope::Scope(Listener *p_listener, Stage p_stage) {
+    listener = (p_listener && p_listener->is_timing()) ? p_listener : nullptr;
+    stage = p_stage;
+    if (listener) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+FFmpegFrameReader::Scope::~Scope() {
+    if (listener) {
+        listener->record_stage(stage, std::chrono::steady_clock::now() - start);
+    }
+}
+
+FFmpegFrameReader::FFmpegFrameReader() {
+    format_context = nullptr;
+    codec_context = nullptr;
+    stream = nullptr;
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    filtered_frame = av_frame_alloc();
+    filter_failed = false;
+    input_exhausted = false;
+    skip_until_pts = AV_NOPTS_VALUE;
+    skipped_frames = 0;
+    listener = nullptr;
+}
+
+FFmpegFrameReader::~FFmpegFrameReader() {
+    av_frame_free(&filtered_frame);
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+}
+
+void FFmpegFrameReader::attach(AVFormatContext *p_format_context, AVCodecContext *p_codec_context, int p_stream_index) {
+    format_context = p_format_context;
+    codec_context = p_codec_context;
+    stream = format_context && p_stream_index >= 0 ? format_context->streams[p_stream_index] : nullptr;
+    
+    av_packet_unref(packet);
+    av_frame_unref(frame);
+    av_frame_unref(filtered_frame);
+    filter_graph.reset();
+    filter_failed = false;
+    input_exhausted = false;
+    skip_until_pts = AV_NOPTS_VALUE;
+}
+
+void FFmpegFrameReader::set_filter(const std::string &p_description) {
+    filter_graph.set_description(p_description);
+    filter_failed = false;
+}
+
+int FFmpegFrameReader::read_next_packet() {
+    int ret;
+    {
+        Scope scope(listener, STAGE_READ);
+        ret = av_read_frame(format_context, packet);
+    }
+    if (ret >= 0 && listener) {
+        listener->count_read_bytes(packet->size);
+    }
+    return ret;
+}
+
+bool FFmpegFrameReader::skip_before_target(int64_t pts) {
+    if (skip_until_pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+    if (pts != AV_NOPTS_VALUE && pts < skip_until_pts) {
+        skipped_frames++;
+        return true;
+    }
+    skip_until_pts = AV_NOPTS_VALUE;
+    return false;
+}
+
+AVFrame *FFmpegFrameReader::read_frame() {
+    if (!codec_context || !stream) {
+        return nullptr;
+    }
+    
+    bool filtering = filter_graph.is_enabled() && !filter_failed;
+    while (true) {
+        // Frames the filter graph already produced come out before anything is decoded
+        if (filtering) {
+            int filter_ret;
+            {
+                Scope scope(listener, STAGE_FILTER);
+                filter_ret = filter_graph.pull(filtered_frame, stream->time_base);
+            }
+            if (filter_ret == 0) {
+                return filtered_frame;
+            }
+            if (filter_ret != AVERROR(EAGAIN)) {
+                return nullptr;
+            }
+        }
+        
+        // Drain the codec first: with frame threading one packet can release
+        // several frames, and nothing may be sent until they are received
+        int ret;
+        {
+            Scope scope(listener, STAGE_DECODE);
+            ret = avcodec_receive_frame(codec_context, frame);
+        }
+        if (ret == 0) {
+            if (listener) {
+                listener->count_decoded_frame();
+            }
+            
+            // Frames before an exact seek target are dropped before any transfer or conversion
+            if (skip_before_target(frame->best_effort_timestamp)) {
+                continue;
+            }
+            
+            if (filtering) {
+                bool pushed;
+                {
+                    Scope scope(listener, STAGE_FILTER);
+                    pushed = filter_graph.push(frame, stream->time_base, av_guess_frame_rate(format_context, stream, frame));
+                }
+                if (pushed) {
+                    continue;
+                }
+                filter_failed = true;
+                filtering = false;
+                filter_graph.reset();
+            }
+            return frame;
+        }
+        if (ret == AVERROR_EOF && filtering) {
+            // The graph may still hold frames, e.g. the last field of a deinterlacer
+            filter_graph.flush();
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN) || input_exhausted) {
+            return nullptr;
+        }
+        
+        // Feed the next video packet, or enter draining mode at end of file
+        if (read_next_packet() < 0) {
+            input_exhausted = true;
+            avcodec_send_packet(codec_context, nullptr);
+            continue;
+        }
+        if (packet->stream_index == stream->index) {
+            // A corrupt packet is skipped, the next keyframe recovers
+            Scope scope(listener, STAGE_DECODE);
+            avcodec_send_packet(codec_context, packet);
+        }
+        av_packet_unref(packet);
+    }
+}
+
+AVPacket *FFmpegFrameReader::read_packet() {
+    av_packet_unref(packet);
+    if (!stream) {
+        return nullptr;
+    }
+    
+    while (!input_exhausted) {
+        if (read_next_packet() < 0) {
+            input_exhausted = true;
+            return nullptr;
+        }
+        if (packet->stream_index != stream->index) {
+            av_packet_unref(packet);
+            continue;
+        }
+        if (listener) {
+            listener->count_decoded_frame();
+        }
+        
+        // Only intra-only codecs are unwrapped, so an exact seek just skips packets
+        if (skip_before_target(packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts)) {
+            av_packet_unref(packet);
+            continue;
+        }
+        return packet;
+    }
+    return nullptr;
+}
+
+int64_t FFmpegFrameReader::get_frame_duration(const AVFrame *p_frame) const {
+    if (p_frame == filtered_frame) {
+        return 0;
+    }
+    // AVFrame::duration replaced pkt_duration in FFmpeg 5.1
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 30, 100)
+    return p_frame->duration;
+#else
+    return p_frame->pkt_duration;
+#endif
+}
+
+void FFmpegFrameReader::reset(int64_t p_skip_until_pts) {
+    if (codec_context) {
+        avcodec_flush_buffers(codec_context);
+    }
+    filter_graph.reset();
+    input_exhausted = false;
+    skip_until_pts = p_skip_until_pts;
+}
+
+void FFmpegFrameReader::finish() {
+    reset();
+    input_exhausted = true;
+}
@@ -0,0 +1,105 @@
+#ifndef FFMPEG_FRAME_READER_H
+#define FFMPEG_FRAME_READER_H
+
+#include "ffmpeg_filter_graph.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+}
+
+namespace godot {
+
+// The demux, decode and filter loop behind FFmpegDecoder::decode_frame():
+// receive-first decoding, the optional filter stage and the frames dropped
+// before an exact seek target. Like the converter it does not depend on
+// Godot, so the headless benchmark times the loop the extension runs.
+class FFmpegFrameReader {
+public:
+    enum Stage {
+        STAGE_READ,
+        STAGE_DECODE,
+        STAGE_FILTER,
+    };
+    
+    // Timings and counters, FFmpegDecoder forwards them to its FFmpegStats
+    class Listener {
+    public:
+        virtual ~Listener() {}
+        virtual bool is_timing() = 0;
+        virtual void record_stage(Stage stage, std::chrono::steady_clock::duration elapsed) = 0;
+        virtual void count_decoded_frame() = 0;
+        virtual void count_read_bytes(int64_t bytes) = 0;
+    };
+
+private:
+    AVFormatContext *format_context;
+    AVCodecContext *codec_context;
+    AVStream *stream;
+    AVPacket *packet;
+    AVFrame *frame;
+    AVFrame *filtered_frame;
+    FFmpegFilterGraph filter_graph;
+    bool filter_failed;
+    bool input_exhausted;
+    int64_t skip_until_pts;
+    uint64_t skipped_frames;
+    Listener *listener;
+    
+    class Scope {
+        Listener *listener;
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    
+    public:
+        Scope(Listener *p_listener, Stage p_stage);
+        ~Scope();
+    };
+    
+    int read_next_packet();
+    bool skip_before_target(int64_t pts);
+
+public:
+    FFmpegFrameReader();
+    ~FFmpegFrameReader();
+    
+    // The contexts stay with the caller, attach(nullptr, nullptr, -1) before freeing them
+    void attach(AVFormatContext *p_format_context, AVCodecContext *p_codec_context, int p_stream_index);
+    void set_listener(Listener *p_listener) { listener = p_listener; }
+    
+    // A graph that cannot take a frame is dropped, frames then pass
+    // unfiltered until the description changes
+    void set_filter(const std::string &p_description);
+    FFmpegFilterGraph &get_filter_graph() { return filter_graph; }
+    const FFmpegFilterGraph &get_filter_graph() const { return filter_graph; }
+    bool has_filter_failed() const { return filter_failed; }
+    
+    // Next frame of the stream, null once it is drained or on an error.
+    // The frame is reused by the next call.
+    AVFrame *read_frame();
+    // Next packet of the stream for codecs that are unwrapped rather than
+    // decoded (HAP passthrough). The packet is reused by the next call.
+    AVPacket *read_packet();
+    
+    // Duration of a frame from read_frame() in the stream time base, 0 when
+    // unknown. Rate changing filters leave the source durations behind, so
+    // filtered frames have none.
+    int64_t get_frame_duration(const AVFrame *p_frame) const;
+    
+    // After av_seek_frame(): drops what the codec and the filter still hold,
+    // frames before skip_until_pts are then dropped before they are returned
+    void reset(int64_t p_skip_until_pts = AV_NOPTS_VALUE);
+    // Nothing more is read, e.g. after a failed seek
+    void finish();
+    bool is_input_exhausted() const { return input_exhausted; }
+    uint64_t get_skipped_frames() const { return skipped_frames; } // Dropped before seek targets
+    void clear_skipped_frames() { skipped_frames = 0; }
+};
+
+}
+
+#endif // FFMPEG_FRAME_READER_H
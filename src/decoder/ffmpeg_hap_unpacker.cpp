@@ -0,0 +1,343 @@
+#include "ffmpeg_hap_unpacker.h"
+
+#include <cstring>
+
+using namespace godot;
+
+namespace {
+
+// Section types of the HAP container: the top nibble of a texture section
+// names its second-stage compressor, the bottom nibble its texture format
+const int SECTION_COMPRESSOR_NONE = 0xA0;
+const int SECTION_COMPRESSOR_SNAPPY = 0xB0;
+const int SECTION_COMPRESSOR_COMPLEX = 0xC0;
+const int SECTION_MULTIPLE_IMAGES = 0x0D;
+const int SECTION_DECODE_INSTRUCTIONS = 0x01;
+const int SECTION_CHUNK_COMPRESSORS = 0x02;
+const int SECTION_CHUNK_SIZES = 0x03;
+const int SECTION_CHUNK_OFFSETS = 0x04;
+const int CHUNK_NONE = 0x0A;
+const int CHUNK_SNAPPY = 0x0B;
+
+uint32_t read_u32(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// A 24-bit length and a type, or a zero length followed by a 32-bit one
+bool read_section(const uint8_t *data, size_t size, size_t &r_header, size_t &r_length, int &r_type) {
+    if (size < 4) {
+        return false;
+    }
+    r_length = (size_t)data[0] | ((size_t)data[1] << 8) | ((size_t)data[2] << 16);
+    r_type = data[3];
+    r_header = 4;
+    if (r_length == 0) {
+        if (size < 8) {
+            return false;
+        }
+        r_length = read_u32(data + 4);
+        r_header = 8;
+    }
+    return r_length <= size - r_header;
+}
+
+bool read_varint(const uint8_t *src, size_t src_size, size_t &r_value, size_t &r_bytes) {
+    size_t value = 0;
+    for (size_t i = 0; i < 5 && i < src_size; i++) {
+        value |= (size_t)(src[i] & 0x7F) << (7 * i);
+        if (!(src[i] & 0x80)) {
+            r_value = value;
+            r_bytes = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+FFmpegHapUnpacker::TextureFormat get_texture_format(int type) {
+    switch (type & 0x0F) {
+        case 0x0B:
+            return FFmpegHapUnpacker::TEXTURE_DXT1;
+        case 0x0E:
+            return FFmpegHapUnpacker::TEXTURE_DXT5;
+        case 0x0F:
+            return FFmpegHapUnpacker::TEXTURE_YCOCG_DXT5;
+        case 0x01:
+            return FFmpegHapUnpacker::TEXTURE_RGTC1;
+        case 0x0C:
+            return FFmpegHapUnpacker::TEXTURE_BPTC;
+        default:
+            return FFmpegHapUnpacker::TEXTURE_NONE;
+    }
+}
+
+}
+
+bool FFmpegHapUnpacker::parse(const uint8_t *data, size_t size) {
+    texture_count = 0;
+    size_t header, length;
+    int type;
+    if (!data || !read_section(data, size, header, length, type)) {
+        return false;
+    }
+    
+    // HAP Q Alpha: a colour and an alpha texture, each a complete section
+    if (type == SECTION_MULTIPLE_IMAGES) {
+        const uint8_t *section = data + header;
+        size_t remaining = length;
+        while (remaining > 0 && texture_count < MAX_TEXTURES) {
+            size_t inner_header, inner_length;
+            int inner_type;
+            if (!read_section(section, remaining, inner_header, inner_length, inner_type) ||
+                !parse_texture(section + inner_header, inner_length, inner_type)) {
+                texture_count = 0;
+                return false;
+            }
+            section += inner_header + inner_length;
+            remaining -= inner_header + inner_length;
+        }
+        return texture_count > 0;
+    }
+    
+    return parse_texture(data + header, length, type);
+}
+
+bool FFmpegHapUnpacker::parse_frame(const uint8_t *data, size_t size, int width, int height) {
+    if (!parse(data, size)) {
+        return false;
+    }
+    for (int i = 0; i < texture_count; i++) {
+        size_t texture_size = get_texture_size(textures[i].format, width, height);
+        if (texture_size == 0 || texture_size != textures[i].unpacked_size) {
+            texture_count = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FFmpegHapUnpacker::parse_texture(const uint8_t *data, size_t size, int type) {
+    TextureFormat format = get_texture_format(type);
+    if (format == TEXTURE_NONE || texture_count >= MAX_TEXTURES) {
+        return false;
+    }
+    
+    int index = texture_count;
+    chunks[index].clear();
+    Chunk chunk;
+    chunk.data = data;
+    chunk.size = size;
+    switch (type & 0xF0) {
+        case SECTION_COMPRESSOR_NONE:
+            chunk.unpacked_size = size;
+            chunks[index].push_back(chunk);
+            break;
+        case SECTION_COMPRESSOR_SNAPPY:
+            chunk.snappy = true;
+            if (!get_snappy_length(data, size, chunk.unpacked_size)) {
+                return false;
+            }
+            chunks[index].push_back(chunk);
+            break;
+        case SECTION_COMPRESSOR_COMPLEX:
+            if (!parse_chunks(data, size, index)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    
+    textures[index].format = format;
+    textures[index].unpacked_size = 0;
+    for (const Chunk &parsed : chunks[index]) {
+        textures[index].unpacked_size += parsed.unpacked_size;
+    }
+    texture_count++;
+    return true;
+}
+
+bool FFmpegHapUnpacker::parse_chunks(const uint8_t *data, size_t size, int texture) {
+    // Decode instructions come first, the chunks follow them
+    size_t header, length;
+    int type;
+    if (!read_section(data, size, header, length, type) || type != SECTION_DECODE_INSTRUCTIONS) {
+        return false;
+    }
+    const uint8_t *instructions = data + header;
+    size_t instructions_size = length;
+    const uint8_t *frame_data = data + header + length;
+    size_t frame_size = size - header - length;
+    
+    const uint8_t *compressors = nullptr;
+    const uint8_t *sizes = nullptr;
+    const uint8_t *offsets = nullptr;
+    size_t compressor_count = 0, size_count = 0, offset_count = 0;
+    while (instructions_size > 0) {
+        if (!read_section(instructions, instructions_size, header, length, type)) {
+            return false;
+        }
+        const uint8_t *table = instructions + header;
+        if (type == SECTION_CHUNK_COMPRESSORS) {
+            compressors = table;
+            compressor_count = length;
+        } else if (type == SECTION_CHUNK_SIZES) {
+            sizes = table;
+            size_count = length / 4;
+        } else if (type == SECTION_CHUNK_OFFSETS) {
+            offsets = table;
+            offset_count = length / 4;
+        }
+        instructions += header + length;
+        instructions_size -= header + length;
+    }
+    if (!compressors || !sizes || compressor_count == 0 || compressor_count != size_count ||
+        (offsets && offset_count != size_count)) {
+        return false;
+    }
+    
+    // Without an offset table the chunks are stored back to back
+    size_t position = 0;
+    for (size_t i = 0; i < compressor_count; i++) {
+        size_t chunk_size = read_u32(sizes + i * 4);
+        size_t offset = offsets ? read_u32(offsets + i * 4) : position;
+        if (offset > frame_size || chunk_size > frame_size - offset) {
+            return false;
+        }
+        
+        Chunk chunk;
+        chunk.data = frame_data + offset;
+        chunk.size = chunk_size;
+        if (compressors[i] == CHUNK_SNAPPY) {
+            chunk.snappy = true;
+            if (!get_snappy_length(chunk.data, chunk.size, chunk.unpacked_size)) {
+                return false;
+            }
+        } else if (compressors[i] == CHUNK_NONE) {
+            chunk.unpacked_size = chunk_size;
+        } else {
+            return false;
+        }
+        chunks[texture].push_back(chunk);
+        position = offset + chunk_size;
+    }
+    return true;
+}
+
+bool FFmpegHapUnpacker::unpack(int index, uint8_t *dst, size_t dst_size) const {
+    if (index < 0 || index >= texture_count || dst_size != textures[index].unpacked_size) {
+        return false;
+    }
+    
+    for (const Chunk &chunk : chunks[index]) {
+        if (chunk.snappy) {
+            if (!decompress_snappy(chunk.data, chunk.size, dst, chunk.unpacked_size)) {
+                return false;
+            }
+        } else {
+            memcpy(dst, chunk.data, chunk.size);
+        }
+        dst += chunk.unpacked_size;
+    }
+    return true;
+}
+
+size_t FFmpegHapUnpacker::get_texture_size(TextureFormat format, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case TEXTURE_DXT1:
+        case TEXTURE_RGTC1:
+            return blocks * 8;
+        case TEXTURE_DXT5:
+        case TEXTURE_YCOCG_DXT5:
+        case TEXTURE_BPTC:
+            return blocks * 16;
+        default:
+            return 0;
+    }
+}
+
+bool FFmpegHapUnpacker::get_snappy_length(const uint8_t *src, size_t src_size, size_t &r_length) {
+    size_t bytes;
+    return read_varint(src, src_size, r_length, bytes);
+}
+
+bool FFmpegHapUnpacker::decompress_snappy(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+    size_t length, position;
+    if (!read_varint(src, src_size, length, position) || length != dst_size) {
+        return false;
+    }
+    
+    size_t written = 0;
+    while (position < src_size) {
+        uint8_t tag = src[position++];
+        size_t copy_length, offset;
+        switch (tag & 3) {
+            case 0: {
+                // Literal, lengths above 60 follow the tag in 1-4 bytes
+                size_t literal_length = tag >> 2;
+                if (literal_length >= 60) {
+                    size_t bytes = literal_length - 59;
+                    if (src_size - position < bytes) {
+                        return false;
+                    }
+                    literal_length = 0;
+                    for (size_t i = 0; i < bytes; i++) {
+                        literal_length |= (size_t)src[position + i] << (8 * i);
+                    }
+                    position += bytes;
+                }
+                literal_length++;
+                if (literal_length > src_size - position || literal_length > dst_size - written) {
+                    return false;
+                }
+                memcpy(dst + written, src + position, literal_length);
+                position += literal_length;
+                written += literal_length;
+                continue;
+            }
+            case 1:
+                if (position >= src_size) {
+                    return false;
+                }
+                copy_length = 4 + ((tag >> 2) & 7);
+                offset = ((size_t)(tag >> 5) << 8) | src[position++];
+                break;
+            case 2:
+                if (src_size - position < 2) {
+                    return false;
+                }
+                copy_length = (tag >> 2) + 1;
+                offset = (size_t)src[position] | ((size_t)src[position + 1] << 8);
+                position += 2;
+                break;
+            default:
+                if (src_size - position < 4) {
+                    return false;
+                }
+                copy_length = (tag >> 2) + 1;
+                offset = read_u32(src + position);
+                position += 4;
+                break;
+        }
+        
+        if (offset == 0 || offset > written || copy_length > dst_size - written) {
+            return false;
+        }
+        // A copy closer than its length repeats the bytes it is writing
+        uint8_t *target = dst + written;
+        const uint8_t *source = target - offset;
+        if (offset >= copy_length) {
+            memcpy(target, source, copy_length);
+        } else {
+            for (size_t i = 0; i < copy_length; i++) {
+                target[i] = source[i];
+            }
+        }
+        written += copy_length;
+    }
+    return written == dst_size;
+}
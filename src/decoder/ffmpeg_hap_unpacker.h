@@ -0,0 +1,70 @@
+#ifndef FFMPEG_HAP_UNPACKER_H
+#define FFMPEG_HAP_UNPACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Unwraps HAP frames into their GPU-compressed textures without decoding
+// them: only the section container and Snappy chunks are undone. Like the
+// frame converter it does not depend on Godot, so the benchmark can check
+// the textures against FFmpeg's own HAP decoder.
+class FFmpegHapUnpacker {
+public:
+    enum TextureFormat {
+        TEXTURE_NONE,
+        TEXTURE_DXT1,       // HAP: RGB in BC1 blocks
+        TEXTURE_DXT5,       // HAP Alpha: RGBA in BC3 blocks
+        TEXTURE_YCOCG_DXT5, // HAP Q: scaled YCoCg in BC3 blocks, needs hap_ycocg.gdshader
+        TEXTURE_RGTC1,      // Alpha plane of HAP Q Alpha, BC4 blocks
+        TEXTURE_BPTC,       // HAP R: RGBA in BC7 blocks
+    };
+    
+    static const int MAX_TEXTURES = 2;
+    
+    // A texture section of the last parsed frame
+    struct Texture {
+        TextureFormat format = TEXTURE_NONE;
+        size_t unpacked_size = 0;
+    };
+
+private:
+    // Points into the parsed packet
+    struct Chunk {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        bool snappy = false;
+        size_t unpacked_size = 0;
+    };
+    
+    Texture textures[MAX_TEXTURES];
+    std::vector<Chunk> chunks[MAX_TEXTURES]; // One chunk unless the encoder split the frame
+    int texture_count = 0;
+    
+    bool parse_texture(const uint8_t *data, size_t size, int type);
+    bool parse_chunks(const uint8_t *data, size_t size, int texture);
+
+public:
+    // Reads the section headers of one packet, false if it is not a supported HAP frame
+    bool parse(const uint8_t *data, size_t size);
+    // parse() plus a check that every texture covers a width x height frame
+    bool parse_frame(const uint8_t *data, size_t size, int width, int height);
+    int get_texture_count() const { return texture_count; }
+    const Texture &get_texture(int index) const { return textures[index]; }
+    
+    // Writes one texture of the parsed packet, which must still be alive
+    bool unpack(int index, uint8_t *dst, size_t dst_size) const;
+    
+    // Block-compressed size, the width and height rounded up to whole 4x4 blocks
+    static size_t get_texture_size(TextureFormat format, int width, int height);
+    
+    // Raw Snappy block format, the uncompressed length leads the data
+    static bool get_snappy_length(const uint8_t *src, size_t src_size, size_t &r_length);
+    static bool decompress_snappy(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+};
+
+}
+
+#endif // FFMPEG_HAP_UNPACKER_H
@@ -0,0 +1,144 @@
+#include "ffmpeg_io_context.h"
+
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/error.h>
+    #include <libavutil/mem.h>
+}
+
+using namespace godot;
+
+// FFmpegIOContext implementation
+
+FFmpegIOContext::FFmpegIOContext() {
+    avio_context = nullptr;
+}
+
+FFmpegIOContext::~FFmpegIOContext() {
+    if (avio_context) {
+        // The buffer may have been reallocated by libavformat, free the current one
+        av_freep(&avio_context->buffer);
+        avio_context_free(&avio_context);
+    }
+}
+
+bool FFmpegIOContext::create_avio_context(int buffer_size) {
+    uint8_t *buffer = (uint8_t *)av_malloc(buffer_size);
+    if (!buffer) {
+        return false;
+    }
+    
+    avio_context = avio_alloc_context(buffer, buffer_size, 0, this, read_callback, nullptr, seek_callback);
+    if (!avio_context) {
+        av_free(buffer);
+        return false;
+    }
+    
+    return true;
+}
+
+int FFmpegIOContext::read_callback(void *opaque, uint8_t *buf, int buf_size) {
+    FFmpegIOContext *io = static_cast<FFmpegIOContext *>(opaque);
+    int bytes_read = io->read(buf, buf_size);
+    return bytes_read > 0 ? bytes_read : AVERROR_EOF;
+}
+
+int64_t FFmpegIOContext::seek_callback(void *opaque, int64_t offset, int whence) {
+    FFmpegIOContext *io = static_cast<FFmpegIOContext *>(opaque);
+    
+    if (whence & AVSEEK_SIZE) {
+        return io->get_size();
+    }
+    return io->seek(offset, whence & ~AVSEEK_FORCE);
+}
+
+// FFmpegMemoryIO implementation
+
+FFmpegMemoryIO::FFmpegMemoryIO() {
+    position = 0;
+}
+
+bool FFmpegMemoryIO::open(const PackedByteArray &p_data, int buffer_size) {
+    if (p_data.is_empty()) {
+        return false;
+    }
+    
+    data = p_data;
+    position = 0;
+    return create_avio_context(buffer_size);
+}
+
+int FFmpegMemoryIO::read(uint8_t *buf, int buf_size) {
+    int64_t remaining = data.size() - position;
+    int bytes_to_read = (int)MIN((int64_t)buf_size, remaining);
+    if (bytes_to_read <= 0) {
+        return 0;
+    }
+    
+    memcpy(buf, data.ptr() + position, bytes_to_read);
+    position += bytes_to_read;
+    return bytes_to_read;
+}
+
+int64_t FFmpegMemoryIO::seek(int64_t offset, int whence) {
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = position + offset;
+            break;
+        case SEEK_END:
+            target = data.size() + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    
+    if (target < 0 || target > data.size()) {
+        return AVERROR(EINVAL);
+    }
+    
+    position = target;
+    return position;
+}
+
+// FFmpegFileAccessIO implementation
+
+bool FFmpegFileAccessIO::open(const String &path, int buffer_size) {
+    file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) {
+        return false;
+    }
+    
+    return create_avio_context(buffer_size);
+}
+
+int FFmpegFileAccessIO::read(uint8_t *buf, int buf_size) {
+    return (int)file->get_buffer(buf, buf_size);
+}
+
+int64_t FFmpegFileAccessIO::seek(int64_t offset, int whence) {
+    switch (whence) {
+        case SEEK_SET:
+            file->seek(offset);
+            break;
+        case SEEK_CUR:
+            file->seek(file->get_position() + offset);
+            break;
+        case SEEK_END:
+            file->seek_end(offset);
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    
+    return (int64_t)file->get_position();
+}
+
+int64_t FFmpegFileAccessIO::get_size() {
+    return (int64_t)file->get_length();
+}
@@ -0,0 +1,72 @@
+#ifndef FFMPEG_IO_CONTEXT_H
+#define FFMPEG_IO_CONTEXT_H
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+namespace godot {
+
+// Custom I/O for the demuxer. Subclasses provide read/seek over their
+// backing storage; the AVIOContext is handed to the AVFormatContext as pb.
+class FFmpegIOContext {
+private:
+    AVIOContext *avio_context;
+    
+    static int read_callback(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t seek_callback(void *opaque, int64_t offset, int whence);
+    
+protected:
+    bool create_avio_context(int buffer_size);
+    
+    virtual int read(uint8_t *buf, int buf_size) = 0;
+    virtual int64_t seek(int64_t offset, int whence) = 0;
+    virtual int64_t get_size() = 0;
+    
+public:
+    FFmpegIOContext();
+    virtual ~FFmpegIOContext();
+    
+    AVIOContext *get_avio_context() const { return avio_context; }
+};
+
+// Reads straight out of a PackedByteArray. The array is shared, not copied.
+class FFmpegMemoryIO : public FFmpegIOContext {
+private:
+    PackedByteArray data;
+    int64_t position;
+    
+protected:
+    virtual int read(uint8_t *buf, int buf_size) override;
+    virtual int64_t seek(int64_t offset, int whence) override;
+    virtual int64_t get_size() override { return data.size(); }
+    
+public:
+    FFmpegMemoryIO();
+    
+    bool open(const PackedByteArray &p_data, int buffer_size);
+};
+
+// Reads through Godot's FileAccess, so res:// files inside exported packs work.
+class FFmpegFileAccessIO : public FFmpegIOContext {
+private:
+    Ref<FileAccess> file;
+    
+protected:
+    virtual int read(uint8_t *buf, int buf_size) override;
+    virtual int64_t seek(int64_t offset, int whence) override;
+    virtual int64_t get_size() override;
+    
+public:
+    bool open(const String &path, int buffer_size);
+};
+
+}
+
+#endif // FFMPEG_IO_CONTEXT_H
@@ -0,0 +1,76 @@
+#include "ffmpeg_probe_cache.h"
+
+#include <godot_cpp/classes/file_access.hpp>
+
+using namespace godot;
+
+std::mutex FFmpegProbeCache::mutex;
+std::list<FFmpegProbeCache::Entry> FFmpegProbeCache::entries;
+
+FFmpegProbeInfo::~FFmpegProbeInfo() {
+    if (codecpar) {
+        avcodec_parameters_free(&codecpar);
+    }
+}
+
+String FFmpegProbeCache::make_key(const String &path) {
+    if (path.is_empty()) {
+        return String();
+    }
+    
+    Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) {
+        return String();
+    }
+    return path + "|" + itos((int64_t)file->get_length()) + "|" + itos((int64_t)FileAccess::get_modified_time(path));
+}
+
+std::shared_ptr<const FFmpegProbeInfo> FFmpegProbeCache::find(const String &key) {
+    if (key.is_empty()) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->key == key) {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().info;
+        }
+    }
+    return nullptr;
+}
+
+void FFmpegProbeCache::store(const String &key, const AVFormatContext *format_context, int video_stream_index) {
+    if (key.is_empty() || video_stream_index < 0 || video_stream_index >= (int)format_context->nb_streams) {
+        return;
+    }
+    
+    const AVStream *stream = format_context->streams[video_stream_index];
+    std::shared_ptr<FFmpegProbeInfo> info = std::make_shared<FFmpegProbeInfo>();
+    info->codecpar = avcodec_parameters_alloc();
+    if (!info->codecpar || avcodec_parameters_copy(info->codecpar, stream->codecpar) < 0) {
+        return;
+    }
+    info->input_format = format_context->iformat;
+    info->video_stream_index = video_stream_index;
+    info->r_frame_rate = stream->r_frame_rate;
+    info->avg_frame_rate = stream->avg_frame_rate;
+    info->duration = format_context->duration;
+    info->start_time = format_context->start_time;
+    info->stream_start_time = stream->start_time;
+    info->stream_duration = stream->duration;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.remove_if([&key](const Entry &entry) {
+        return entry.key == key;
+    });
+    entries.push_front({ key, info });
+    while ((int)entries.size() > MAX_ENTRIES) {
+        entries.pop_back();
+    }
+}
+
+void FFmpegProbeCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
@@ -0,0 +1,56 @@
+#ifndef FFMPEG_PROBE_CACHE_H
+#define FFMPEG_PROBE_CACHE_H
+
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+namespace godot {
+
+// What avformat_find_stream_info() found out about a file. Reopening the
+// same file restores it instead of probing again.
+struct FFmpegProbeInfo {
+    const AVInputFormat *input_format = nullptr;
+    int video_stream_index = -1;
+    AVCodecParameters *codecpar = nullptr;
+    AVRational r_frame_rate = { 0, 1 };
+    AVRational avg_frame_rate = { 0, 1 };
+    int64_t duration = AV_NOPTS_VALUE;
+    int64_t start_time = AV_NOPTS_VALUE;
+    // Stream timing in the stream's time base, frame times are relative to its start
+    int64_t stream_start_time = AV_NOPTS_VALUE;
+    int64_t stream_duration = AV_NOPTS_VALUE;
+    
+    ~FFmpegProbeInfo();
+};
+
+// Process-wide, most recently used first. Files are identified by path, size
+// and modification time, like the frame index sidecars, so edits invalidate it.
+class FFmpegProbeCache {
+    static const int MAX_ENTRIES = 64;
+    
+    struct Entry {
+        String key;
+        std::shared_ptr<const FFmpegProbeInfo> info;
+    };
+    static std::mutex mutex;
+    static std::list<Entry> entries;
+
+public:
+    static String make_key(const String &path); // Empty if the file cannot be opened
+    
+    static std::shared_ptr<const FFmpegProbeInfo> find(const String &key);
+    static void store(const String &key, const AVFormatContext *format_context, int video_stream_index);
+    static void clear();
+};
+
+}
+
+#endif // FFMPEG_PROBE_CACHE_H
@@ -0,0 +1,183 @@
+#include "ffmpeg_read_ahead_io.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+extern "C" {
+    #include <libavutil/error.h>
+}
+
+using namespace godot;
+
+FFmpegReadAheadIO::FFmpegReadAheadIO() {
+    file_size = 0;
+    hint_fd = -1;
+    stopping = false;
+    position = 0;
+    head = 0;
+    fill = 0;
+    end_reached = false;
+    generation = 0;
+}
+
+FFmpegReadAheadIO::~FFmpegReadAheadIO() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    space_cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    
+#if defined(__unix__) || defined(__APPLE__)
+    if (hint_fd >= 0) {
+        ::close(hint_fd);
+    }
+#endif
+}
+
+bool FFmpegReadAheadIO::open(const String &path, int buffer_size, int read_ahead_size, bool os_hints) {
+    file = FileAccess::open(path, FileAccess::READ);
+    if (file.is_null()) {
+        return false;
+    }
+    file_size = (int64_t)file->get_length();
+    ring.resize(MAX(read_ahead_size, READ_CHUNK_SIZE));
+    
+#if defined(__unix__) || defined(__APPLE__)
+    if (os_hints) {
+        // Files inside an exported pack have no path of their own and get no hints
+        String os_path = ProjectSettings::get_singleton()->globalize_path(path);
+        hint_fd = ::open(os_path.utf8().get_data(), O_RDONLY);
+    }
+#endif
+    
+    if (!create_avio_context(buffer_size)) {
+        return false;
+    }
+    thread = std::thread(&FFmpegReadAheadIO::read_ahead_loop, this);
+    return true;
+}
+
+void FFmpegReadAheadIO::set_stats(const std::shared_ptr<FFmpegStats> &p_stats) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats = p_stats;
+}
+
+int64_t FFmpegReadAheadIO::get_buffered_bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int64_t)fill;
+}
+
+void FFmpegReadAheadIO::read_ahead_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        space_cv.wait(lock, [this] {
+            return stopping || (!end_reached && fill < ring.size());
+        });
+        if (stopping) {
+            break;
+        }
+        
+        // Fill the free space right after the buffered bytes, up to the ring's end
+        int64_t fetch_offset = position + (int64_t)fill;
+        size_t tail = (head + fill) % ring.size();
+        size_t chunk = MIN(MIN(ring.size() - fill, ring.size() - tail), (size_t)READ_CHUNK_SIZE);
+        uint64_t fetch_generation = generation;
+        lock.unlock();
+        
+        // The disk read runs outside the lock, read() keeps serving buffered bytes.
+        // A seek meanwhile leaves this chunk unused; read() only returns bytes
+        // the thread stored after it.
+#if defined(POSIX_FADV_WILLNEED)
+        if (hint_fd >= 0) {
+            posix_fadvise(hint_fd, fetch_offset + (int64_t)chunk, READ_CHUNK_SIZE, POSIX_FADV_WILLNEED);
+        }
+#endif
+        if ((int64_t)file->get_position() != fetch_offset) {
+            file->seek(fetch_offset);
+        }
+        int64_t bytes_read = (int64_t)file->get_buffer(ring.data() + tail, chunk);
+        
+        lock.lock();
+        if (fetch_generation != generation) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            end_reached = true;
+        } else {
+            fill += (size_t)bytes_read;
+        }
+        data_cv.notify_all();
+    }
+}
+
+int FFmpegReadAheadIO::read(uint8_t *buf, int buf_size) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fill == 0 && !end_reached) {
+        // The demuxer caught up with the storage, this is the stall read-ahead is meant to hide
+        std::chrono::steady_clock::time_point stall_start = std::chrono::steady_clock::now();
+        data_cv.wait(lock, [this] {
+            return fill > 0 || end_reached;
+        });
+        if (stats) {
+            stats->record(FFmpegStats::STAGE_IO_STALL, std::chrono::steady_clock::now() - stall_start);
+        }
+    }
+    
+    size_t bytes = MIN((size_t)MAX(buf_size, 0), fill);
+    size_t first_part = MIN(bytes, ring.size() - head);
+    memcpy(buf, ring.data() + head, first_part);
+    memcpy(buf + first_part, ring.data(), bytes - first_part);
+    head = (head + bytes) % ring.size();
+    fill -= bytes;
+    position += (int64_t)bytes;
+    space_cv.notify_one();
+    return (int)bytes;
+}
+
+int64_t FFmpegReadAheadIO::seek(int64_t offset, int whence) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = position + offset;
+            break;
+        case SEEK_END:
+            target = file_size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    
+    if (target < 0 || target > file_size) {
+        return AVERROR(EINVAL);
+    }
+    
+    if (target >= position && target <= position + (int64_t)fill) {
+        // Already buffered, e.g. the demuxer skipping data it does not need
+        size_t skipped = (size_t)(target - position);
+        head = (head + skipped) % ring.size();
+        fill -= skipped;
+    } else {
+        generation++;
+        head = 0;
+        fill = 0;
+        end_reached = false;
+    }
+    position = target;
+    space_cv.notify_one();
+    return position;
+}
@@ -0,0 +1,60 @@
+#ifndef FFMPEG_READ_AHEAD_IO_H
+#define FFMPEG_READ_AHEAD_IO_H
+
+#include "ffmpeg_io_context.h"
+#include "ffmpeg_stats.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// Reads the file ahead of the demuxer on a thread of its own, into a ring
+// buffer, so a slow read on network or USB storage does not stall decoding.
+// A seek inside the buffered range skips forward; any other seek drops the
+// buffer and the thread refills it from the new position.
+class FFmpegReadAheadIO : public FFmpegIOContext {
+private:
+    static const int READ_CHUNK_SIZE = 1024 * 1024;
+    
+    Ref<FileAccess> file; // Only touched by the read-ahead thread once it runs
+    int64_t file_size;
+    int hint_fd; // Second descriptor for posix_fadvise(), -1 without hints
+    
+    std::vector<uint8_t> ring;
+    std::mutex mutex;
+    std::condition_variable data_cv;
+    std::condition_variable space_cv;
+    std::thread thread;
+    bool stopping;
+    int64_t position; // File offset of the next byte read() returns
+    size_t head; // Ring index of position
+    size_t fill; // Bytes buffered from position on
+    bool end_reached; // The thread read up to the end of the file
+    uint64_t generation; // Bumped by every seek that drops the buffer
+    std::shared_ptr<FFmpegStats> stats;
+    
+    void read_ahead_loop();
+    
+protected:
+    virtual int read(uint8_t *buf, int buf_size) override;
+    virtual int64_t seek(int64_t offset, int whence) override;
+    virtual int64_t get_size() override { return file_size; }
+    
+public:
+    FFmpegReadAheadIO();
+    ~FFmpegReadAheadIO();
+    
+    // os_hints asks the kernel to prefetch the next chunk of local files
+    bool open(const String &path, int buffer_size, int read_ahead_size, bool os_hints);
+    void set_stats(const std::shared_ptr<FFmpegStats> &p_stats);
+    int64_t get_buffered_bytes();
+    int64_t get_capacity() const { return (int64_t)ring.size(); }
+};
+
+}
+
+#endif // FFMPEG_READ_AHEAD_IO_H
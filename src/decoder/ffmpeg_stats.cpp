@@ -0,0 +1,181 @@
+#include "ffmpeg_stats.h"
+
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/callable.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace godot;
+
+static const char *STAGE_NAMES[FFmpegStats::STAGE_MAX] = {
+    "read", "io_stall", "decode", "hw_transfer", "filter", "scale", "image_create", "texture_upload",
+};
+
+static const char *COUNTER_NAMES[FFmpegStats::COUNTER_MAX] = {
+    "frames_decoded", "frames_converted", "frames_dropped", "frames_repeated", "bytes_read", "frames_cached",
+};
+
+static const char *PERCENTILE_NAMES[] = { "p50", "p95", "p99", "max" };
+static const double PERCENTILES[] = { 0.50, 0.95, 0.99, 1.0 };
+static const int PERCENTILE_COUNT = 4;
+
+FFmpegStats::Scope::Scope(FFmpegStats *p_stats, Stage p_stage) {
+    stats = (p_stats && p_stats->is_enabled()) ? p_stats : nullptr;
+    stage = p_stage;
+    if (stats) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+FFmpegStats::Scope::~Scope() {
+    if (stats) {
+        stats->record(stage, std::chrono::steady_clock::now() - start);
+    }
+}
+
+FFmpegStats::FFmpegStats(bool p_is_global) {
+    is_global = p_is_global;
+    enabled = p_is_global;
+    for (int i = 0; i < COUNTER_MAX; i++) {
+        counters[i] = 0;
+    }
+}
+
+FFmpegStats &FFmpegStats::get_global() {
+    static FFmpegStats global(true);
+    return global;
+}
+
+void FFmpegStats::add_sample(Stage stage, uint32_t microseconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Histogram &histogram = histograms[stage];
+    histogram.samples[histogram.next] = microseconds;
+    histogram.next = (histogram.next + 1) % WINDOW_SIZE;
+    histogram.filled = std::min(histogram.filled + 1, WINDOW_SIZE);
+    histogram.total_count++;
+}
+
+void FFmpegStats::record(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    if (!is_enabled()) {
+        return;
+    }
+    
+    int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    uint32_t sample = (uint32_t)std::min<int64_t>(std::max<int64_t>(microseconds, 0), UINT32_MAX);
+    add_sample(stage, sample);
+    if (!is_global) {
+        get_global().add_sample(stage, sample);
+    }
+}
+
+void FFmpegStats::add(Counter counter, uint64_t amount) {
+    if (!is_enabled()) {
+        return;
+    }
+    
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+    if (!is_global) {
+        get_global().counters[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+}
+
+void FFmpegStats::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = 0; i < STAGE_MAX; i++) {
+        histograms[i] = Histogram();
+    }
+    for (int i = 0; i < COUNTER_MAX; i++) {
+        counters[i] = 0;
+    }
+}
+
+double FFmpegStats::get_percentile(Stage stage, double percentile, std::vector<uint32_t> &r_window) const {
+    // Caller holds the mutex
+    const Histogram &histogram = histograms[stage];
+    if (histogram.filled == 0) {
+        return 0.0;
+    }
+    
+    r_window.assign(histogram.samples, histogram.samples + histogram.filled);
+    size_t rank = std::min(r_window.size() - 1, (size_t)(percentile * (r_window.size() - 1) + 0.5));
+    std::nth_element(r_window.begin(), r_window.begin() + rank, r_window.end());
+    return r_window[rank] / 1000.0;
+}
+
+Dictionary FFmpegStats::to_dictionary() {
+    Dictionary result;
+    std::vector<uint32_t> window;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int stage = 0; stage < STAGE_MAX; stage++) {
+        Dictionary entry;
+        entry["count"] = (int64_t)histograms[stage].total_count;
+        for (int p = 0; p < PERCENTILE_COUNT; p++) {
+            entry[String(PERCENTILE_NAMES[p]) + "_ms"] = get_percentile((Stage)stage, PERCENTILES[p], window);
+        }
+        result[STAGE_NAMES[stage]] = entry;
+    }
+    for (int i = 0; i < COUNTER_MAX; i++) {
+        result[COUNTER_NAMES[i]] = (int64_t)counters[i].load(std::memory_order_relaxed);
+    }
+    
+    return result;
+}
+
+// Monitor ids: one per stage and percentile, then one per counter
+
+static String get_monitor_name(int monitor) {
+    int stage_monitors = FFmpegStats::STAGE_MAX * PERCENTILE_COUNT;
+    if (monitor < stage_monitors) {
+        return String("FFmpeg/") + STAGE_NAMES[monitor / PERCENTILE_COUNT] + " " + PERCENTILE_NAMES[monitor % PERCENTILE_COUNT] + " (ms)";
+    }
+    return String("FFmpeg/") + COUNTER_NAMES[monitor - stage_monitors];
+}
+
+void FFmpegStats::register_monitors() {
+    Performance *performance = Performance::get_singleton();
+    if (!performance) {
+        return;
+    }
+    
+    int monitor_count = STAGE_MAX * PERCENTILE_COUNT + COUNTER_MAX;
+    for (int i = 0; i < monitor_count; i++) {
+        String name = get_monitor_name(i);
+        if (!performance->has_custom_monitor(name)) {
+            Array args;
+            args.push_back(i);
+            performance->add_custom_monitor(name, callable_mp_static(&FFmpegStats::get_monitor_value), args);
+        }
+    }
+}
+
+void FFmpegStats::unregister_monitors() {
+    Performance *performance = Performance::get_singleton();
+    if (!performance) {
+        return;
+    }
+    
+    int monitor_count = STAGE_MAX * PERCENTILE_COUNT + COUNTER_MAX;
+    for (int i = 0; i < monitor_count; i++) {
+        String name = get_monitor_name(i);
+        if (performance->has_custom_monitor(name)) {
+            performance->remove_custom_monitor(name);
+        }
+    }
+}
+
+double FFmpegStats::get_monitor_value(int monitor) {
+    FFmpegStats &global = get_global();
+    int stage_monitors = STAGE_MAX * PERCENTILE_COUNT;
+    if (monitor >= stage_monitors) {
+        int counter = monitor - stage_monitors;
+        return counter < COUNTER_MAX ? (double)global.counters[counter].load(std::memory_order_relaxed) : 0.0;
+    }
+    
+    std::vector<uint32_t> window;
+    std::lock_guard<std::mutex> lock(global.mutex);
+    return global.get_percentile((Stage)(monitor / PERCENTILE_COUNT), PERCENTILES[monitor % PERCENTILE_COUNT], window);
+}
@@ -0,0 +1,93 @@
+#ifndef FFMPEG_STATS_H
+#define FFMPEG_STATS_H
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace godot {
+
+// Per-stage timings and frame counters of one decoder and its playback.
+// Every sample is also added to a process-wide instance that backs the
+// Performance monitors. While disabled a record is a single relaxed load.
+class FFmpegStats {
+public:
+    enum Stage {
+        STAGE_READ,           // av_read_frame
+        STAGE_IO_STALL,       // Reads that waited for the read-ahead thread
+        STAGE_DECODE,         // avcodec_send_packet / avcodec_receive_frame
+        STAGE_HW_TRANSFER,    // av_hwframe_transfer_data
+        STAGE_FILTER,         // The video_filter graph
+        STAGE_SCALE,          // sws_scale and plane copies
+        STAGE_IMAGE_CREATE,   // Image::create_from_data when the pool allocates
+        STAGE_TEXTURE_UPLOAD, // ImageTexture::set_image
+        STAGE_MAX,
+    };
+    
+    enum Counter {
+        COUNTER_FRAMES_DECODED,
+        COUNTER_FRAMES_CONVERTED,
+        COUNTER_FRAMES_DROPPED,
+        COUNTER_FRAMES_REPEATED,
+        COUNTER_BYTES_READ,
+        COUNTER_FRAMES_CACHED,
+        COUNTER_MAX,
+    };
+    
+    // Times the enclosing block, reads no clock when stats are disabled
+    class Scope {
+        FFmpegStats *stats;
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    
+    public:
+        Scope(FFmpegStats *p_stats, Stage p_stage);
+        ~Scope();
+    };
+
+private:
+    // Rolling window of the most recent samples, in microseconds
+    static const int WINDOW_SIZE = 256;
+    struct Histogram {
+        uint32_t samples[WINDOW_SIZE] = {};
+        int next = 0;
+        int filled = 0;
+        uint64_t total_count = 0;
+    };
+    
+    std::atomic<bool> enabled;
+    std::mutex mutex;
+    Histogram histograms[STAGE_MAX];
+    std::atomic<uint64_t> counters[COUNTER_MAX];
+    bool is_global;
+    
+    void add_sample(Stage stage, uint32_t microseconds);
+    double get_percentile(Stage stage, double percentile, std::vector<uint32_t> &r_window) const;
+    static FFmpegStats &get_global();
+
+public:
+    FFmpegStats(bool p_is_global = false);
+    
+    void set_enabled(bool p_enabled) { enabled.store(p_enabled, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+    
+    void record(Stage stage, std::chrono::steady_clock::duration elapsed);
+    void add(Counter counter, uint64_t amount = 1);
+    void reset();
+    
+    // { "<stage>": { count, p50_ms, p95_ms, p99_ms, max_ms }, "<counter>": int }
+    Dictionary to_dictionary();
+    
+    // Performance custom monitors under "FFmpeg/", fed by every enabled instance
+    static void register_monitors();
+    static void unregister_monitors();
+    static double get_monitor_value(int monitor);
+};
+
+}
+
+#endif // FFMPEG_STATS_H
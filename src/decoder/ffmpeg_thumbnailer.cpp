@@ -0,0 +1,278 @@
+#include "ffmpeg_thumbnailer.h"
+#include "ffmpeg_decoder.h"
+
+#include <godot_cpp/core/class_db.hpp>
+
+#include <algorithm>
+
+using namespace godot;
+
+FFmpegThumbnailer::FFmpegThumbnailer() {
+    next_request_id = 1;
+    stopping = false;
+    thumbnail_width = 256;
+    thumbnail_height = 0;
+    max_threads = 0;
+}
+
+FFmpegThumbnailer::~FFmpegThumbnailer() {
+    stop_workers();
+}
+
+void FFmpegThumbnailer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("request_thumbnails", "path", "times"), &FFmpegThumbnailer::request_thumbnails);
+    ClassDB::bind_method(D_METHOD("request_evenly_spaced", "path", "count"), &FFmpegThumbnailer::request_evenly_spaced);
+    ClassDB::bind_method(D_METHOD("is_request_done", "request_id"), &FFmpegThumbnailer::is_request_done);
+    ClassDB::bind_method(D_METHOD("get_thumbnails", "request_id"), &FFmpegThumbnailer::get_thumbnails);
+    ClassDB::bind_method(D_METHOD("get_thumbnail_times", "request_id"), &FFmpegThumbnailer::get_thumbnail_times);
+    ClassDB::bind_method(D_METHOD("release_request", "request_id"), &FFmpegThumbnailer::release_request);
+    ClassDB::bind_method(D_METHOD("get_pending_count"), &FFmpegThumbnailer::get_pending_count);
+    ClassDB::bind_method(D_METHOD("cancel_all"), &FFmpegThumbnailer::cancel_all);
+    ClassDB::bind_method(D_METHOD("_finish_request", "request_id"), &FFmpegThumbnailer::_finish_request);
+    
+    ClassDB::bind_method(D_METHOD("set_thumbnail_width", "width"), &FFmpegThumbnailer::set_thumbnail_width);
+    ClassDB::bind_method(D_METHOD("get_thumbnail_width"), &FFmpegThumbnailer::get_thumbnail_width);
+    ClassDB::bind_method(D_METHOD("set_thumbnail_height", "height"), &FFmpegThumbnailer::set_thumbnail_height);
+    ClassDB::bind_method(D_METHOD("get_thumbnail_height"), &FFmpegThumbnailer::get_thumbnail_height);
+    ClassDB::bind_method(D_METHOD("set_max_threads", "threads"), &FFmpegThumbnailer::set_max_threads);
+    ClassDB::bind_method(D_METHOD("get_max_threads"), &FFmpegThumbnailer::get_max_threads);
+    
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "thumbnail_width", PROPERTY_HINT_RANGE, "0,4096,1,suffix:px"), "set_thumbnail_width", "get_thumbnail_width");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "thumbnail_height", PROPERTY_HINT_RANGE, "0,4096,1,suffix:px"), "set_thumbnail_height", "get_thumbnail_height");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_threads", PROPERTY_HINT_RANGE, "0,64,1"), "set_max_threads", "get_max_threads");
+    
+    ADD_SIGNAL(MethodInfo("thumbnails_ready", PropertyInfo(Variant::INT, "request_id"), PropertyInfo(Variant::STRING, "path"),
+                          PropertyInfo(Variant::ARRAY, "thumbnails"), PropertyInfo(Variant::PACKED_FLOAT64_ARRAY, "times")));
+}
+
+int64_t FFmpegThumbnailer::request_thumbnails(const String &p_path, const PackedFloat64Array &p_times) {
+    std::vector<double> times;
+    for (int i = 0; i < p_times.size(); i++) {
+        times.push_back(p_times[i]);
+    }
+    return add_request(p_path, times, (int)times.size());
+}
+
+int64_t FFmpegThumbnailer::request_evenly_spaced(const String &p_path, int p_count) {
+    return add_request(p_path, std::vector<double>(), MAX(0, p_count));
+}
+
+int64_t FFmpegThumbnailer::add_request(const String &p_path, const std::vector<double> &p_times, int p_count) {
+    int64_t request_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        request_id = next_request_id++;
+        Request &request = requests[request_id];
+        request.path = p_path;
+        request.times = p_times;
+        request.count = p_count;
+        request.images.resize(p_count);
+        request.frame_times.assign(p_count, -1.0);
+        request.done = p_count == 0;
+        
+        // Small tasks, so one long file still spreads over the workers
+        for (int first = 0; first < p_count; first += TIMES_PER_TASK) {
+            tasks.push_back({ request_id, first, MIN(first + TIMES_PER_TASK, p_count) });
+            request.tasks_left++;
+        }
+        
+        // Workers are started with the first request, an unused thumbnailer costs nothing
+        int thread_limit = max_threads > 0 ? max_threads : (int)std::max(1u, std::thread::hardware_concurrency());
+        int wanted = MIN(thread_limit, (int)tasks.size());
+        while ((int)workers.size() < wanted) {
+            workers.push_back(std::thread(&FFmpegThumbnailer::worker_loop, this));
+        }
+    }
+    
+    if (p_count == 0) {
+        call_deferred("_finish_request", request_id);
+    }
+    work_cv.notify_all();
+    return request_id;
+}
+
+void FFmpegThumbnailer::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping) {
+            break;
+        }
+        
+        Task task = tasks.front();
+        tasks.pop_front();
+        lock.unlock();
+        run_task(task);
+        lock.lock();
+        
+        // Nobody is left to signal once the thumbnailer is being destroyed
+        auto found = requests.find(task.request_id);
+        if (found != requests.end() && --found->second.tasks_left == 0 && !stopping) {
+            found->second.done = true;
+            call_deferred("_finish_request", task.request_id);
+        }
+    }
+}
+
+void FFmpegThumbnailer::run_task(const Task &p_task) {
+    String path;
+    std::vector<double> times;
+    int count;
+    int target_width;
+    int target_height;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = requests.find(p_task.request_id);
+        if (found == requests.end()) {
+            return;
+        }
+        path = found->second.path;
+        times = found->second.times;
+        count = found->second.count;
+        target_width = thumbnail_width;
+        target_height = thumbnail_height;
+    }
+    
+    // Single threaded: the workers already decode in parallel, and frame
+    // threading would hold back the one frame each seek needs
+    Ref<FFmpegDecoder> decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+    decoder->set_use_hardware_acceleration(false);
+    decoder->set_thread_count(1);
+    decoder->set_frame_index_mode(FFmpegDecoder::FRAME_INDEX_DISABLED);
+    decoder->set_use_frame_cache(false);
+    decoder->set_keyframes_only(true);
+    decoder->set_output_width(target_width);
+    decoder->set_output_height(target_height);
+    decoder->set_scaling_algorithm(FFmpegDecoder::SCALING_AREA);
+    if (!decoder->open_file(path)) {
+        return;
+    }
+    
+    double duration = decoder->get_duration();
+    for (int i = p_task.first; i < p_task.end; i++) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+        }
+        
+        double time = times.empty() ? duration * (i + 0.5) / count : times[i];
+        FFmpegDecoder::DecodedFrame decoded;
+        if (!decoder->seek_to_time(MAX(time, 0.0)) || !decoder->decode_frame(decoded) || decoded.planes[0].is_null()) {
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = requests.find(p_task.request_id);
+        if (found == requests.end()) {
+            return;
+        }
+        found->second.images[i] = decoded.planes[0];
+        found->second.frame_times[i] = decoded.time;
+    }
+}
+
+void FFmpegThumbnailer::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+    }
+    work_cv.notify_all();
+    for (std::thread &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+void FFmpegThumbnailer::_finish_request(int64_t p_request_id) {
+    String path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = requests.find(p_request_id);
+        if (found == requests.end()) {
+            return; // Released before the signal went out
+        }
+        found->second.done = true;
+        path = found->second.path;
+    }
+    emit_signal("thumbnails_ready", p_request_id, path, get_thumbnails(p_request_id), get_thumbnail_times(p_request_id));
+}
+
+bool FFmpegThumbnailer::is_request_done(int64_t p_request_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = requests.find(p_request_id);
+    return found != requests.end() && found->second.done;
+}
+
+TypedArray<Image> FFmpegThumbnailer::get_thumbnails(int64_t p_request_id) {
+    TypedArray<Image> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = requests.find(p_request_id);
+    if (found != requests.end()) {
+        for (const Ref<Image> &image : found->second.images) {
+            result.push_back(image);
+        }
+    }
+    return result;
+}
+
+PackedFloat64Array FFmpegThumbnailer::get_thumbnail_times(int64_t p_request_id) {
+    PackedFloat64Array result;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = requests.find(p_request_id);
+    if (found != requests.end()) {
+        for (double time : found->second.frame_times) {
+            result.push_back(time);
+        }
+    }
+    return result;
+}
+
+void FFmpegThumbnailer::release_request(int64_t p_request_id) {
+    // Queued tasks of a released request find nothing and return
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.erase(p_request_id);
+}
+
+int FFmpegThumbnailer::get_pending_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int pending = 0;
+    for (const auto &entry : requests) {
+        if (!entry.second.done) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+void FFmpegThumbnailer::cancel_all() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Requests complete with what their running tasks produce
+    for (const Task &task : tasks) {
+        auto found = requests.find(task.request_id);
+        if (found != requests.end() && --found->second.tasks_left == 0) {
+            found->second.done = true;
+            call_deferred("_finish_request", task.request_id);
+        }
+    }
+    tasks.clear();
+}
+
+void FFmpegThumbnailer::set_thumbnail_width(int p_width) {
+    std::lock_guard<std::mutex> lock(mutex);
+    thumbnail_width = CLAMP(p_width, 0, 4096);
+}
+
+void FFmpegThumbnailer::set_thumbnail_height(int p_height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    thumbnail_height = CLAMP(p_height, 0, 4096);
+}
+
+void FFmpegThumbnailer::set_max_threads(int p_threads) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_threads = MAX(0, p_threads);
+}
@@ -0,0 +1,93 @@
+#ifndef FFMPEG_THUMBNAILER_H
+#define FFMPEG_THUMBNAILER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/variant/packed_float64_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/typed_array.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// Thumbnails and posters for media browsers, made off the main thread.
+// Each requested time is served by the keyframe at or before it: decoders
+// run with keyframes_only, so a thumbnail costs one seek and one keyframe
+// decode, scaled straight to thumbnail size. Requests are split into small
+// tasks spread over a pool of workers, so several files decode in parallel.
+class FFmpegThumbnailer : public RefCounted {
+    GDCLASS(FFmpegThumbnailer, RefCounted)
+
+private:
+    static const int TIMES_PER_TASK = 8; // Each task opens its own decoder
+    
+    struct Request {
+        String path;
+        std::vector<double> times; // Empty for evenly spaced requests
+        int count = 0;
+        std::vector<Ref<Image>> images; // Null where no frame could be decoded
+        std::vector<double> frame_times; // Of the keyframes used, -1 where none
+        int tasks_left = 0;
+        bool done = false;
+    };
+    struct Task {
+        int64_t request_id;
+        int first;
+        int end;
+    };
+    
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::map<int64_t, Request> requests;
+    std::deque<Task> tasks;
+    std::vector<std::thread> workers;
+    int64_t next_request_id;
+    bool stopping;
+    
+    int thumbnail_width;
+    int thumbnail_height;
+    int max_threads;
+    
+    int64_t add_request(const String &p_path, const std::vector<double> &p_times, int p_count);
+    void worker_loop();
+    void run_task(const Task &p_task);
+    void stop_workers();
+    void _finish_request(int64_t p_request_id);
+
+protected:
+    static void _bind_methods();
+
+public:
+    FFmpegThumbnailer();
+    ~FFmpegThumbnailer();
+    
+    // Both return a request id, "thumbnails_ready" is emitted with it when all are done
+    int64_t request_thumbnails(const String &p_path, const PackedFloat64Array &p_times);
+    int64_t request_evenly_spaced(const String &p_path, int p_count); // Centres of count equal slices
+    
+    // Polling, results are kept until released
+    bool is_request_done(int64_t p_request_id);
+    TypedArray<Image> get_thumbnails(int64_t p_request_id);
+    PackedFloat64Array get_thumbnail_times(int64_t p_request_id);
+    void release_request(int64_t p_request_id);
+    int get_pending_count();
+    void cancel_all(); // Drops queued work, tasks in progress still finish
+    
+    void set_thumbnail_width(int p_width);
+    int get_thumbnail_width() const { return thumbnail_width; }
+    void set_thumbnail_height(int p_height); // 0 keeps the aspect ratio
+    int get_thumbnail_height() const { return thumbnail_height; }
+    void set_max_threads(int p_threads); // 0 = one per CPU core, applied when workers start
+    int get_max_threads() const { return max_threads; }
+};
+
+}
+
+#endif // FFMPEG_THUMBNAILER_H
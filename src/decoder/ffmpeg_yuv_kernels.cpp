@@ -0,0 +1,337 @@
+#include "ffmpeg_yuv_kernels.h"
+#include "ffmpeg_yuv_kernels_rows.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(LYMO_YUV_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+using namespace godot;
+using namespace godot::yuv_kernels;
+
+namespace {
+
+// Frames below this many pixels are converted on the calling thread, waking
+// workers costs more than it saves
+const int64_t BAND_MIN_PIXELS = 1024 * 1024;
+const int BAND_MIN_ROWS = 64;
+
+FFmpegYuvKernels::Isa detect_isa() {
+#if defined(LYMO_YUV_KERNELS_X86)
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return FFmpegYuvKernels::ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return FFmpegYuvKernels::ISA_SSE41;
+    }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if (max_leaf >= 7 && os_saves_ymm) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return FFmpegYuvKernels::ISA_AVX2;
+        }
+    }
+    if (sse41) {
+        return FFmpegYuvKernels::ISA_SSE41;
+    }
+#endif
+#elif defined(LYMO_YUV_KERNELS_NEON)
+    return FFmpegYuvKernels::ISA_NEON; // Part of the AArch64 baseline
+#endif
+    return FFmpegYuvKernels::ISA_NONE;
+}
+
+std::atomic<int> active_isa(-1);
+
+RowFunction get_row_function(FFmpegYuvKernels::Isa isa, bool semi_planar) {
+    switch (isa) {
+#if defined(LYMO_YUV_KERNELS_X86)
+        case FFmpegYuvKernels::ISA_AVX2:
+            return semi_planar ? semi_planar_row_avx2 : planar_row_avx2;
+        case FFmpegYuvKernels::ISA_SSE41:
+            return semi_planar ? semi_planar_row_sse41 : planar_row_sse41;
+#endif
+#if defined(LYMO_YUV_KERNELS_NEON)
+        case FFmpegYuvKernels::ISA_NEON:
+            return semi_planar ? semi_planar_row_neon : planar_row_neon;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+// P010 keeps 10 bits in the top of 16-bit samples, rounded down to 8 bits
+void narrow_p010_row(const uint8_t *src, uint8_t *dst, int count) {
+    const uint16_t *samples = (const uint16_t *)src;
+    for (int i = 0; i < count; i++) {
+        dst[i] = (uint8_t)std::min((samples[i] + 128) >> 8, 255);
+    }
+}
+
+// Persistent workers that split one conversion into row bands. One
+// conversion uses the pool at a time, a concurrent one runs on its own thread.
+class RowBandPool {
+    std::mutex job_mutex;
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::vector<std::thread> workers;
+    const std::function<void(int)> *job = nullptr;
+    int band_count = 0;
+    int next_band = 0;
+    int finished_bands = 0;
+    uint64_t job_serial = 0;
+    bool stopping = false;
+    
+    // Called and returns with the lock held. Bands are claimed under the lock
+    // so a late worker can never pick up a band of a finished job.
+    void run_bands(std::unique_lock<std::mutex> &lock, uint64_t serial) {
+        while (job_serial == serial && next_band < band_count) {
+            const std::function<void(int)> *current = job;
+            int band = next_band++;
+            lock.unlock();
+            (*current)(band);
+            lock.lock();
+            finished_bands++;
+            if (finished_bands == band_count) {
+                done_cv.notify_all();
+            }
+        }
+    }
+    
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t seen_serial = job_serial;
+        while (true) {
+            work_cv.wait(lock, [&] { return stopping || job_serial != seen_serial; });
+            if (stopping) {
+                return;
+            }
+            seen_serial = job_serial;
+            run_bands(lock, seen_serial);
+        }
+    }
+    
+    void stop_workers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_cv.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        stopping = false;
+    }
+
+public:
+    ~RowBandPool() {
+        stop();
+    }
+    
+    // False if another conversion holds the pool
+    bool run(int bands, const std::function<void(int)> &function, int threads) {
+        std::unique_lock<std::mutex> busy(job_mutex, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            return false;
+        }
+        while ((int)workers.size() < threads - 1) {
+            workers.emplace_back(&RowBandPool::worker_loop, this);
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &function;
+        band_count = bands;
+        next_band = 0;
+        finished_bands = 0;
+        uint64_t serial = ++job_serial;
+        work_cv.notify_all();
+        run_bands(lock, serial);
+        done_cv.wait(lock, [&] { return finished_bands == band_count; });
+        job = nullptr;
+        return true;
+    }
+    
+    void stop() {
+        std::lock_guard<std::mutex> busy(job_mutex);
+        stop_workers();
+    }
+};
+
+RowBandPool band_pool;
+std::atomic<int> max_threads(0);
+
+int get_thread_count() {
+    int threads = max_threads.load();
+    if (threads <= 0) {
+        threads = std::min(4, (int)std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return threads;
+}
+
+}
+
+FFmpegYuvKernels::Isa FFmpegYuvKernels::get_detected_isa() {
+    static const Isa detected = detect_isa();
+    return detected;
+}
+
+FFmpegYuvKernels::Isa FFmpegYuvKernels::get_default_isa() {
+    Isa detected = get_detected_isa();
+    return detected == ISA_NEON ? ISA_NONE : detected;
+}
+
+FFmpegYuvKernels::Isa FFmpegYuvKernels::get_isa() {
+    int isa = active_isa.load();
+    return isa < 0 ? get_default_isa() : (Isa)isa;
+}
+
+void FFmpegYuvKernels::set_isa(Isa isa) {
+    Isa detected = get_detected_isa();
+    bool available = isa == ISA_NONE || isa == detected || (isa == ISA_SSE41 && detected == ISA_AVX2);
+    if (available) {
+        active_isa.store(isa);
+    }
+}
+
+const char *FFmpegYuvKernels::get_isa_name(Isa isa) {
+    switch (isa) {
+        case ISA_SSE41:
+            return "sse4.1";
+        case ISA_AVX2:
+            return "avx2";
+        case ISA_NEON:
+            return "neon";
+        default:
+            return "none";
+    }
+}
+
+bool FFmpegYuvKernels::is_supported(AVPixelFormat format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUVA420P:
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_P010LE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+FFmpegYuvKernels::Coefficients FFmpegYuvKernels::make_coefficients(int color_range, int color_space) {
+    static const double kr_values[] = { 0.299, 0.2126, 0.2627, 0.212 };
+    static const double kb_values[] = { 0.114, 0.0722, 0.0593, 0.087 };
+    int space = std::max(0, std::min(color_space, 3));
+    double kr = kr_values[space];
+    double kb = kb_values[space];
+    double kg = 1.0 - kr - kb;
+    
+    bool full_range = color_range == 1;
+    double y_scale = full_range ? 1.0 : 255.0 / 219.0;
+    double c_scale = full_range ? 1.0 : 255.0 / 224.0;
+    
+    Coefficients c;
+    c.y_offset = full_range ? 0 : 16;
+    c.y_gain = (int16_t)std::lrint(y_scale * (1 << 14));
+    c.v_to_r = (int16_t)std::lrint((2.0 - 2.0 * kr) * c_scale * (1 << 13));
+    c.u_to_g = (int16_t)std::lrint(2.0 * kb * (1.0 - kb) / kg * c_scale * (1 << 13));
+    c.v_to_g = (int16_t)std::lrint(2.0 * kr * (1.0 - kr) / kg * c_scale * (1 << 13));
+    c.u_to_b = (int16_t)std::lrint((2.0 - 2.0 * kb) * c_scale * (1 << 13));
+    return c;
+}
+
+bool FFmpegYuvKernels::convert(const uint8_t *const src_data[4], const int src_linesize[4], AVPixelFormat format,
+                               int width, int height, int color_range, int color_space, uint8_t *dst, int dst_linesize) {
+    if (!is_supported(format) || width <= 0 || height <= 0) {
+        return false;
+    }
+    
+    bool semi_planar = format == AV_PIX_FMT_NV12 || format == AV_PIX_FMT_P010LE;
+    RowFunction row_function = get_row_function(get_isa(), semi_planar);
+    if (!row_function) {
+        return false;
+    }
+    
+    bool ten_bit = format == AV_PIX_FMT_P010LE;
+    bool has_alpha = format == AV_PIX_FMT_YUVA420P;
+    int chroma_shift = (format == AV_PIX_FMT_YUV422P || format == AV_PIX_FMT_YUVJ422P) ? 0 : 1;
+    Coefficients c = make_coefficients(color_range, color_space);
+    
+    auto convert_rows = [&](int row_start, int row_end) {
+        // 10-bit rows are narrowed into scratch lines first, then take the NV12 path
+        thread_local std::vector<uint8_t> narrow_luma;
+        thread_local std::vector<uint8_t> narrow_chroma;
+        int chroma_width = (width + 1) & ~1;
+        if (ten_bit) {
+            narrow_luma.resize(width);
+            narrow_chroma.resize(chroma_width);
+        }
+        
+        for (int row = row_start; row < row_end; row++) {
+            int chroma_row = row >> chroma_shift;
+            const uint8_t *y = src_data[0] + (ptrdiff_t)row * src_linesize[0];
+            const uint8_t *u = src_data[1] + (ptrdiff_t)chroma_row * src_linesize[1];
+            const uint8_t *v = semi_planar ? nullptr : src_data[2] + (ptrdiff_t)chroma_row * src_linesize[2];
+            const uint8_t *a = has_alpha ? src_data[3] + (ptrdiff_t)row * src_linesize[3] : nullptr;
+            if (ten_bit) {
+                narrow_p010_row(y, narrow_luma.data(), width);
+                narrow_p010_row(u, narrow_chroma.data(), chroma_width);
+                y = narrow_luma.data();
+                u = narrow_chroma.data();
+            }
+            row_function(y, u, v, a, dst + (ptrdiff_t)row * dst_linesize, width, c);
+        }
+    };
+    
+    int threads = get_thread_count();
+    int bands = std::min(threads, height / BAND_MIN_ROWS);
+    if (bands > 1 && (int64_t)width * height >= BAND_MIN_PIXELS) {
+        // Even band heights keep 4:2:0 chroma rows inside one band
+        int band_rows = ((height + bands - 1) / bands + 1) & ~1;
+        std::function<void(int)> band_function = [&](int band) {
+            int row_start = band * band_rows;
+            convert_rows(row_start, std::min(height, row_start + band_rows));
+        };
+        if (band_pool.run(bands, band_function, threads)) {
+            return true;
+        }
+    }
+    convert_rows(0, height);
+    return true;
+}
+
+void FFmpegYuvKernels::set_max_threads(int threads) {
+    max_threads.store(std::max(0, threads));
+    band_pool.stop();
+}
+
+int FFmpegYuvKernels::get_max_threads() {
+    return max_threads.load();
+}
+
+void FFmpegYuvKernels::shutdown() {
+    band_pool.stop();
+}
@@ -0,0 +1,60 @@
+#ifndef FFMPEG_YUV_KERNELS_H
+#define FFMPEG_YUV_KERNELS_H
+
+#include <cstdint>
+
+extern "C" {
+    #include <libavutil/pixfmt.h>
+}
+
+namespace godot {
+
+// Same-size YUV to RGBA conversion of the common decoder outputs, written
+// for SSE4.1, AVX2 and NEON and picked at runtime. FFmpegFrameConverter uses
+// it in place of sws_scale when no resize is needed. Like the converter it
+// does not depend on Godot. Large frames are split into row bands that are
+// converted on a small pool of worker threads.
+class FFmpegYuvKernels {
+public:
+    enum Isa {
+        ISA_NONE, // No kernel, callers fall back to sws_scale
+        ISA_SSE41,
+        ISA_AVX2,
+        ISA_NEON,
+    };
+    
+    // Fixed-point matrix: luma gain Q14, chroma factors Q13, G factors are subtracted
+    struct Coefficients {
+        int16_t y_offset;
+        int16_t y_gain;
+        int16_t v_to_r;
+        int16_t u_to_g;
+        int16_t v_to_g;
+        int16_t u_to_b;
+    };
+    
+    static Isa get_detected_isa(); // Detected once
+    // In use until set_isa(). NEON has not been verified on hardware yet, so
+    // it is only used when asked for and AArch64 defaults to sws_scale.
+    static Isa get_default_isa();
+    static Isa get_isa(); // The one in use
+    static void set_isa(Isa isa); // A lower one for comparisons, one the CPU lacks is ignored
+    static const char *get_isa_name(Isa isa);
+    static bool is_supported(AVPixelFormat format);
+    
+    // 0 = TV range / 1 = full range, 0-3 = BT.601 / BT.709 / BT.2020 / SMPTE-240M
+    static Coefficients make_coefficients(int color_range, int color_space);
+    
+    // False if the format or the CPU is not supported, dst is then untouched
+    static bool convert(const uint8_t *const src_data[4], const int src_linesize[4], AVPixelFormat format,
+                        int width, int height, int color_range, int color_space, uint8_t *dst, int dst_linesize);
+    
+    // Row band workers, 0 = up to four, one per core. Stops the pool until the next conversion.
+    static void set_max_threads(int threads);
+    static int get_max_threads();
+    static void shutdown();
+};
+
+}
+
+#endif // FFMPEG_YUV_KERNELS_H
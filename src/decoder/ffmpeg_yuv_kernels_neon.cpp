@@ -0,0 +1,90 @@
+#include "ffmpeg_yuv_kernels_rows.h"
+
+#if defined(LYMO_YUV_KERNELS_NEON)
+
+#include <arm_neon.h>
+
+namespace godot {
+namespace yuv_kernels {
+
+// 16 pixels per step, vqrdmulhq_s16 rounds like _mm_mulhrs_epi16
+
+struct NeonConstants {
+    int16x8_t y_offset, y_gain, v_to_r, u_to_g, v_to_g, u_to_b, chroma_bias, round;
+};
+
+static inline NeonConstants make_neon_constants(const Coefficients &c) {
+    NeonConstants k;
+    k.y_offset = vdupq_n_s16(c.y_offset);
+    k.y_gain = vdupq_n_s16(c.y_gain);
+    k.v_to_r = vdupq_n_s16(c.v_to_r);
+    k.u_to_g = vdupq_n_s16(c.u_to_g);
+    k.v_to_g = vdupq_n_s16(c.v_to_g);
+    k.u_to_b = vdupq_n_s16(c.u_to_b);
+    k.chroma_bias = vdupq_n_s16(128);
+    k.round = vdupq_n_s16(32);
+    return k;
+}
+
+static inline int16x8_t center_chroma_neon(uint8x8_t samples, const NeonConstants &k) {
+    return vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(samples)), k.chroma_bias), 8);
+}
+
+static inline uint8x8_t to_pixels_neon(int16x8_t value, const NeonConstants &k) {
+    return vqmovun_s16(vshrq_n_s16(vqaddq_s16(value, k.round), 6));
+}
+
+static inline void convert_8_neon(uint8x8_t y8, int16x8_t u, int16x8_t v, const NeonConstants &k,
+                                  uint8x8_t &r_r, uint8x8_t &r_g, uint8x8_t &r_b) {
+    int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(y8));
+    y = vqrdmulhq_s16(vshlq_n_s16(vsubq_s16(y, k.y_offset), 7), k.y_gain);
+    r_r = to_pixels_neon(vqaddq_s16(y, vqrdmulhq_s16(v, k.v_to_r)), k);
+    r_g = to_pixels_neon(vqsubq_s16(vqsubq_s16(y, vqrdmulhq_s16(u, k.u_to_g)), vqrdmulhq_s16(v, k.v_to_g)), k);
+    r_b = to_pixels_neon(vqaddq_s16(y, vqrdmulhq_s16(u, k.u_to_b)), k);
+}
+
+// u and v hold eight centred chroma samples covering the 16 pixels
+static inline void convert_16_neon(const uint8_t *y_row, int16x8_t u, int16x8_t v, uint8x16_t alpha,
+                                   uint8_t *dst, const NeonConstants &k) {
+    uint8x16_t y = vld1q_u8(y_row);
+    uint8x8_t r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+    convert_8_neon(vget_low_u8(y), vzip1q_s16(u, u), vzip1q_s16(v, v), k, r_lo, g_lo, b_lo);
+    convert_8_neon(vget_high_u8(y), vzip2q_s16(u, u), vzip2q_s16(v, v), k, r_hi, g_hi, b_hi);
+    uint8x16x4_t rgba;
+    rgba.val[0] = vcombine_u8(r_lo, r_hi);
+    rgba.val[1] = vcombine_u8(g_lo, g_hi);
+    rgba.val[2] = vcombine_u8(b_lo, b_hi);
+    rgba.val[3] = alpha;
+    vst4q_u8(dst, rgba);
+}
+
+void planar_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                     uint8_t *dst, int width, const Coefficients &c) {
+    NeonConstants k = make_neon_constants(c);
+    uint8x16_t opaque = vdupq_n_u8(255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t alpha = a ? vld1q_u8(a + x) : opaque;
+        convert_16_neon(y + x, center_chroma_neon(vld1_u8(u + x / 2), k), center_chroma_neon(vld1_u8(v + x / 2), k),
+                        alpha, dst + x * 4, k);
+    }
+    planar_row_c(y, u, v, a, dst, x, width, c);
+}
+
+void semi_planar_row_neon(const uint8_t *y, const uint8_t *uv, const uint8_t *, const uint8_t *,
+                          uint8_t *dst, int width, const Coefficients &c) {
+    NeonConstants k = make_neon_constants(c);
+    uint8x16_t opaque = vdupq_n_u8(255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x2_t pairs = vld2_u8(uv + x);
+        convert_16_neon(y + x, center_chroma_neon(pairs.val[0], k), center_chroma_neon(pairs.val[1], k),
+                        opaque, dst + x * 4, k);
+    }
+    semi_planar_row_c(y, uv, dst, x, width, c);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef FFMPEG_YUV_KERNELS_ROWS_H
+#define FFMPEG_YUV_KERNELS_ROWS_H
+
+// Row functions behind FFmpegYuvKernels, shared by the per-ISA sources.
+// Chroma is horizontally subsampled by two: planar rows read u and v (and
+// an optional alpha row), semi-planar rows read interleaved UV from u.
+
+#include "ffmpeg_yuv_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LYMO_YUV_KERNELS_X86 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LYMO_YUV_KERNELS_NEON 1
+#endif
+
+namespace godot {
+namespace yuv_kernels {
+
+typedef FFmpegYuvKernels::Coefficients Coefficients;
+typedef void (*RowFunction)(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                            uint8_t *dst, int width, const Coefficients &c);
+
+// Same rounding as _mm_mulhrs_epi16 and vqrdmulhq_s16, so the scalar tail
+// of a row matches what the vector loop would have produced
+static inline int16_t mulhrs(int32_t a, int32_t b) {
+    return (int16_t)((a * b + 0x4000) >> 15);
+}
+
+static inline int32_t saturate16(int32_t value) {
+    return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+// Q6 fixed point to a pixel: saturating rounding add, shift, unsigned saturating pack
+static inline uint8_t to_pixel(int32_t value) {
+    int32_t pixel = saturate16(value + 32) >> 6;
+    return (uint8_t)(pixel < 0 ? 0 : (pixel > 255 ? 255 : pixel));
+}
+
+static inline void convert_pixel(int y, int u, int v, uint8_t a, uint8_t *dst, const Coefficients &c) {
+    int32_t luma = mulhrs((y - c.y_offset) * 128, c.y_gain);
+    int32_t cu = (u - 128) * 256;
+    int32_t cv = (v - 128) * 256;
+    dst[0] = to_pixel(saturate16(luma + mulhrs(cv, c.v_to_r)));
+    dst[1] = to_pixel(saturate16(saturate16(luma - mulhrs(cu, c.u_to_g)) - mulhrs(cv, c.v_to_g)));
+    dst[2] = to_pixel(saturate16(luma + mulhrs(cu, c.u_to_b)));
+    dst[3] = a;
+}
+
+// Scalar rows from pixel x on; x must be even
+static inline void planar_row_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                                uint8_t *dst, int x, int width, const Coefficients &c) {
+    for (; x < width; x++) {
+        convert_pixel(y[x], u[x >> 1], v[x >> 1], a ? a[x] : 255, dst + x * 4, c);
+    }
+}
+
+static inline void semi_planar_row_c(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int x, int width,
+                                     const Coefficients &c) {
+    for (; x < width; x++) {
+        convert_pixel(y[x], uv[(x >> 1) * 2], uv[(x >> 1) * 2 + 1], 255, dst + x * 4, c);
+    }
+}
+
+#if defined(LYMO_YUV_KERNELS_X86)
+void planar_row_sse41(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                      uint8_t *dst, int width, const Coefficients &c);
+void semi_planar_row_sse41(const uint8_t *y, const uint8_t *uv, const uint8_t *unused, const uint8_t *a,
+                           uint8_t *dst, int width, const Coefficients &c);
+void planar_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                     uint8_t *dst, int width, const Coefficients &c);
+void semi_planar_row_avx2(const uint8_t *y, const uint8_t *uv, const uint8_t *unused, const uint8_t *a,
+                          uint8_t *dst, int width, const Coefficients &c);
+#endif
+
+#if defined(LYMO_YUV_KERNELS_NEON)
+void planar_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                     uint8_t *dst, int width, const Coefficients &c);
+void semi_planar_row_neon(const uint8_t *y, const uint8_t *uv, const uint8_t *unused, const uint8_t *a,
+                          uint8_t *dst, int width, const Coefficients &c);
+#endif
+
+}
+}
+
+#endif // FFMPEG_YUV_KERNELS_ROWS_H
@@ -0,0 +1,213 @@
+#include "ffmpeg_yuv_kernels_rows.h"
+
+#if defined(LYMO_YUV_KERNELS_X86)
+
+#include <immintrin.h>
+
+// GCC and Clang compile each kernel for its own instruction set, so the rest
+// of the build keeps the default target. MSVC allows the intrinsics as is.
+#if defined(__GNUC__) || defined(__clang__)
+#define LYMO_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define LYMO_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LYMO_TARGET_SSE41
+#define LYMO_TARGET_AVX2
+#endif
+
+namespace godot {
+namespace yuv_kernels {
+
+// SSE4.1: 16 pixels per step
+
+struct Sse41Constants {
+    __m128i y_offset, y_gain, v_to_r, u_to_g, v_to_g, u_to_b, chroma_bias, round;
+};
+
+LYMO_TARGET_SSE41 static inline Sse41Constants make_sse41_constants(const Coefficients &c) {
+    Sse41Constants k;
+    k.y_offset = _mm_set1_epi16(c.y_offset);
+    k.y_gain = _mm_set1_epi16(c.y_gain);
+    k.v_to_r = _mm_set1_epi16(c.v_to_r);
+    k.u_to_g = _mm_set1_epi16(c.u_to_g);
+    k.v_to_g = _mm_set1_epi16(c.v_to_g);
+    k.u_to_b = _mm_set1_epi16(c.u_to_b);
+    k.chroma_bias = _mm_set1_epi16(128);
+    k.round = _mm_set1_epi16(32);
+    return k;
+}
+
+// Centred chroma in Q8, one sample per pixel pair
+LYMO_TARGET_SSE41 static inline __m128i center_chroma_sse41(__m128i samples, const Sse41Constants &k) {
+    return _mm_slli_epi16(_mm_sub_epi16(samples, k.chroma_bias), 8);
+}
+
+// Eight pixels of one channel, still in Q6
+LYMO_TARGET_SSE41 static inline void convert_8_sse41(__m128i y, __m128i u, __m128i v, const Sse41Constants &k,
+                                                     __m128i &r_r, __m128i &r_g, __m128i &r_b) {
+    y = _mm_mulhrs_epi16(_mm_slli_epi16(_mm_sub_epi16(y, k.y_offset), 7), k.y_gain);
+    __m128i r = _mm_adds_epi16(y, _mm_mulhrs_epi16(v, k.v_to_r));
+    __m128i g = _mm_subs_epi16(_mm_subs_epi16(y, _mm_mulhrs_epi16(u, k.u_to_g)), _mm_mulhrs_epi16(v, k.v_to_g));
+    __m128i b = _mm_adds_epi16(y, _mm_mulhrs_epi16(u, k.u_to_b));
+    r_r = _mm_srai_epi16(_mm_adds_epi16(r, k.round), 6);
+    r_g = _mm_srai_epi16(_mm_adds_epi16(g, k.round), 6);
+    r_b = _mm_srai_epi16(_mm_adds_epi16(b, k.round), 6);
+}
+
+// u and v hold eight centred chroma samples covering the 16 pixels
+LYMO_TARGET_SSE41 static inline void convert_16_sse41(const uint8_t *y_row, __m128i u, __m128i v, __m128i alpha,
+                                                      uint8_t *dst, const Sse41Constants &k) {
+    __m128i y = _mm_loadu_si128((const __m128i *)y_row);
+    __m128i zero = _mm_setzero_si128();
+    __m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+    convert_8_sse41(_mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi16(u, u), _mm_unpacklo_epi16(v, v), k, r_lo, g_lo, b_lo);
+    convert_8_sse41(_mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi16(u, u), _mm_unpackhi_epi16(v, v), k, r_hi, g_hi, b_hi);
+    __m128i r = _mm_packus_epi16(r_lo, r_hi);
+    __m128i g = _mm_packus_epi16(g_lo, g_hi);
+    __m128i b = _mm_packus_epi16(b_lo, b_hi);
+    
+    // Interleave to RGBA
+    __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+    __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+    __m128i ba_lo = _mm_unpacklo_epi8(b, alpha);
+    __m128i ba_hi = _mm_unpackhi_epi8(b, alpha);
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+}
+
+LYMO_TARGET_SSE41 void planar_row_sse41(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                                        uint8_t *dst, int width, const Coefficients &c) {
+    Sse41Constants k = make_sse41_constants(c);
+    __m128i opaque = _mm_set1_epi8((char)255);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u_samples = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + x / 2)));
+        __m128i v_samples = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + x / 2)));
+        __m128i alpha = a ? _mm_loadu_si128((const __m128i *)(a + x)) : opaque;
+        convert_16_sse41(y + x, center_chroma_sse41(u_samples, k), center_chroma_sse41(v_samples, k), alpha, dst + x * 4, k);
+    }
+    planar_row_c(y, u, v, a, dst, x, width, c);
+}
+
+LYMO_TARGET_SSE41 void semi_planar_row_sse41(const uint8_t *y, const uint8_t *uv, const uint8_t *, const uint8_t *,
+                                             uint8_t *dst, int width, const Coefficients &c) {
+    Sse41Constants k = make_sse41_constants(c);
+    __m128i opaque = _mm_set1_epi8((char)255);
+    __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i pairs = _mm_loadu_si128((const __m128i *)(uv + x));
+        __m128i u_samples = _mm_and_si128(pairs, low_bytes);
+        __m128i v_samples = _mm_srli_epi16(pairs, 8);
+        convert_16_sse41(y + x, center_chroma_sse41(u_samples, k), center_chroma_sse41(v_samples, k), opaque, dst + x * 4, k);
+    }
+    semi_planar_row_c(y, uv, dst, x, width, c);
+}
+
+// AVX2: 32 pixels per step. Lane-crossing permutes keep pixels in order,
+// since 256-bit unpacks and packs work on each 128-bit half separately.
+
+struct Avx2Constants {
+    __m256i y_offset, y_gain, v_to_r, u_to_g, v_to_g, u_to_b, chroma_bias, round;
+};
+
+LYMO_TARGET_AVX2 static inline Avx2Constants make_avx2_constants(const Coefficients &c) {
+    Avx2Constants k;
+    k.y_offset = _mm256_set1_epi16(c.y_offset);
+    k.y_gain = _mm256_set1_epi16(c.y_gain);
+    k.v_to_r = _mm256_set1_epi16(c.v_to_r);
+    k.u_to_g = _mm256_set1_epi16(c.u_to_g);
+    k.v_to_g = _mm256_set1_epi16(c.v_to_g);
+    k.u_to_b = _mm256_set1_epi16(c.u_to_b);
+    k.chroma_bias = _mm256_set1_epi16(128);
+    k.round = _mm256_set1_epi16(32);
+    return k;
+}
+
+LYMO_TARGET_AVX2 static inline __m256i center_chroma_avx2(__m256i samples, const Avx2Constants &k) {
+    return _mm256_slli_epi16(_mm256_sub_epi16(samples, k.chroma_bias), 8);
+}
+
+LYMO_TARGET_AVX2 static inline void convert_16_avx2(__m256i y, __m256i u, __m256i v, const Avx2Constants &k,
+                                                    __m256i &r_r, __m256i &r_g, __m256i &r_b) {
+    y = _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y, k.y_offset), 7), k.y_gain);
+    __m256i r = _mm256_adds_epi16(y, _mm256_mulhrs_epi16(v, k.v_to_r));
+    __m256i g = _mm256_subs_epi16(_mm256_subs_epi16(y, _mm256_mulhrs_epi16(u, k.u_to_g)), _mm256_mulhrs_epi16(v, k.v_to_g));
+    __m256i b = _mm256_adds_epi16(y, _mm256_mulhrs_epi16(u, k.u_to_b));
+    r_r = _mm256_srai_epi16(_mm256_adds_epi16(r, k.round), 6);
+    r_g = _mm256_srai_epi16(_mm256_adds_epi16(g, k.round), 6);
+    r_b = _mm256_srai_epi16(_mm256_adds_epi16(b, k.round), 6);
+}
+
+// u and v hold 16 centred chroma samples covering the 32 pixels, in order
+LYMO_TARGET_AVX2 static inline void convert_32_avx2(const uint8_t *y_row, __m256i u, __m256i v, __m256i alpha,
+                                                    uint8_t *dst, const Avx2Constants &k) {
+    __m256i y_lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)y_row));
+    __m256i y_hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y_row + 16)));
+    
+    // Duplicate each chroma sample, then restore pixel order across lanes
+    __m256i u_pairs_a = _mm256_unpacklo_epi16(u, u);
+    __m256i u_pairs_b = _mm256_unpackhi_epi16(u, u);
+    __m256i v_pairs_a = _mm256_unpacklo_epi16(v, v);
+    __m256i v_pairs_b = _mm256_unpackhi_epi16(v, v);
+    __m256i u_lo = _mm256_permute2x128_si256(u_pairs_a, u_pairs_b, 0x20);
+    __m256i u_hi = _mm256_permute2x128_si256(u_pairs_a, u_pairs_b, 0x31);
+    __m256i v_lo = _mm256_permute2x128_si256(v_pairs_a, v_pairs_b, 0x20);
+    __m256i v_hi = _mm256_permute2x128_si256(v_pairs_a, v_pairs_b, 0x31);
+    
+    __m256i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+    convert_16_avx2(y_lo, u_lo, v_lo, k, r_lo, g_lo, b_lo);
+    convert_16_avx2(y_hi, u_hi, v_hi, k, r_hi, g_hi, b_hi);
+    __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(r_lo, r_hi), 0xD8);
+    __m256i g = _mm256_permute4x64_epi64(_mm256_packus_epi16(g_lo, g_hi), 0xD8);
+    __m256i b = _mm256_permute4x64_epi64(_mm256_packus_epi16(b_lo, b_hi), 0xD8);
+    
+    // Interleave to RGBA: each unpack yields pixels 0-7 | 16-23 or 8-15 | 24-31
+    __m256i rg_lo = _mm256_unpacklo_epi8(r, g);
+    __m256i rg_hi = _mm256_unpackhi_epi8(r, g);
+    __m256i ba_lo = _mm256_unpacklo_epi8(b, alpha);
+    __m256i ba_hi = _mm256_unpackhi_epi8(b, alpha);
+    __m256i rgba_0 = _mm256_unpacklo_epi16(rg_lo, ba_lo); // 0-3 | 16-19
+    __m256i rgba_1 = _mm256_unpackhi_epi16(rg_lo, ba_lo); // 4-7 | 20-23
+    __m256i rgba_2 = _mm256_unpacklo_epi16(rg_hi, ba_hi); // 8-11 | 24-27
+    __m256i rgba_3 = _mm256_unpackhi_epi16(rg_hi, ba_hi); // 12-15 | 28-31
+    _mm256_storeu_si256((__m256i *)dst, _mm256_permute2x128_si256(rgba_0, rgba_1, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_permute2x128_si256(rgba_2, rgba_3, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 64), _mm256_permute2x128_si256(rgba_0, rgba_1, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 96), _mm256_permute2x128_si256(rgba_2, rgba_3, 0x31));
+}
+
+LYMO_TARGET_AVX2 void planar_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, const uint8_t *a,
+                                      uint8_t *dst, int width, const Coefficients &c) {
+    Avx2Constants k = make_avx2_constants(c);
+    __m256i opaque = _mm256_set1_epi8((char)255);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i u_samples = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + x / 2)));
+        __m256i v_samples = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + x / 2)));
+        __m256i alpha = a ? _mm256_loadu_si256((const __m256i *)(a + x)) : opaque;
+        convert_32_avx2(y + x, center_chroma_avx2(u_samples, k), center_chroma_avx2(v_samples, k), alpha, dst + x * 4, k);
+    }
+    planar_row_c(y, u, v, a, dst, x, width, c);
+}
+
+LYMO_TARGET_AVX2 void semi_planar_row_avx2(const uint8_t *y, const uint8_t *uv, const uint8_t *, const uint8_t *,
+                                           uint8_t *dst, int width, const Coefficients &c) {
+    Avx2Constants k = make_avx2_constants(c);
+    __m256i opaque = _mm256_set1_epi8((char)255);
+    __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i pairs = _mm256_loadu_si256((const __m256i *)(uv + x));
+        __m256i u_samples = _mm256_and_si256(pairs, low_bytes);
+        __m256i v_samples = _mm256_srli_epi16(pairs, 8);
+        convert_32_avx2(y + x, center_chroma_avx2(u_samples, k), center_chroma_avx2(v_samples, k), opaque, dst + x * 4, k);
+    }
+    semi_planar_row_c(y, uv, dst, x, width, c);
+}
+
+}
+}
+
+#endif
@@ -1,7 +1,14 @@
 #include "register_types.h"
 
 #include "stream/ffmpeg_video_stream.h"
+#include "stream/ffmpeg_playlist_stream.h"
+#include "stream/ffmpeg_sync_group.h"
+#include "stream/ffmpeg_decode_pool.h"
 #include "decoder/ffmpeg_decoder.h"
+#include "decoder/ffmpeg_decoder_pool.h"
+#include "decoder/ffmpeg_frame_cache.h"
+#include "decoder/ffmpeg_thumbnailer.h"
+#include "decoder/ffmpeg_yuv_kernels.h"
 
 #include <gdextension_interface.h>
 #include <godot_cpp/core/defs.hpp>
@@ -11,12 +18,23 @@
 using namespace godot;
 
 void initialize_lymo_ffmpeg_module() {
+    ClassDB::register_class<FFmpegVideoStreamPlayback>();
     ClassDB::register_class<FFmpegVideoStream>();
+    ClassDB::register_class<FFmpegPlaylistStream>();
+    ClassDB::register_class<FFmpegSyncGroup>();
     ClassDB::register_class<FFmpegDecoder>();
+    ClassDB::register_class<FFmpegThumbnailer>();
+    
+    FFmpegStats::register_monitors();
 }
 
 void uninitialize_lymo_ffmpeg_module() {
-    // Cleanup if needed
+    FFmpegStats::unregister_monitors();
+    FFmpegDecodePool::shutdown();
+    FFmpegDecoderPool::clear();
+    FFmpegFrameCache::clear();
+    FFmpegProbeCache::clear();
+    FFmpegYuvKernels::shutdown();
 }
 
 extern "C" {
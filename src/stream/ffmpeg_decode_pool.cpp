@@ -0,0 +1,149 @@
+#include "ffmpeg_decode_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace godot;
+
+static std::unique_ptr<FFmpegDecodePool> decode_pool_singleton;
+static std::mutex decode_pool_singleton_mutex;
+
+FFmpegDecodePool::FFmpegDecodePool() {
+    worker_count = 0;
+    stopping = false;
+}
+
+FFmpegDecodePool::~FFmpegDecodePool() {
+    stop_workers();
+}
+
+FFmpegDecodePool *FFmpegDecodePool::get_singleton() {
+    std::lock_guard<std::mutex> lock(decode_pool_singleton_mutex);
+    if (!decode_pool_singleton) {
+        decode_pool_singleton.reset(new FFmpegDecodePool());
+    }
+    return decode_pool_singleton.get();
+}
+
+void FFmpegDecodePool::shutdown() {
+    std::lock_guard<std::mutex> lock(decode_pool_singleton_mutex);
+    decode_pool_singleton.reset();
+}
+
+void FFmpegDecodePool::start_workers() {
+    int count = worker_count > 0 ? worker_count : (int)std::max(1u, std::thread::hardware_concurrency());
+    stopping = false;
+    for (int i = 0; i < count; i++) {
+        workers.push_back(std::thread(&FFmpegDecodePool::worker_loop, this));
+    }
+}
+
+void FFmpegDecodePool::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (std::thread &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+void FFmpegDecodePool::add_client(Client *p_client) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Job &job : jobs) {
+            if (job.client == p_client) {
+                return;
+            }
+        }
+        jobs.push_back({ p_client, false });
+        // Workers are started with the first client, an unused pool costs nothing
+        if (workers.empty()) {
+            start_workers();
+        }
+    }
+    work_cv.notify_all();
+}
+
+void FFmpegDecodePool::remove_client(Client *p_client) {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this, p_client] {
+        for (const Job &job : jobs) {
+            if (job.client == p_client) {
+                return !job.busy;
+            }
+        }
+        return true;
+    });
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [p_client](const Job &job) {
+        return job.client == p_client;
+    }), jobs.end());
+}
+
+void FFmpegDecodePool::notify() {
+    work_cv.notify_all();
+}
+
+void FFmpegDecodePool::set_worker_count(int p_count) {
+    p_count = std::max(0, p_count);
+    if (p_count == worker_count) {
+        return;
+    }
+    
+    // Steps in flight finish first, queued work is picked up by the new workers
+    bool running = !workers.empty();
+    if (running) {
+        stop_workers();
+    }
+    worker_count = p_count;
+    if (running) {
+        start_workers();
+    }
+}
+
+void FFmpegDecodePool::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Serve the idle client with the least decoded ahead of its clock
+        Job *next = nullptr;
+        work_cv.wait(lock, [this, &next] {
+            if (stopping) {
+                return true;
+            }
+            double lowest_lead = 0.0;
+            for (Job &job : jobs) {
+                if (job.busy || !job.client->pool_has_work()) {
+                    continue;
+                }
+                double lead = job.client->pool_get_lead();
+                if (!next || lead < lowest_lead) {
+                    next = &job;
+                    lowest_lead = lead;
+                }
+            }
+            return next != nullptr;
+        });
+        if (stopping) {
+            break;
+        }
+        
+        Client *client = next->client;
+        next->busy = true;
+        lock.unlock();
+        client->pool_decode_step();
+        lock.lock();
+        
+        // The job vector may have changed while unlocked
+        for (Job &job : jobs) {
+            if (job.client == client) {
+                job.busy = false;
+            }
+        }
+        idle_cv.notify_all();
+        work_cv.notify_all();
+    }
+}
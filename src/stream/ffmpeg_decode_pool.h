@@ -0,0 +1,65 @@
+#ifndef FFMPEG_DECODE_POOL_H
+#define FFMPEG_DECODE_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// Process-wide worker threads shared by the playbacks of sync groups.
+// Instead of one thread per stream, a fixed number of workers always decode
+// for the client whose queue is furthest behind the clock, so N streams
+// never need N threads.
+class FFmpegDecodePool {
+public:
+    class Client {
+    public:
+        virtual ~Client() {}
+        // Called with the pool locked, must not block on the decoder
+        virtual bool pool_has_work() = 0;
+        // Seconds of decoded frames ahead of the clock, lowest is served first
+        virtual double pool_get_lead() = 0;
+        // Decodes and queues one frame, called with the pool unlocked
+        virtual void pool_decode_step() = 0;
+    };
+
+private:
+    struct Job {
+        Client *client;
+        bool busy;
+    };
+    
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable idle_cv;
+    std::vector<Job> jobs;
+    std::vector<std::thread> workers;
+    int worker_count;
+    bool stopping;
+    
+    void start_workers();
+    void stop_workers();
+    void worker_loop();
+    
+    FFmpegDecodePool();
+
+public:
+    ~FFmpegDecodePool();
+    
+    static FFmpegDecodePool *get_singleton();
+    static void shutdown(); // Joins the workers, called when the extension unloads
+    
+    void add_client(Client *p_client);
+    void remove_client(Client *p_client); // Waits for a step in progress to finish
+    void notify(); // A client may have work again
+    
+    // Restarts the workers, only call from the main thread
+    void set_worker_count(int p_count); // 0 = one per CPU core
+    int get_worker_count() const { return worker_count; }
+};
+
+}
+
+#endif // FFMPEG_DECODE_POOL_H
@@ -0,0 +1,374 @@
+#include "ffmpeg_gop_cache.h"
+#include "../decoder/ffmpeg_frame_cache.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace godot;
+
+FFmpegGopCache::FFmpegGopCache() {
+    resolution_scale = 1.0;
+    frame_duration = 1.0 / 30.0;
+    next_frame_time = -1.0;
+    stream_end = -1.0;
+    failed_time = -1.0;
+    stopping = false;
+    budget = 256 * 1024 * 1024;
+    used_bytes = 0;
+    use_counter = 0;
+    hits = 0;
+    misses = 0;
+    gops_decoded = 0;
+    frames_decoded = 0;
+    evictions = 0;
+    listener = nullptr;
+}
+
+FFmpegGopCache::~FFmpegGopCache() {
+    close();
+}
+
+bool FFmpegGopCache::open(const Ref<FFmpegDecoder> &p_source, double p_resolution_scale) {
+    if (p_source.is_null() || !p_source->is_file_open()) {
+        return false;
+    }
+    
+    // In-memory input has no path, it is told apart by its decoder
+    String key = p_source->get_source_path();
+    if (key.is_empty()) {
+        key = "memory:" + itos((int64_t)p_source.ptr());
+    }
+    if (decoder.is_valid() && key == source_key && p_resolution_scale == resolution_scale) {
+        return true;
+    }
+    close();
+    
+    // A decoder of its own, so scrubbing never moves the playback decoder.
+    // Segments hold their frames, the shared frame cache would only duplicate them.
+    Ref<FFmpegDecoder> scrub_decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+    if (!scrub_decoder->open_same_source(p_source)) {
+        UtilityFunctions::print("Error: Failed to open scrub decoder for: ", p_source->get_source_path());
+        return false;
+    }
+    scrub_decoder->set_use_frame_cache(false);
+    if (p_resolution_scale < 1.0) {
+        Vector2i size = p_source->get_output_size();
+        scrub_decoder->set_output_width(MAX(2, (int)(size.x * p_resolution_scale)));
+        scrub_decoder->set_output_height(MAX(2, (int)(size.y * p_resolution_scale)));
+    }
+    
+    decoder = scrub_decoder;
+    source_key = key;
+    resolution_scale = p_resolution_scale;
+    double frame_rate = decoder->get_frame_rate();
+    frame_duration = frame_rate > 0 ? 1.0 / frame_rate : 1.0 / 30.0;
+    next_frame_time = -1.0;
+    stream_end = -1.0;
+    failed_time = -1.0;
+    stopping = false;
+    worker = std::thread(&FFmpegGopCache::worker_loop, this);
+    return true;
+}
+
+void FFmpegGopCache::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requests.clear();
+    }
+    work_cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    segments.clear();
+    used_bytes = 0;
+    decoder.unref();
+    source_key = String();
+}
+
+double FFmpegGopCache::get_segment_span() const {
+    // Long enough that intra-only files are not decoded a frame at a time
+    return MAX(0.5, 8.0 * frame_duration);
+}
+
+FFmpegGopCache::Segment *FFmpegGopCache::find_segment(double p_time, int p_stride) {
+    // Segments may overlap, so a later start can end before p_time while an earlier one covers it
+    auto it = segments.upper_bound(p_time);
+    while (it != segments.begin()) {
+        --it;
+        Segment &segment = it->second;
+        if (p_time < segment.end && segment.stride <= p_stride) {
+            return &segment;
+        }
+    }
+    return nullptr;
+}
+
+bool FFmpegGopCache::get_frame(Segment &p_segment, double p_time, FFmpegDecoder::DecodedFrame &r_frame) {
+    auto it = std::upper_bound(p_segment.frames.begin(), p_segment.frames.end(), p_time,
+                               [](double time, const FFmpegDecoder::DecodedFrame &frame) { return time < frame.time; });
+    if (it == p_segment.frames.begin()) {
+        return false;
+    }
+    p_segment.last_used = ++use_counter;
+    r_frame = *(it - 1);
+    return true;
+}
+
+FFmpegGopCache::Request FFmpegGopCache::make_request(double p_time, int p_direction, int p_stride) const {
+    double span = get_segment_span();
+    Request request;
+    if (p_direction < 0) {
+        // Backwards the frames before p_time are the ones needed next
+        request.from = p_time - span;
+        request.to = p_time + frame_duration * 0.5;
+    } else {
+        request.from = p_time;
+        request.to = p_time + span;
+    }
+    request.from = MAX(request.from, 0.0);
+    request.needed = p_time;
+    request.stride = p_stride;
+    return request;
+}
+
+bool FFmpegGopCache::queue_request(const Request &p_request, bool p_urgent) {
+    if (failed_time >= 0 && std::abs(p_request.needed - failed_time) < frame_duration * 0.5) {
+        return false;
+    }
+    for (auto it = requests.begin(); it != requests.end(); ++it) {
+        if (it->stride == p_request.stride && std::abs(it->needed - p_request.needed) < frame_duration * 0.5) {
+            if (p_urgent && it != requests.begin()) {
+                Request request = *it;
+                requests.erase(it);
+                requests.push_front(request);
+            }
+            return false;
+        }
+    }
+    
+    if (p_urgent) {
+        requests.push_front(p_request);
+    } else {
+        requests.push_back(p_request);
+    }
+    while ((int)requests.size() > MAX_QUEUED_REQUESTS) {
+        requests.pop_back();
+    }
+    work_cv.notify_one();
+    return true;
+}
+
+bool FFmpegGopCache::find_frame(double p_time, int p_direction, int p_stride, FFmpegDecoder::DecodedFrame &r_frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (decoder.is_null()) {
+        return false;
+    }
+    Segment *segment = find_segment(p_time, MAX(p_stride, 1));
+    if (segment && get_frame(*segment, p_time, r_frame)) {
+        hits++;
+        return true;
+    }
+    if (queue_request(make_request(p_time, p_direction, MAX(p_stride, 1)), true)) {
+        misses++;
+    }
+    return false;
+}
+
+void FFmpegGopCache::prefetch(double p_time, int p_direction, int p_stride) {
+    std::lock_guard<std::mutex> lock(mutex);
+    p_stride = MAX(p_stride, 1);
+    Segment *segment = decoder.is_valid() && p_direction != 0 ? find_segment(p_time, p_stride) : nullptr;
+    if (!segment) {
+        return; // A miss already queued the segment itself
+    }
+    
+    Request request;
+    request.stride = p_stride;
+    if (p_direction < 0) {
+        // The GOP before: from the keyframe before the segment up to its first frame
+        if (segment->start <= frame_duration * 0.5) {
+            return;
+        }
+        request.from = MAX(segment->start - get_segment_span(), 0.0);
+        request.to = segment->start;
+        request.needed = segment->start - frame_duration * 0.5;
+    } else {
+        // The GOP after continues where the decoder stopped, without a seek
+        if (segment->at_end || (stream_end >= 0 && segment->end >= stream_end)) {
+            return;
+        }
+        request.from = segment->end;
+        request.to = segment->end + get_segment_span();
+        request.needed = segment->end;
+    }
+    if (!find_segment(request.needed, p_stride)) {
+        queue_request(request, false);
+    }
+}
+
+void FFmpegGopCache::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cv.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (stopping) {
+            break;
+        }
+        
+        Request request = requests.front();
+        requests.pop_front();
+        if (find_segment(request.needed, request.stride)) {
+            continue;
+        }
+        
+        lock.unlock();
+        Segment segment;
+        bool decoded = decode_segment(request, segment);
+        lock.lock();
+        
+        if (decoded) {
+            insert_segment(segment);
+            failed_time = -1.0;
+        } else if (!stopping) {
+            failed_time = request.needed;
+        }
+        if (listener && !stopping) {
+            listener->gop_cache_updated();
+        }
+    }
+}
+
+bool FFmpegGopCache::decode_segment(const Request &p_request, Segment &r_segment) {
+    // Forward requests that start at the frame the decoder holds need no seek
+    FFmpegDecoder::DecodedFrame decoded;
+    bool continued = next_frame_time >= 0 && std::abs(p_request.from - next_frame_time) < frame_duration * 0.5;
+    decoded.time = next_frame_time;
+    next_frame_time = -1.0;
+    if (!continued && !decoder->seek_to_time(p_request.from)) {
+        return false;
+    }
+    // Shuttling at speed only shows a few frames, the codec can drop the rest
+    decoder->set_skip_non_reference_frames(p_request.stride > 1);
+    
+    // A GOP longer than half the budget keeps the frames nearest to its end,
+    // where backward playback needs them first
+    int64_t max_bytes = budget.load() / 2;
+    double min_spacing = (p_request.stride - 0.5) * frame_duration;
+    r_segment.stride = p_request.stride;
+    r_segment.end = -1.0;
+    bool has_held = continued;
+    while (!stopping) {
+        if (!has_held && !decoder->decode_frame(decoded, false)) {
+            r_segment.at_end = true;
+            break;
+        }
+        has_held = false;
+        
+        if (decoded.time >= p_request.to) {
+            // Left unconverted in the decoder, it starts the next segment.
+            // Nothing before it means the seek did not land before p_request.to.
+            next_frame_time = decoded.time;
+            r_segment.end = decoded.time;
+            break;
+        }
+        if (!r_segment.frames.empty() && decoded.time < r_segment.frames.back().time + min_spacing) {
+            continue;
+        }
+        
+        FFmpegDecoder::DecodedFrame frame;
+        if (!decoder->convert_held_frame(frame)) {
+            continue;
+        }
+        int64_t size = FFmpegFrameCache::get_frame_size(frame);
+        r_segment.frames.push_back(frame);
+        r_segment.size += size;
+        while (r_segment.size > max_bytes && r_segment.frames.size() > 1) {
+            r_segment.size -= FFmpegFrameCache::get_frame_size(r_segment.frames.front());
+            r_segment.frames.pop_front();
+        }
+    }
+    
+    if (stopping || r_segment.frames.empty()) {
+        next_frame_time = -1.0;
+        return false;
+    }
+    r_segment.start = r_segment.frames.front().time;
+    if (r_segment.at_end) {
+        r_segment.end = r_segment.frames.back().time + frame_duration;
+    }
+    return true;
+}
+
+void FFmpegGopCache::insert_segment(Segment &p_segment) {
+    // Segments the new one covers at least as densely are replaced
+    auto same_start = segments.find(p_segment.start);
+    if (same_start != segments.end()) {
+        used_bytes -= same_start->second.size;
+        segments.erase(same_start);
+    }
+    auto it = segments.lower_bound(p_segment.start);
+    while (it != segments.end() && it->first < p_segment.end) {
+        const Segment &existing = it->second;
+        if (existing.end <= p_segment.end && existing.stride >= p_segment.stride) {
+            used_bytes -= existing.size;
+            it = segments.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    if (p_segment.at_end) {
+        stream_end = p_segment.end;
+    }
+    gops_decoded++;
+    frames_decoded += p_segment.frames.size();
+    used_bytes += p_segment.size;
+    p_segment.last_used = ++use_counter;
+    Segment &stored = segments[p_segment.start];
+    stored = std::move(p_segment);
+    evict(&stored);
+}
+
+void FFmpegGopCache::evict(const Segment *p_keep) {
+    while (used_bytes > budget) {
+        auto oldest = segments.end();
+        for (auto it = segments.begin(); it != segments.end(); ++it) {
+            if (&it->second != p_keep && (oldest == segments.end() || it->second.last_used < oldest->second.last_used)) {
+                oldest = it;
+            }
+        }
+        if (oldest == segments.end()) {
+            break;
+        }
+        used_bytes -= oldest->second.size;
+        segments.erase(oldest);
+        evictions++;
+    }
+}
+
+void FFmpegGopCache::set_budget(int64_t p_bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = MAX((int64_t)0, p_bytes);
+    evict(nullptr);
+}
+
+Dictionary FFmpegGopCache::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t frames = 0;
+    for (const auto &entry : segments) {
+        frames += (int64_t)entry.second.frames.size();
+    }
+    Dictionary result;
+    result["hits"] = (int64_t)hits;
+    result["misses"] = (int64_t)misses;
+    result["gops_decoded"] = (int64_t)gops_decoded;
+    result["frames_decoded"] = (int64_t)frames_decoded;
+    result["evictions"] = (int64_t)evictions;
+    result["frames"] = frames;
+    result["bytes"] = used_bytes;
+    return result;
+}
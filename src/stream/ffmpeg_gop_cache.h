@@ -0,0 +1,113 @@
+#ifndef FFMPEG_GOP_CACHE_H
+#define FFMPEG_GOP_CACHE_H
+
+#include "../decoder/ffmpeg_decoder.h"
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace godot {
+
+// Decoded frames around the playhead for reverse playback and jog stepping.
+// A worker decodes whole GOPs on a decoder of its own, from the keyframe a
+// seek lands on, and keeps them as segments of consecutive frames. Stepping
+// back through a GOP then costs one decode of it instead of one per frame.
+// Least recently used segments are dropped once the byte budget is exceeded.
+class FFmpegGopCache {
+public:
+    // Told on the worker thread after a GOP was decoded or failed, so a
+    // caller whose find_frame() missed can look again
+    class Listener {
+    public:
+        virtual ~Listener() {}
+        virtual void gop_cache_updated() = 0;
+    };
+
+private:
+    struct Segment {
+        double start = 0.0; // Time of the first frame
+        double end = 0.0;   // Time of the frame after the last one
+        int stride = 1;     // Frames kept about stride frames apart
+        bool at_end = false; // Ends with the stream
+        std::deque<FFmpegDecoder::DecodedFrame> frames;
+        int64_t size = 0;
+        uint64_t last_used = 0;
+    };
+    struct Request {
+        double from;   // Decoding starts at the keyframe at or before it
+        double to;     // and stops at the first frame at or after it
+        double needed; // Dropped once a segment covers this time
+        int stride;
+    };
+    
+    Ref<FFmpegDecoder> decoder;
+    String source_key;
+    double resolution_scale;
+    double frame_duration;
+    double next_frame_time; // Frame the decoder holds unconverted, -1 when the next segment needs a seek
+    double stream_end;      // -1 until a segment reached the end
+    double failed_time;     // Not queued again, e.g. past the end of a truncated file
+    
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::deque<Request> requests;
+    std::map<double, Segment> segments; // By start time
+    std::atomic<int64_t> budget;
+    int64_t used_bytes;
+    uint64_t use_counter;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t gops_decoded;
+    uint64_t frames_decoded;
+    uint64_t evictions;
+    Listener *listener;
+    
+    double get_segment_span() const;
+    Segment *find_segment(double p_time, int p_stride);
+    bool get_frame(Segment &p_segment, double p_time, FFmpegDecoder::DecodedFrame &r_frame);
+    bool queue_request(const Request &p_request, bool p_urgent);
+    Request make_request(double p_time, int p_direction, int p_stride) const;
+    void worker_loop();
+    bool decode_segment(const Request &p_request, Segment &r_segment);
+    void insert_segment(Segment &p_segment);
+    void evict(const Segment *p_keep);
+
+public:
+    static const int MAX_QUEUED_REQUESTS = 4; // Older requests are stale once the playhead moved on
+    
+    FFmpegGopCache();
+    ~FFmpegGopCache();
+    
+    // Opens the scrub decoder on the input of p_source, with its settings and
+    // the output size scaled by p_resolution_scale. Keeps the frames when it
+    // is already open on the same file at the same scale.
+    bool open(const Ref<FFmpegDecoder> &p_source, double p_resolution_scale);
+    void close(); // Stops the worker and drops every frame
+    bool is_open() const { return decoder.is_valid(); }
+    void set_listener(Listener *p_listener) { listener = p_listener; } // Before open()
+    
+    // Newest cached frame at or before p_time. On a miss the GOP holding it is
+    // queued, decoded backwards from p_time when p_direction is negative.
+    // A stride above 1 keeps frames about stride frames apart and skips
+    // non-reference frames, for fast shuttling; such segments do not serve
+    // requests for every frame.
+    bool find_frame(double p_time, int p_direction, int p_stride, FFmpegDecoder::DecodedFrame &r_frame);
+    void prefetch(double p_time, int p_direction, int p_stride); // Queues the GOP next to the one holding p_time
+    
+    void set_budget(int64_t p_bytes);
+    int64_t get_budget() const { return budget; }
+    Dictionary get_stats(); // hits, misses, gops_decoded, frames_decoded, evictions, frames, bytes
+};
+
+}
+
+#endif // FFMPEG_GOP_CACHE_H
@@ -0,0 +1,50 @@
+#include "ffmpeg_playlist_stream.h"
+
+#include <godot_cpp/core/class_db.hpp>
+
+using namespace godot;
+
+void FFmpegPlaylistStream::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_files", "files"), &FFmpegPlaylistStream::set_files);
+    ClassDB::bind_method(D_METHOD("get_files"), &FFmpegPlaylistStream::get_files);
+    ClassDB::bind_method(D_METHOD("add_file", "file"), &FFmpegPlaylistStream::add_file);
+    ClassDB::bind_method(D_METHOD("clear_files"), &FFmpegPlaylistStream::clear_files);
+    ClassDB::bind_method(D_METHOD("get_file_count"), &FFmpegPlaylistStream::get_file_count);
+    
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "files", PROPERTY_HINT_TYPE_STRING, vformat("%d/%d:*.mp4,*.avi,*.mkv,*.mov,*.webm", Variant::STRING, PROPERTY_HINT_FILE)), "set_files", "get_files");
+}
+
+void FFmpegPlaylistStream::set_files(const PackedStringArray &p_files) {
+    files = p_files;
+    
+    // Reopening an unchanged first clip would only cost time
+    String first_file = files.is_empty() ? String() : files[0];
+    if (get_file() != first_file) {
+        set_file(first_file);
+    }
+    
+    Ref<FFmpegVideoStreamPlayback> playback = get_playback();
+    if (playback.is_valid()) {
+        playback->set_playlist(files);
+    }
+}
+
+void FFmpegPlaylistStream::add_file(const String &p_file) {
+    PackedStringArray new_files = files;
+    new_files.push_back(p_file);
+    set_files(new_files);
+}
+
+void FFmpegPlaylistStream::clear_files() {
+    set_files(PackedStringArray());
+}
+
+Ref<VideoStreamPlayback> FFmpegPlaylistStream::_instantiate_playback() {
+    // A regular playback of the first clip, which then works through the list
+    Ref<VideoStreamPlayback> base_playback = FFmpegVideoStream::_instantiate_playback();
+    Ref<FFmpegVideoStreamPlayback> playback = Ref<FFmpegVideoStreamPlayback>(Object::cast_to<FFmpegVideoStreamPlayback>(base_playback.ptr()));
+    if (playback.is_valid()) {
+        playback->set_playlist(files);
+    }
+    return base_playback;
+}
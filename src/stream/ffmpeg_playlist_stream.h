@@ -0,0 +1,37 @@
+#ifndef FFMPEG_PLAYLIST_STREAM_H
+#define FFMPEG_PLAYLIST_STREAM_H
+
+#include "ffmpeg_video_stream.h"
+
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+namespace godot {
+
+// An ordered cue list played as one stream. The playback keeps the next
+// clip opened and its first frame decoded, and switches to it at the end
+// of the current clip into the same textures, without a gap. All settings
+// of FFmpegVideoStream apply to every clip; looping repeats the whole list.
+class FFmpegPlaylistStream : public FFmpegVideoStream {
+    GDCLASS(FFmpegPlaylistStream, FFmpegVideoStream)
+
+private:
+    PackedStringArray files;
+
+protected:
+    static void _bind_methods();
+
+public:
+    // The first clip is opened like set_file()
+    void set_files(const PackedStringArray &p_files);
+    PackedStringArray get_files() const { return files; }
+    void add_file(const String &p_file);
+    void clear_files();
+    int get_file_count() const { return files.size(); }
+    
+    // VideoStream interface
+    virtual Ref<VideoStreamPlayback> _instantiate_playback() override;
+};
+
+}
+
+#endif // FFMPEG_PLAYLIST_STREAM_H
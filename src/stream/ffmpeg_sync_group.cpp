@@ -0,0 +1,215 @@
+#include "ffmpeg_sync_group.h"
+
+#include "ffmpeg_decode_pool.h"
+#include "ffmpeg_video_stream.h"
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include <algorithm>
+#include <thread>
+
+using namespace godot;
+
+FFmpegSyncGroup::FFmpegSyncGroup() {
+    playing = false;
+    paused = false;
+    position = 0.0;
+    start_ticks = 0;
+    waiting_for_members = false;
+    wait_start_ticks = 0;
+    max_start_wait = 0.5;
+}
+
+FFmpegSyncGroup::~FFmpegSyncGroup() {
+    // Members hold a reference, so none is left by the time the group goes away
+    members.clear();
+}
+
+void FFmpegSyncGroup::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("add_member", "playback"), &FFmpegSyncGroup::add_member);
+    ClassDB::bind_method(D_METHOD("remove_member", "playback"), &FFmpegSyncGroup::remove_member);
+    ClassDB::bind_method(D_METHOD("get_member_count"), &FFmpegSyncGroup::get_member_count);
+    ClassDB::bind_method(D_METHOD("play"), &FFmpegSyncGroup::play);
+    ClassDB::bind_method(D_METHOD("set_paused", "paused"), &FFmpegSyncGroup::set_paused);
+    ClassDB::bind_method(D_METHOD("is_paused"), &FFmpegSyncGroup::is_paused);
+    ClassDB::bind_method(D_METHOD("stop"), &FFmpegSyncGroup::stop);
+    ClassDB::bind_method(D_METHOD("seek", "time"), &FFmpegSyncGroup::seek);
+    ClassDB::bind_method(D_METHOD("is_playing"), &FFmpegSyncGroup::is_playing);
+    ClassDB::bind_method(D_METHOD("get_position"), &FFmpegSyncGroup::get_position);
+    ClassDB::bind_method(D_METHOD("set_max_start_wait", "seconds"), &FFmpegSyncGroup::set_max_start_wait);
+    ClassDB::bind_method(D_METHOD("get_max_start_wait"), &FFmpegSyncGroup::get_max_start_wait);
+    ClassDB::bind_method(D_METHOD("get_drift"), &FFmpegSyncGroup::get_drift);
+    ClassDB::bind_static_method("FFmpegSyncGroup", D_METHOD("set_worker_count", "count"), &FFmpegSyncGroup::set_worker_count);
+    ClassDB::bind_static_method("FFmpegSyncGroup", D_METHOD("get_worker_count"), &FFmpegSyncGroup::get_worker_count);
+    
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_start_wait", PROPERTY_HINT_RANGE, "0.0,5.0,0.05,suffix:s"), "set_max_start_wait", "get_max_start_wait");
+}
+
+void FFmpegSyncGroup::add_member(const Ref<FFmpegVideoStreamPlayback> &p_playback) {
+    if (p_playback.is_null() || std::find(members.begin(), members.end(), p_playback.ptr()) != members.end()) {
+        return;
+    }
+    if (p_playback->sync_group.is_valid()) {
+        p_playback->sync_group->remove_member(p_playback);
+    }
+    
+    // A late joiner is seeked once to the group position, later it only follows the clock
+    double current = get_position();
+    members.push_back(p_playback.ptr());
+    p_playback->join_sync_group(this, current);
+    if (playing) {
+        p_playback->play();
+        p_playback->set_paused(paused);
+    }
+}
+
+void FFmpegSyncGroup::remove_member(const Ref<FFmpegVideoStreamPlayback> &p_playback) {
+    if (p_playback.is_null()) {
+        return;
+    }
+    auto found = std::find(members.begin(), members.end(), p_playback.ptr());
+    if (found == members.end()) {
+        return;
+    }
+    
+    // The member may hold the last reference to this group
+    Ref<FFmpegSyncGroup> keep_alive(this);
+    members.erase(found);
+    p_playback->leave_sync_group();
+}
+
+void FFmpegSyncGroup::forget_member(FFmpegVideoStreamPlayback *p_playback) {
+    members.erase(std::remove(members.begin(), members.end(), p_playback), members.end());
+}
+
+void FFmpegSyncGroup::play() {
+    if (playing && !paused) {
+        return;
+    }
+    
+    bool resuming = playing && paused;
+    for (FFmpegVideoStreamPlayback *member : members) {
+        member->play();
+        member->set_paused(false);
+    }
+    
+    playing = true;
+    paused = false;
+    start_ticks = Time::get_singleton()->get_ticks_usec();
+    if (!resuming) {
+        hold_clock();
+    }
+}
+
+void FFmpegSyncGroup::set_paused(bool p_paused) {
+    if (!playing || paused == p_paused) {
+        return;
+    }
+    if (!p_paused) {
+        play();
+        return;
+    }
+    
+    position = get_position();
+    paused = true;
+    for (FFmpegVideoStreamPlayback *member : members) {
+        member->set_paused(true);
+    }
+}
+
+void FFmpegSyncGroup::stop() {
+    for (FFmpegVideoStreamPlayback *member : members) {
+        member->stop();
+        member->group_clock_reference = 0.0;
+    }
+    playing = false;
+    paused = false;
+    waiting_for_members = false;
+    position = 0.0;
+}
+
+void FFmpegSyncGroup::seek(double p_time) {
+    p_time = MAX(p_time, 0.0);
+    
+    // Every member seeks in parallel, an exact seek decodes from the keyframe
+    // before p_time and that is the slow part
+    std::vector<std::thread> seeks;
+    for (FFmpegVideoStreamPlayback *member : members) {
+        seeks.push_back(std::thread([member, p_time]() {
+            member->seek(p_time);
+        }));
+    }
+    for (std::thread &member_seek : seeks) {
+        member_seek.join();
+    }
+    
+    for (FFmpegVideoStreamPlayback *member : members) {
+        member->group_clock_reference = p_time;
+    }
+    position = p_time;
+    if (playing && !paused) {
+        hold_clock();
+    }
+}
+
+void FFmpegSyncGroup::hold_clock() {
+    waiting_for_members = true;
+    wait_start_ticks = Time::get_singleton()->get_ticks_usec();
+}
+
+bool FFmpegSyncGroup::members_ready() const {
+    for (FFmpegVideoStreamPlayback *member : members) {
+        if (!member->is_frame_ready()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double FFmpegSyncGroup::get_position() {
+    if (!playing || paused) {
+        return position;
+    }
+    
+    uint64_t now = Time::get_singleton()->get_ticks_usec();
+    if (waiting_for_members) {
+        // Start the clock once every member can show its first frame, so
+        // nobody begins behind; a stuck member only delays it by max_start_wait
+        if (!members_ready() && (double)(now - wait_start_ticks) / 1000000.0 < max_start_wait) {
+            return position;
+        }
+        waiting_for_members = false;
+        start_ticks = now;
+    }
+    
+    return position + (double)(now - start_ticks) / 1000000.0;
+}
+
+void FFmpegSyncGroup::set_max_start_wait(double p_seconds) {
+    max_start_wait = MAX(p_seconds, 0.0);
+}
+
+double FFmpegSyncGroup::get_drift() const {
+    double earliest = 0.0;
+    double latest = 0.0;
+    bool any = false;
+    for (FFmpegVideoStreamPlayback *member : members) {
+        if (!member->frame_cache_valid) {
+            continue;
+        }
+        double shown = member->last_frame_time;
+        earliest = any ? MIN(earliest, shown) : shown;
+        latest = any ? MAX(latest, shown) : shown;
+        any = true;
+    }
+    return latest - earliest;
+}
+
+void FFmpegSyncGroup::set_worker_count(int p_count) {
+    FFmpegDecodePool::get_singleton()->set_worker_count(p_count);
+}
+
+int FFmpegSyncGroup::get_worker_count() {
+    return FFmpegDecodePool::get_singleton()->get_worker_count();
+}
@@ -0,0 +1,69 @@
+#ifndef FFMPEG_SYNC_GROUP_H
+#define FFMPEG_SYNC_GROUP_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+class FFmpegVideoStreamPlayback;
+
+// Several playbacks driven by one master clock, e.g. the projectors of a
+// video wall. Members take their position from the group clock instead of
+// their own frame delta; lateness is absorbed by dropping or holding frames,
+// never by seeking. Member decoding runs on the shared FFmpegDecodePool.
+class FFmpegSyncGroup : public RefCounted {
+    GDCLASS(FFmpegSyncGroup, RefCounted)
+
+private:
+    std::vector<FFmpegVideoStreamPlayback *> members; // Members keep the group alive, not the reverse
+    bool playing;
+    bool paused;
+    double position; // Clock value at start_ticks
+    uint64_t start_ticks;
+    bool waiting_for_members;
+    uint64_t wait_start_ticks;
+    double max_start_wait;
+    
+    bool members_ready() const;
+    void hold_clock();
+
+protected:
+    static void _bind_methods();
+
+public:
+    FFmpegSyncGroup();
+    ~FFmpegSyncGroup();
+    
+    void add_member(const Ref<FFmpegVideoStreamPlayback> &p_playback);
+    void remove_member(const Ref<FFmpegVideoStreamPlayback> &p_playback);
+    void forget_member(FFmpegVideoStreamPlayback *p_playback); // From the member's destructor
+    int get_member_count() const { return (int)members.size(); }
+    
+    // Group transport: every member is started, paused or positioned together
+    void play();
+    void set_paused(bool p_paused);
+    bool is_paused() const { return paused; }
+    void stop();
+    void seek(double p_time);
+    bool is_playing() const { return playing; }
+    
+    // The master clock. After play() or seek() it waits up to max_start_wait
+    // seconds for every member to have its first frame decoded.
+    double get_position();
+    void set_max_start_wait(double p_seconds);
+    double get_max_start_wait() const { return max_start_wait; }
+    
+    // Spread in seconds between the frames currently shown by the members
+    double get_drift() const;
+    
+    // Size of the decode worker pool shared by all groups
+    static void set_worker_count(int p_count); // 0 = one per CPU core
+    static int get_worker_count();
+};
+
+}
+
+#endif // FFMPEG_SYNC_GROUP_H
@@ -1,62 +1,258 @@
 #include "ffmpeg_video_stream.h"
-#include "../decoder/ffmpeg_decoder.h"
+#include "ffmpeg_sync_group.h"
+#include "../decoder/ffmpeg_decoder_pool.h"
+#include "../decoder/ffmpeg_frame_cache.h"
 
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/object.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <cmath>
+
 using namespace godot;
 
 // FFmpegVideoStreamPlayback implementation
 
-FFmpegVideoStreamPlayback::FFmpegVideoStreamPlayback() {
+FFmpegVideoStreamPlayback::FFmpegVideoStreamPlayback() : pool_client(this), gop_cache_client(this) {
     playback_position = 0.0;
     is_playing = false;
     is_paused = false;
+    awaiting_decoder = false;
     mix_rate = 48000.0;
     last_frame_time = -1.0;
     frame_cache_valid = false;
     
+    threaded_decoding = false;
+    frame_queue_size = 4;
+    decode_thread_running = false;
+    end_of_stream = false;
+    decode_pooled = false;
+    latest_queued_time = -1.0;
+    group_clock_reference = 0.0;
+    
+    has_pending_frame = false;
+    resync_threshold = 1.0;
+    dropped_frames = 0;
+    repeated_frames = 0;
+    resync_count = 0;
+    resync_pending = false;
+    clock_position = 0.0;
+    
+    catch_up_enabled = true;
+    catch_up_threshold = 0.1;
+    catch_up_recovery = 0.02;
+    catching_up = false;
+    skipped_conversions = 0;
+    catch_up_count = 0;
+    skipped_decodes_base = 0;
+    skipped_decodes_carry = 0;
+    
+    stats_enabled = false;
+    texture_allocations = 0;
+    crop_keep_full_frame = false;
+    
+    looping = false;
+    loop_start = 0.0;
+    loop_end = 0.0;
+    loop_preroll_time = 0.5;
+    loop_count = 0;
+    preroll_ready = false;
+    preroll_succeeded = false;
+    preroll_target = 0.0;
+    preroll_thread_count = 0;
+    clip_index = 0;
+    restart_playlist = false;
+    
+    playback_speed = 1.0;
+    scrub_resolution_scale = 1.0;
+    scrubbing = false;
+    step_pending = false;
+    step_target = 0.0;
+    step_direction = 1;
+    gop_cache.set_listener(&gop_cache_client);
+    
     texture = Ref<ImageTexture>(memnew(ImageTexture));
+    plane_textures[0] = texture;
+    for (int i = 1; i < FFmpegDecoder::MAX_PLANES; i++) {
+        plane_textures[i] = Ref<ImageTexture>(memnew(ImageTexture));
+    }
 }
 
 FFmpegVideoStreamPlayback::~FFmpegVideoStreamPlayback() {
     stop();
+    discard_preroll();
+    gop_cache.close();
+    // Opened decoders go back to the pool for the next playback of this file
+    FFmpegDecoderPool::give_back(decoder);
+    FFmpegDecoderPool::give_back(preroll_decoder);
+    if (sync_group.is_valid()) {
+        sync_group->forget_member(this);
+    }
 }
 
 void FFmpegVideoStreamPlayback::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_decoder", "decoder"), &FFmpegVideoStreamPlayback::set_decoder);
+    
+    ClassDB::bind_method(D_METHOD("set_threaded_decoding", "enabled"), &FFmpegVideoStreamPlayback::set_threaded_decoding);
+    ClassDB::bind_method(D_METHOD("get_threaded_decoding"), &FFmpegVideoStreamPlayback::get_threaded_decoding);
+    ClassDB::bind_method(D_METHOD("set_frame_queue_size", "size"), &FFmpegVideoStreamPlayback::set_frame_queue_size);
+    ClassDB::bind_method(D_METHOD("get_frame_queue_size"), &FFmpegVideoStreamPlayback::get_frame_queue_size);
+    ClassDB::bind_method(D_METHOD("get_queued_frame_count"), &FFmpegVideoStreamPlayback::get_queued_frame_count);
+    ClassDB::bind_method(D_METHOD("set_resync_threshold", "seconds"), &FFmpegVideoStreamPlayback::set_resync_threshold);
+    ClassDB::bind_method(D_METHOD("get_resync_threshold"), &FFmpegVideoStreamPlayback::get_resync_threshold);
+    ClassDB::bind_method(D_METHOD("get_dropped_frames"), &FFmpegVideoStreamPlayback::get_dropped_frames);
+    ClassDB::bind_method(D_METHOD("get_repeated_frames"), &FFmpegVideoStreamPlayback::get_repeated_frames);
+    ClassDB::bind_method(D_METHOD("get_resync_count"), &FFmpegVideoStreamPlayback::get_resync_count);
+    ClassDB::bind_method(D_METHOD("reset_frame_statistics"), &FFmpegVideoStreamPlayback::reset_frame_statistics);
+    ClassDB::bind_method(D_METHOD("set_stats_enabled", "enabled"), &FFmpegVideoStreamPlayback::set_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_stats_enabled"), &FFmpegVideoStreamPlayback::get_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_stats"), &FFmpegVideoStreamPlayback::get_stats);
+    ClassDB::bind_method(D_METHOD("set_catch_up_enabled", "enabled"), &FFmpegVideoStreamPlayback::set_catch_up_enabled);
+    ClassDB::bind_method(D_METHOD("get_catch_up_enabled"), &FFmpegVideoStreamPlayback::get_catch_up_enabled);
+    ClassDB::bind_method(D_METHOD("set_catch_up_threshold", "seconds"), &FFmpegVideoStreamPlayback::set_catch_up_threshold);
+    ClassDB::bind_method(D_METHOD("get_catch_up_threshold"), &FFmpegVideoStreamPlayback::get_catch_up_threshold);
+    ClassDB::bind_method(D_METHOD("set_catch_up_recovery", "seconds"), &FFmpegVideoStreamPlayback::set_catch_up_recovery);
+    ClassDB::bind_method(D_METHOD("get_catch_up_recovery"), &FFmpegVideoStreamPlayback::get_catch_up_recovery);
+    ClassDB::bind_method(D_METHOD("is_catching_up"), &FFmpegVideoStreamPlayback::is_catching_up);
+    ClassDB::bind_method(D_METHOD("get_catch_up_count"), &FFmpegVideoStreamPlayback::get_catch_up_count);
+    ClassDB::bind_method(D_METHOD("get_skipped_conversions"), &FFmpegVideoStreamPlayback::get_skipped_conversions);
+    ClassDB::bind_method(D_METHOD("get_skipped_decodes"), &FFmpegVideoStreamPlayback::get_skipped_decodes);
+    ClassDB::bind_method(D_METHOD("set_looping", "enabled"), &FFmpegVideoStreamPlayback::set_looping);
+    ClassDB::bind_method(D_METHOD("get_looping"), &FFmpegVideoStreamPlayback::get_looping);
+    ClassDB::bind_method(D_METHOD("set_loop_start", "seconds"), &FFmpegVideoStreamPlayback::set_loop_start);
+    ClassDB::bind_method(D_METHOD("get_loop_start"), &FFmpegVideoStreamPlayback::get_loop_start);
+    ClassDB::bind_method(D_METHOD("set_loop_end", "seconds"), &FFmpegVideoStreamPlayback::set_loop_end);
+    ClassDB::bind_method(D_METHOD("get_loop_end"), &FFmpegVideoStreamPlayback::get_loop_end);
+    ClassDB::bind_method(D_METHOD("set_loop_preroll_time", "seconds"), &FFmpegVideoStreamPlayback::set_loop_preroll_time);
+    ClassDB::bind_method(D_METHOD("get_loop_preroll_time"), &FFmpegVideoStreamPlayback::get_loop_preroll_time);
+    ClassDB::bind_method(D_METHOD("get_loop_count"), &FFmpegVideoStreamPlayback::get_loop_count);
+    ClassDB::bind_method(D_METHOD("is_loop_prerolled"), &FFmpegVideoStreamPlayback::is_loop_prerolled);
+    ClassDB::bind_method(D_METHOD("set_playlist", "files"), &FFmpegVideoStreamPlayback::set_playlist);
+    ClassDB::bind_method(D_METHOD("get_playlist"), &FFmpegVideoStreamPlayback::get_playlist);
+    ClassDB::bind_method(D_METHOD("get_clip_index"), &FFmpegVideoStreamPlayback::get_clip_index);
+    ClassDB::bind_method(D_METHOD("get_texture_allocations"), &FFmpegVideoStreamPlayback::get_texture_allocations);
+    ClassDB::bind_method(D_METHOD("get_sync_group"), &FFmpegVideoStreamPlayback::get_sync_group);
+    ClassDB::bind_method(D_METHOD("add_crop_output", "name", "region"), &FFmpegVideoStreamPlayback::add_crop_output);
+    ClassDB::bind_method(D_METHOD("remove_crop_output", "name"), &FFmpegVideoStreamPlayback::remove_crop_output);
+    ClassDB::bind_method(D_METHOD("clear_crop_outputs"), &FFmpegVideoStreamPlayback::clear_crop_outputs);
+    ClassDB::bind_method(D_METHOD("has_crop_output", "name"), &FFmpegVideoStreamPlayback::has_crop_output);
+    ClassDB::bind_method(D_METHOD("get_crop_output_region", "name"), &FFmpegVideoStreamPlayback::get_crop_output_region);
+    ClassDB::bind_method(D_METHOD("get_crop_texture", "name"), &FFmpegVideoStreamPlayback::get_crop_texture);
+    ClassDB::bind_method(D_METHOD("get_crop_output_names"), &FFmpegVideoStreamPlayback::get_crop_output_names);
+    ClassDB::bind_method(D_METHOD("set_crop_keep_full_frame", "enabled"), &FFmpegVideoStreamPlayback::set_crop_keep_full_frame);
+    ClassDB::bind_method(D_METHOD("get_crop_keep_full_frame"), &FFmpegVideoStreamPlayback::get_crop_keep_full_frame);
+    ClassDB::bind_method(D_METHOD("set_playback_speed", "speed"), &FFmpegVideoStreamPlayback::set_playback_speed);
+    ClassDB::bind_method(D_METHOD("get_playback_speed"), &FFmpegVideoStreamPlayback::get_playback_speed);
+    ClassDB::bind_method(D_METHOD("step_frames", "count"), &FFmpegVideoStreamPlayback::step_frames);
+    ClassDB::bind_method(D_METHOD("_present_step"), &FFmpegVideoStreamPlayback::_present_step);
+    ClassDB::bind_method(D_METHOD("is_scrubbing"), &FFmpegVideoStreamPlayback::is_scrubbing);
+    ClassDB::bind_method(D_METHOD("set_scrub_cache_budget", "bytes"), &FFmpegVideoStreamPlayback::set_scrub_cache_budget);
+    ClassDB::bind_method(D_METHOD("get_scrub_cache_budget"), &FFmpegVideoStreamPlayback::get_scrub_cache_budget);
+    ClassDB::bind_method(D_METHOD("set_scrub_resolution_scale", "scale"), &FFmpegVideoStreamPlayback::set_scrub_resolution_scale);
+    ClassDB::bind_method(D_METHOD("get_scrub_resolution_scale"), &FFmpegVideoStreamPlayback::get_scrub_resolution_scale);
+    ClassDB::bind_method(D_METHOD("get_plane_texture", "plane"), &FFmpegVideoStreamPlayback::get_plane_texture);
+    ClassDB::bind_method(D_METHOD("set_yuv_material", "material"), &FFmpegVideoStreamPlayback::set_yuv_material);
+    ClassDB::bind_method(D_METHOD("get_yuv_material"), &FFmpegVideoStreamPlayback::get_yuv_material);
+    
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "threaded_decoding"), "set_threaded_decoding", "get_threaded_decoding");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "frame_queue_size", PROPERTY_HINT_RANGE, "1,64,1"), "set_frame_queue_size", "get_frame_queue_size");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "stats_enabled"), "set_stats_enabled", "get_stats_enabled");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "catch_up_enabled"), "set_catch_up_enabled", "get_catch_up_enabled");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "catch_up_threshold", PROPERTY_HINT_RANGE, "0.0,2.0,0.01,suffix:s"), "set_catch_up_threshold", "get_catch_up_threshold");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "catch_up_recovery", PROPERTY_HINT_RANGE, "0.0,2.0,0.01,suffix:s"), "set_catch_up_recovery", "get_catch_up_recovery");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "resync_threshold", PROPERTY_HINT_RANGE, "0.1,10.0,0.1,suffix:s"), "set_resync_threshold", "get_resync_threshold");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "looping"), "set_looping", "get_looping");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_start", PROPERTY_HINT_RANGE, "0.0,3600.0,0.001,or_greater,suffix:s"), "set_loop_start", "get_loop_start");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_end", PROPERTY_HINT_RANGE, "0.0,3600.0,0.001,or_greater,suffix:s"), "set_loop_end", "get_loop_end");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_preroll_time", PROPERTY_HINT_RANGE, "0.05,5.0,0.05,suffix:s"), "set_loop_preroll_time", "get_loop_preroll_time");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "crop_keep_full_frame"), "set_crop_keep_full_frame", "get_crop_keep_full_frame");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "playback_speed", PROPERTY_HINT_RANGE, "-8.0,8.0,0.1"), "set_playback_speed", "get_playback_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "scrub_cache_budget", PROPERTY_HINT_RANGE, "0,17179869184,1048576,or_greater,suffix:B"), "set_scrub_cache_budget", "get_scrub_cache_budget");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "scrub_resolution_scale", PROPERTY_HINT_RANGE, "0.1,1.0,0.05"), "set_scrub_resolution_scale", "get_scrub_resolution_scale");
+    ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "yuv_material", PROPERTY_HINT_RESOURCE_TYPE, "ShaderMaterial"), "set_yuv_material", "get_yuv_material");
+    ADD_PROPERTY(PropertyInfo(Variant::PACKED_STRING_ARRAY, "playlist"), "set_playlist", "get_playlist");
+    
+    ADD_SIGNAL(MethodInfo("clip_changed", PropertyInfo(Variant::INT, "index")));
 }
 
 void FFmpegVideoStreamPlayback::set_decoder(Ref<FFmpegDecoder> p_decoder) {
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    discard_preroll();
+    gop_cache.close();
+    scrubbing = false;
+    FFmpegDecoderPool::give_back(preroll_decoder);
+    preroll_decoder.unref();
+    if (decoder != p_decoder) {
+        FFmpegDecoderPool::give_back(decoder);
+    }
+    
     decoder = p_decoder;
+    awaiting_decoder = false;
+    if (decoder.is_valid()) {
+        decoder->set_stats_enabled(stats_enabled);
+    }
+    apply_crop_outputs();
     if (decoder.is_valid() && decoder->is_file_open()) {
-        // Initialize texture with proper size
-        int width = decoder->get_width();
-        int height = decoder->get_height();
+        // Initialize texture with the size frames will be converted to
+        Vector2i output_size = decoder->get_output_size();
+        int width = output_size.x;
+        int height = output_size.y;
         
         if (width > 0 && height > 0) {
-            // Create initial black frame
+            // Create initial black frame in the decoder's RGBA8 output format, so
+            // the first decoded frame already updates the texture in place
             PackedByteArray initial_data;
-            int channels = decoder->get_has_alpha() ? 4 : 3;
-            initial_data.resize(width * height * channels);
+            initial_data.resize(width * height * 4);
             memset(initial_data.ptrw(), 0, initial_data.size());
             
-            Image::Format format = decoder->get_has_alpha() ? Image::FORMAT_RGBA8 : Image::FORMAT_RGB8;
-            Ref<Image> initial_image = Image::create_from_data(width, height, false, format, initial_data);
+            Ref<Image> initial_image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, initial_data);
+            if (!decoder->get_has_alpha()) {
+                initial_image->fill(Color(0, 0, 0, 1));
+            }
             texture->set_image(initial_image);
         }
     }
 }
 
 void FFmpegVideoStreamPlayback::stop() {
+    stop_decode_thread();
+    flush_frame_queue();
+    
+    // Decoding runs ahead of the clock, rewind so the next play() starts at the top
+    bool decoder_advanced = frame_cache_valid || has_pending_frame;
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    leave_catch_up();
+    scrubbing = false; // The cached GOPs stay for the next scrub
+    step_pending = false;
+    clock_position = 0.0;
+    if (decoder_advanced && decoder.is_valid()) {
+        decoder->seek_to_time(0.0);
+    }
+    if (clip_index > 0) {
+        // The pre-rolled clip is not the one play() starts with
+        discard_preroll();
+        restart_playlist = true;
+    }
+    
     is_playing = false;
     is_paused = false;
     playback_position = 0.0;
     frame_cache_valid = false;
     last_frame_time = -1.0;
+    resync_pending = false;
 }
 
 void FFmpegVideoStreamPlayback::play() {
+    if (awaiting_decoder) {
+        // The clock starts with take_preloaded_decoder()
+        is_playing = true;
+        is_paused = false;
+        return;
+    }
     if (!decoder.is_valid() || !decoder->is_file_open()) {
         UtilityFunctions::print("Error: No valid decoder for playback");
         return;
@@ -64,6 +260,10 @@ void FFmpegVideoStreamPlayback::play() {
     
     is_playing = true;
     is_paused = false;
+    
+    if (threaded_decoding) {
+        start_decode_thread();
+    }
 }
 
 bool FFmpegVideoStreamPlayback::is_playing() const {
@@ -92,11 +292,35 @@ double FFmpegVideoStreamPlayback::get_playback_position() const {
 void FFmpegVideoStreamPlayback::seek(double p_time) {
     if (!decoder.is_valid()) return;
     
-    if (decoder->seek_to_time(p_time)) {
+    if (scrubbing) {
+        // Served from the GOP cache, the playback decoder is resynced when forward playback resumes
+        step_pending = false;
+        playback_position = MAX(p_time, 0.0);
+        clock_position = playback_position;
+        last_frame_time = -1.0;
+        return;
+    }
+    
+    // The decoder must not be touched while the worker owns it
+    bool was_threaded = decode_thread_running;
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    
+    leave_catch_up();
+    
+    // Exact seek: frames before p_time are dropped by the decoder without conversion
+    if (decoder->seek_to_time(p_time, true)) {
         playback_position = p_time;
+        clock_position = p_time;
         frame_cache_valid = false;
         last_frame_time = -1.0;
     }
+    
+    if (was_threaded) {
+        start_decode_thread();
+    }
 }
 
 void FFmpegVideoStreamPlayback::set_audio_track(int p_idx) {
@@ -112,97 +336,1581 @@ void FFmpegVideoStreamPlayback::update(double p_delta) {
         return;
     }
     
-    playback_position += p_delta;
+    if (sync_group.is_valid()) {
+        // Members advance by the group clock, not by their own frame delta
+        double group_position = sync_group->get_position();
+        playback_position += group_position - group_clock_reference;
+        group_clock_reference = group_position;
+    } else {
+        playback_position += p_delta * playback_speed;
+    }
+    clock_position = playback_position;
     
-    // Check if we need a new frame based on video framerate
-    double frame_rate = decoder->get_frame_rate();
-    if (frame_rate <= 0) return;
+    if (playback_speed < 0 && sync_group.is_null()) {
+        update_reverse(p_delta);
+        return;
+    }
+    leave_scrub_mode();
+    
+    // The next clip of a playlist is pre-rolled for the whole clip, the
+    // switch happens when the clock passes the end of the current one
+    if (get_next_clip_index() >= 0) {
+        double duration = get_length();
+        if (restart_playlist) {
+            advance_clip(playback_position);
+        } else if (duration > 0 && playback_position >= duration) {
+            advance_clip(duration);
+        }
+    }
+    int next_clip = get_next_clip_index();
+    if (next_clip >= 0) {
+        start_preroll();
+    }
+    
+    double loop_end_time = looping && next_clip < 0 ? get_effective_loop_end() : 0.0;
+    if (loop_end_time > 0) {
+        if (playback_position >= loop_end_time - loop_preroll_time) {
+            start_preroll();
+        }
+        if (playback_position >= loop_end_time) {
+            wrap_loop(loop_end_time);
+        }
+    }
     
-    double frame_duration = 1.0 / frame_rate;
-    double current_frame_time = floor(playback_position / frame_duration) * frame_duration;
+    bool finished;
+    if (threaded_decoding) {
+        finished = update_threaded();
+    } else {
+        finished = update_synchronous();
+    }
     
-    // Only decode new frame if we've moved to a different frame time
-    if (!frame_cache_valid || current_frame_time != last_frame_time) {
-        // Seek to correct position if needed (for precise frame timing)
-        if (abs(current_frame_time - last_frame_time) > frame_duration * 1.5) {
-            decoder->seek_to_time(current_frame_time);
+    if (next_clip >= 0) {
+        // The file ended before its nominal duration: switch once the last
+        // frame has been up for its frame duration
+        if (finished) {
+            double frame_rate = decoder->get_frame_rate();
+            double clip_end = frame_rate > 0 && last_frame_time >= 0 ? last_frame_time + 1.0 / frame_rate : playback_position;
+            if (playback_position >= clip_end) {
+                advance_clip(clip_end);
+            }
         }
-        
-        Ref<Image> frame = decoder->decode_next_frame();
-        if (frame.is_valid()) {
-            texture->set_image(frame);
-            cached_frame = frame;
-            frame_cache_valid = true;
-            last_frame_time = current_frame_time;
+        return;
+    }
+    
+    if (looping) {
+        // Without a known duration the end of the stream is the loop point.
+        // Otherwise the last frame stays up until the clock reaches the loop end.
+        if (finished && loop_end_time <= 0) {
+            wrap_loop(playback_position);
         }
+        return;
     }
     
     // Check for end of video
     double duration = get_length();
-    if (duration > 0 && playback_position >= duration) {
+    if ((duration > 0 && playback_position >= duration) || finished) {
         stop();
     }
 }
 
-int FFmpegVideoStreamPlayback::get_channels() const {
-    // TODO: Return actual audio channel count
-    return 2;
+double FFmpegVideoStreamPlayback::get_frame_duration() const {
+    double frame_rate = decoder.is_valid() ? decoder->get_frame_rate() : 0.0;
+    return frame_rate > 0 ? 1.0 / frame_rate : 1.0 / 30.0;
 }
 
-int FFmpegVideoStreamPlayback::get_mix_rate() const {
-    return mix_rate;
+bool FFmpegVideoStreamPlayback::enter_scrub_mode() {
+    if (scrubbing) {
+        return true;
+    }
+    if (!decoder.is_valid() || !decoder->is_file_open() || !gop_cache.open(decoder, scrub_resolution_scale)) {
+        return false;
+    }
+    
+    // Frames decoded ahead for forward playback are of no use backwards
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    leave_catch_up();
+    scrubbing = true;
+    return true;
 }
 
-// FFmpegVideoStream implementation
+void FFmpegVideoStreamPlayback::leave_scrub_mode() {
+    if (!scrubbing) {
+        return;
+    }
+    scrubbing = false;
+    step_pending = false;
+    
+    // Forward decoding resumes at the frame on screen. As after seek(), the
+    // next frame is scheduled from scratch: the last one shown came from the
+    // GOP cache, at a lower resolution when scrub_resolution_scale < 1.
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    leave_catch_up();
+    decoder->seek_to_time(playback_position, true);
+    frame_cache_valid = false;
+    last_frame_time = -1.0;
+    resync_pending = false;
+}
 
-FFmpegVideoStream::FFmpegVideoStream() {
-    decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+void FFmpegVideoStreamPlayback::update_reverse(double p_delta) {
+    if (!enter_scrub_mode()) {
+        return;
+    }
+    step_pending = false; // Reverse playback moves the playhead itself
+    
+    // Backwards the loop wraps from its start to its end, without a loop the clip ends at its start
+    double loop_end_time = looping ? get_effective_loop_end() : 0.0;
+    double start = looping ? CLAMP(loop_start, 0.0, loop_end_time) : 0.0;
+    bool reached_start = false;
+    if (playback_position < start) {
+        if (loop_end_time > start) {
+            playback_position = loop_end_time - fmod(start - playback_position, loop_end_time - start);
+            loop_count++;
+        } else {
+            playback_position = start;
+            reached_start = true;
+        }
+        clock_position = playback_position;
+    }
+    
+    // Only about one frame per update reaches the screen, so at speed the
+    // GOPs are decoded sparsely. Powers of two keep sparse segments reusable.
+    int stride = 1;
+    double frames_per_update = -playback_speed * p_delta / get_frame_duration();
+    while (stride * 2 <= frames_per_update) {
+        stride *= 2;
+    }
+    
+    FFmpegDecoder::DecodedFrame frame;
+    if (gop_cache.find_frame(playback_position, -1, stride, frame)) {
+        if (!frame_cache_valid || frame.time != last_frame_time) {
+            present_frame(frame);
+            last_frame_time = frame.time;
+        }
+    } else if (frame_cache_valid) {
+        // The GOP is still being decoded, the frame on screen stays up
+        repeated_frames++;
+        decoder->get_stats_recorder()->add(FFmpegStats::COUNTER_FRAMES_REPEATED);
+    }
+    gop_cache.prefetch(playback_position, -1, stride);
+    
+    if (reached_start) {
+        stop();
+    }
 }
 
-FFmpegVideoStream::~FFmpegVideoStream() {
-    if (decoder.is_valid()) {
-        decoder->close();
+void FFmpegVideoStreamPlayback::step_frames(int p_count) {
+    if (p_count == 0 || !enter_scrub_mode()) {
+        return;
+    }
+    
+    // Steps taken while the GOP is still being decoded add up
+    double frame_duration = get_frame_duration();
+    double current = frame_cache_valid && last_frame_time >= 0 ? last_frame_time : playback_position;
+    if (step_pending) {
+        current = step_target;
+    }
+    double target = current + p_count * frame_duration;
+    double length = get_length();
+    if (length > 0) {
+        target = MIN(target, length - frame_duration);
     }
+    
+    // Never waits for the GOP: on a miss the frame is shown once it is decoded
+    step_target = MAX(target, 0.0);
+    step_direction = p_count < 0 ? -1 : 1;
+    step_pending = true;
+    _present_step();
+    gop_cache.prefetch(step_pending ? step_target : playback_position, step_direction, 1);
 }
 
-void FFmpegVideoStream::_bind_methods() {
-    ClassDB::bind_method(D_METHOD("set_file", "file"), &FFmpegVideoStream::set_file);
-    ClassDB::bind_method(D_METHOD("get_file"), &FFmpegVideoStream::get_file);
+void FFmpegVideoStreamPlayback::_present_step() {
+    if (!step_pending || !scrubbing) {
+        step_pending = false;
+        return;
+    }
     
-    ADD_PROPERTY(PropertyInfo(Variant::STRING, "file", PROPERTY_HINT_FILE, "*.mp4,*.avi,*.mkv,*.mov,*.webm"), "set_file", "get_file");
+    // Half a frame of margin, frame times are not exact multiples of the duration
+    FFmpegDecoder::DecodedFrame frame;
+    if (!gop_cache.find_frame(step_target + get_frame_duration() * 0.5, step_direction, 1, frame)) {
+        return; // Queued, gop_cache_updated() calls again
+    }
+    step_pending = false;
+    present_frame(frame);
+    last_frame_time = frame.time;
+    playback_position = frame.time;
+    clock_position = playback_position;
 }
 
-void FFmpegVideoStream::set_file(const String &p_file) {
-    file_path = p_file;
+void FFmpegVideoStreamPlayback::GopCacheClient::gop_cache_updated() {
+    if (playback->step_pending) {
+        playback->call_deferred("_present_step");
+    }
+}
+
+void FFmpegVideoStreamPlayback::set_playback_speed(double p_speed) {
+    double magnitude = CLAMP(std::abs(p_speed), 0.1, 8.0);
+    playback_speed = p_speed < 0 ? -magnitude : magnitude;
+}
+
+void FFmpegVideoStreamPlayback::set_scrub_cache_budget(int64_t p_bytes) {
+    gop_cache.set_budget(p_bytes);
+}
+
+void FFmpegVideoStreamPlayback::set_scrub_resolution_scale(double p_scale) {
+    // Applied when scrubbing starts, the cache is rebuilt at the new size
+    scrub_resolution_scale = CLAMP(p_scale, 0.1, 1.0);
+}
+
+double FFmpegVideoStreamPlayback::get_effective_loop_end() const {
+    double duration = get_length();
+    if (loop_end > 0 && (duration <= 0 || loop_end < duration)) {
+        return loop_end;
+    }
+    return duration;
+}
+
+void FFmpegVideoStreamPlayback::start_preroll() {
+    if (preroll_thread.joinable() || preroll_ready) {
+        return;
+    }
     
-    if (decoder.is_valid()) {
-        decoder->close();
-        if (!p_file.is_empty()) {
-            if (!decoder->open_file(p_file)) {
-                UtilityFunctions::print("Error: Failed to open video file: ", p_file);
-            }
+    int next_clip = get_next_clip_index();
+    preroll_path = next_clip >= 0 ? playlist[next_clip] : String();
+    preroll_target = next_clip >= 0 ? 0.0 : loop_start;
+    preroll_succeeded = false;
+    if (preroll_thread_count == 0) {
+        // A loop's second decoder runs beside the playing one for the whole
+        // pre-roll, with half the threads the pair stays near one decoder's
+        // share. Taken once, the decoders swap roles at every wrap.
+        preroll_thread_count = MAX(decoder->get_effective_thread_count() / 2, 1);
+    }
+    preroll_thread = std::thread(&FFmpegVideoStreamPlayback::preroll_thread_func, this);
+}
+
+void FFmpegVideoStreamPlayback::preroll_thread_func() {
+    // The second decoder is opened once and then ping-pongs with the first.
+    // A decoder left on another file, e.g. the clip before, goes back to the pool.
+    String source_path = preroll_path.is_empty() ? decoder->get_source_path() : preroll_path;
+    if (preroll_decoder.is_valid() && (!preroll_decoder->is_file_open() || preroll_decoder->get_source_path() != source_path)) {
+        FFmpegDecoderPool::give_back(preroll_decoder);
+        preroll_decoder.unref();
+    }
+    if (preroll_decoder.is_null() && !preroll_path.is_empty()) {
+        preroll_decoder = open_clip_decoder(preroll_path);
+    } else if (preroll_decoder.is_null()) {
+        preroll_decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+        if (!decoder->get_reuse_key().is_empty()) {
+            // Pooled under its own thread count
+            preroll_decoder->set_reuse_key(FFmpegDecoder::make_reuse_key(source_path, decoder->get_use_hardware_acceleration(), preroll_thread_count,
+                                                                         decoder->get_thread_type(), decoder->get_io_buffer_size(),
+                                                                         decoder->get_read_ahead_size(), decoder->get_lowres()));
         }
     }
+    
+    // Open, seek and decode the first frame, including the cold GOP decode
+    // up to it, while the current decoder is still playing
+    bool ok = preroll_decoder.is_valid() &&
+            (preroll_decoder->is_file_open() || preroll_decoder->open_same_source(decoder, preroll_thread_count));
+    ok = ok && preroll_decoder->seek_to_time(preroll_target, true);
+    ok = ok && preroll_decoder->decode_frame(preroll_frame);
+    preroll_succeeded = ok;
+    preroll_ready = true;
 }
 
-String FFmpegVideoStream::get_file() const {
-    return file_path;
+void FFmpegVideoStreamPlayback::finish_preroll() {
+    if (preroll_thread.joinable()) {
+        preroll_thread.join();
+    }
 }
 
-Ref<VideoStreamPlayback> FFmpegVideoStream::_instantiate_playback() {
-    Ref<FFmpegVideoStreamPlayback> playback = Ref<FFmpegVideoStreamPlayback>(memnew(FFmpegVideoStreamPlayback));
+void FFmpegVideoStreamPlayback::discard_preroll() {
+    finish_preroll();
+    preroll_frame = FFmpegDecoder::DecodedFrame();
+    preroll_ready = false;
+    preroll_succeeded = false;
+}
+
+void FFmpegVideoStreamPlayback::wrap_loop(double p_loop_end) {
+    double start = CLAMP(loop_start, 0.0, p_loop_end);
+    double overshoot = playback_position - p_loop_end;
+    if (overshoot < 0 || overshoot >= p_loop_end - start) {
+        overshoot = 0.0;
+    }
+    loop_count++;
     
-    if (decoder.is_valid() && decoder->is_file_open()) {
-        // Create a new decoder instance for this playback
-        Ref<FFmpegDecoder> playback_decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
-        playback_decoder->set_use_hardware_acceleration(decoder->get_use_hardware_acceleration());
+    // The pre-roll may still be running if the loop is short or was just
+    // enabled. Rather than wait for it on the main thread this wrap seeks,
+    // and the pre-roll is kept for the next one.
+    start_preroll();
+    if (!preroll_ready) {
+        seek(start + overshoot);
+        return;
+    }
+    finish_preroll(); // Already done, the join does not block
+    
+    if (!preroll_succeeded) {
+        // No second decoder, fall back to a seek and a cold decode
+        discard_preroll();
+        seek(start + overshoot);
+        return;
+    }
+    
+    swap_in_preroll(start + overshoot);
+}
+
+void FFmpegVideoStreamPlayback::swap_in_preroll(double p_position) {
+    bool was_threaded = decode_thread_running;
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    leave_catch_up();
+    
+    Ref<FFmpegDecoder> previous = decoder;
+    skipped_decodes_carry += previous->get_discarded_frames() - skipped_decodes_base;
+    decoder = preroll_decoder;
+    preroll_decoder = previous;
+    skipped_decodes_base = decoder->get_discarded_frames();
+    
+    // Textures of the same size are updated in place, so the switch costs no allocation
+    playback_position = p_position;
+    clock_position = playback_position;
+    present_frame(preroll_frame);
+    last_frame_time = preroll_frame.time;
+    preroll_frame = FFmpegDecoder::DecodedFrame();
+    preroll_ready = false;
+    
+    if (was_threaded) {
+        start_decode_thread();
+    }
+}
+
+int FFmpegVideoStreamPlayback::get_next_clip_index() const {
+    if (playlist.size() < 2) {
+        return -1;
+    }
+    if (restart_playlist) {
+        return 0;
+    }
+    if (clip_index + 1 < playlist.size()) {
+        return clip_index + 1;
+    }
+    return looping ? 0 : -1;
+}
+
+Ref<FFmpegDecoder> FFmpegVideoStreamPlayback::open_clip_decoder(const String &p_path) {
+    // Same settings as the current clip, taken from the pool if this clip played before
+    String reuse_key = FFmpegDecoder::make_reuse_key(p_path, decoder->get_use_hardware_acceleration(), decoder->get_thread_count(),
+                                                     decoder->get_thread_type(), decoder->get_io_buffer_size(), decoder->get_read_ahead_size(),
+                                                     decoder->get_lowres());
+    Ref<FFmpegDecoder> clip_decoder = FFmpegDecoderPool::checkout(reuse_key);
+    bool reused = clip_decoder.is_valid();
+    if (!reused) {
+        clip_decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+    }
+    clip_decoder->copy_settings(decoder);
+    clip_decoder->set_reuse_key(reuse_key);
+    
+    if (!reused && !clip_decoder->open_file(p_path)) {
+        return Ref<FFmpegDecoder>();
+    }
+    return clip_decoder;
+}
+
+void FFmpegVideoStreamPlayback::advance_clip(double p_clip_end) {
+    int next_clip = get_next_clip_index();
+    double overshoot = MAX(playback_position - p_clip_end, 0.0);
+    
+    // The pre-roll was started with the current clip and is normally done.
+    // Otherwise the last frame stays up and the next update tries again,
+    // only a restarted playlist has nothing else to show and waits.
+    start_preroll();
+    if (!preroll_ready && !restart_playlist) {
+        return;
+    }
+    finish_preroll();
+    
+    if (!preroll_succeeded) {
+        // Skip the clip, the next update pre-rolls the one after it
+        UtilityFunctions::print("Error: Failed to open playlist clip: ", preroll_path);
+        discard_preroll();
+        clip_index = next_clip;
+        restart_playlist = false;
+        return;
+    }
+    
+    if (next_clip == 0 && !restart_playlist) {
+        loop_count++;
+    }
+    clip_index = next_clip;
+    restart_playlist = false;
+    swap_in_preroll(overshoot);
+    emit_signal("clip_changed", clip_index);
+}
+
+void FFmpegVideoStreamPlayback::set_playlist(const PackedStringArray &p_files) {
+    // A pre-rolled clip may no longer be the next one
+    discard_preroll();
+    playlist = p_files;
+    restart_playlist = false;
+    
+    // The current clip keeps playing, at its position in the new list
+    int index = decoder.is_valid() ? playlist.find(decoder->get_source_path()) : -1;
+    clip_index = MAX(index, 0);
+}
+
+void FFmpegVideoStreamPlayback::set_looping(bool p_enabled) {
+    looping = p_enabled;
+    if (!looping) {
+        discard_preroll();
+    }
+}
+
+void FFmpegVideoStreamPlayback::set_loop_start(double p_seconds) {
+    p_seconds = MAX(p_seconds, 0.0);
+    if (p_seconds != loop_start) {
+        // A pre-roll for the old start point is of no use
+        discard_preroll();
+        loop_start = p_seconds;
+    }
+}
+
+void FFmpegVideoStreamPlayback::set_loop_end(double p_seconds) {
+    loop_end = MAX(p_seconds, 0.0);
+}
+
+void FFmpegVideoStreamPlayback::set_loop_preroll_time(double p_seconds) {
+    loop_preroll_time = MAX(p_seconds, 0.05);
+}
+
+bool FFmpegVideoStreamPlayback::is_discontinuity(double p_latest_time) const {
+    // Until the resynced decoder delivers, the frame on screen still predates
+    // the seek and would trigger another one
+    if (!frame_cache_valid || resync_pending) {
+        return false;
+    }
+    
+    // The clock went back before the frame on screen
+    double frame_rate = decoder->get_frame_rate();
+    double frame_duration = frame_rate > 0 ? 1.0 / frame_rate : 0.0;
+    if (playback_position < last_frame_time - frame_duration * 0.5) {
+        return true;
+    }
+    
+    // The clock jumped further ahead than decoding forward can reasonably catch up
+    return p_latest_time >= 0 && playback_position - p_latest_time > resync_threshold;
+}
+
+void FFmpegVideoStreamPlayback::resync(double p_time) {
+    bool was_threaded = decode_thread_running;
+    stop_decode_thread();
+    flush_frame_queue();
+    pending_frame = FFmpegDecoder::DecodedFrame();
+    has_pending_frame = false;
+    leave_catch_up();
+    
+    decoder->seek_to_time(p_time, true);
+    resync_count++;
+    resync_pending = true;
+    
+    if (was_threaded) {
+        start_decode_thread();
+    }
+}
+
+bool FFmpegVideoStreamPlayback::update_synchronous() {
+    double latest_time = has_pending_frame ? pending_frame.time : last_frame_time;
+    if (is_discontinuity(latest_time)) {
+        resync(playback_position);
+    }
+    
+    // Present the newest decoded frame whose pts is at or before the clock.
+    // A frame that is not due yet stays pending for a later update.
+    // Frames are decoded without conversion; only one that can still be on
+    // screen is converted, the decoder holds it until then.
+    FFmpegDecoder::DecodedFrame due_frame;
+    bool has_due_frame = false;
+    while (true) {
+        if (!has_pending_frame) {
+            if (end_of_stream || !decoder->decode_frame(pending_frame, false)) {
+                end_of_stream = true;
+                break;
+            }
+            has_pending_frame = true;
+            update_catch_up(pending_frame.time);
+        }
         
-        if (playback_decoder->open_file(file_path)) {
-            playback->set_decoder(playback_decoder);
-        } else {
-            UtilityFunctions::print("Error: Failed to create playback decoder for: ", file_path);
+        if (pending_frame.time > playback_position) {
+            break;
+        }
+        
+        has_pending_frame = false;
+        if (will_be_superseded(pending_frame)) {
+            count_dropped_frame();
+            skipped_conversions++;
+            continue;
+        }
+        
+        if (has_due_frame) {
+            count_dropped_frame();
+        }
+        if (decoder->convert_held_frame(due_frame)) {
+            has_due_frame = true;
         }
     }
     
-    return playback;
-}
\ No newline at end of file
+    if (has_due_frame) {
+        present_frame(due_frame);
+        last_frame_time = due_frame.time;
+    } else {
+        count_repeated_frame();
+    }
+    
+    return end_of_stream && !has_pending_frame;
+}
+
+bool FFmpegVideoStreamPlayback::update_threaded() {
+    if (!decode_thread_running) {
+        start_decode_thread();
+    }
+    
+    // Pick the newest queued frame that is due, dropping any older ones
+    FFmpegDecoder::DecodedFrame due_frame;
+    bool has_due_frame = false;
+    bool finished = false;
+    double latest_time = last_frame_time;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        while (!frame_queue.empty() && frame_queue.front().time <= playback_position) {
+            if (has_due_frame) {
+                count_dropped_frame();
+            }
+            due_frame = frame_queue.front();
+            frame_queue.pop_front();
+            has_due_frame = true;
+        }
+        if (!frame_queue.empty()) {
+            latest_time = frame_queue.back().time;
+        } else if (has_due_frame) {
+            latest_time = due_frame.time;
+        }
+        finished = end_of_stream && frame_queue.empty();
+    }
+    
+    if (has_due_frame) {
+        queue_cv.notify_one();
+        if (decode_pooled) {
+            FFmpegDecodePool::get_singleton()->notify();
+        }
+        present_frame(due_frame);
+        last_frame_time = due_frame.time;
+    } else {
+        count_repeated_frame();
+    }
+    
+    if (!finished && is_discontinuity(latest_time)) {
+        resync(playback_position);
+    }
+    
+    return finished;
+}
+
+bool FFmpegVideoStreamPlayback::will_be_superseded(const FFmpegDecoder::DecodedFrame &p_frame) const {
+    // Once the demuxer ran out, any frame may be the last one and nothing would replace it
+    if (decoder->is_input_exhausted()) {
+        return false;
+    }
+    
+    // The next frame starts where this one ends; if that is due too, this one
+    // would be replaced before it is ever displayed. Without a duration from
+    // the container the nominal frame rate is assumed.
+    double frame_duration = p_frame.duration;
+    if (frame_duration <= 0) {
+        double frame_rate = decoder->get_frame_rate();
+        if (frame_rate <= 0) {
+            return false;
+        }
+        frame_duration = 1.0 / frame_rate;
+    }
+    return p_frame.time + frame_duration <= clock_position.load();
+}
+
+void FFmpegVideoStreamPlayback::update_catch_up(double p_decoded_time) {
+    if (!catch_up_enabled) {
+        return;
+    }
+    
+    // Runs on whichever thread drives the decoder
+    double lag = clock_position.load() - p_decoded_time;
+    if (!catching_up && lag > catch_up_threshold) {
+        catching_up = true;
+        catch_up_count++;
+        decoder->set_skip_non_reference_frames(true);
+    } else if (catching_up && lag < catch_up_recovery) {
+        catching_up = false;
+        decoder->set_skip_non_reference_frames(false);
+    }
+}
+
+void FFmpegVideoStreamPlayback::leave_catch_up() {
+    if (catching_up && decoder.is_valid()) {
+        decoder->set_skip_non_reference_frames(false);
+    }
+    catching_up = false;
+}
+
+void FFmpegVideoStreamPlayback::count_repeated_frame() {
+    // Holding a frame is only a repeat once its nominal display time is over
+    double frame_rate = decoder->get_frame_rate();
+    if (frame_cache_valid && frame_rate > 0 && playback_position >= last_frame_time + 1.0 / frame_rate) {
+        repeated_frames++;
+        decoder->get_stats_recorder()->add(FFmpegStats::COUNTER_FRAMES_REPEATED);
+    }
+}
+
+void FFmpegVideoStreamPlayback::count_dropped_frame() {
+    dropped_frames++;
+    decoder->get_stats_recorder()->add(FFmpegStats::COUNTER_FRAMES_DROPPED);
+}
+
+void FFmpegVideoStreamPlayback::set_stats_enabled(bool p_enabled) {
+    stats_enabled = p_enabled;
+    if (decoder.is_valid()) {
+        decoder->set_stats_enabled(p_enabled);
+    }
+}
+
+Dictionary FFmpegVideoStreamPlayback::get_stats() {
+    // Decoder stages plus the playback's own view of the queue and clock
+    Dictionary result = decoder.is_valid() ? decoder->get_stats() : Dictionary();
+    result["queued_frames"] = get_queued_frame_count();
+    result["skipped_conversions"] = get_skipped_conversions();
+    result["skipped_decodes"] = get_skipped_decodes();
+    result["resync_count"] = get_resync_count();
+    result["loop_count"] = get_loop_count();
+    Dictionary scrub_stats = gop_cache.get_stats();
+    Array scrub_keys = scrub_stats.keys();
+    for (int i = 0; i < scrub_keys.size(); i++) {
+        result["scrub_" + String(scrub_keys[i])] = scrub_stats[scrub_keys[i]];
+    }
+    return result;
+}
+
+void FFmpegVideoStreamPlayback::reset_frame_statistics() {
+    dropped_frames = 0;
+    repeated_frames = 0;
+    resync_count = 0;
+    skipped_conversions = 0;
+    catch_up_count = 0;
+    skipped_decodes_base = decoder.is_valid() ? decoder->get_discarded_frames() : 0;
+    skipped_decodes_carry = 0;
+    loop_count = 0;
+    if (decoder.is_valid()) {
+        decoder->reset_stats();
+    }
+}
+
+int64_t FFmpegVideoStreamPlayback::get_skipped_decodes() const {
+    if (!decoder.is_valid()) {
+        return (int64_t)skipped_decodes_carry;
+    }
+    return (int64_t)skipped_decodes_carry + decoder->get_discarded_frames() - skipped_decodes_base;
+}
+
+void FFmpegVideoStreamPlayback::set_catch_up_enabled(bool p_enabled) {
+    catch_up_enabled = p_enabled;
+}
+
+void FFmpegVideoStreamPlayback::set_catch_up_threshold(double p_seconds) {
+    catch_up_threshold = MAX(p_seconds, 0.0);
+}
+
+void FFmpegVideoStreamPlayback::set_catch_up_recovery(double p_seconds) {
+    catch_up_recovery = MAX(p_seconds, 0.0);
+}
+
+void FFmpegVideoStreamPlayback::present_frame(const FFmpegDecoder::DecodedFrame &p_frame) {
+    {
+        FFmpegStats::Scope scope(decoder->get_stats_recorder(), FFmpegStats::STAGE_TEXTURE_UPLOAD);
+        for (int i = 0; i < p_frame.plane_count; i++) {
+            upload_plane(plane_textures[i], p_frame.planes[i]);
+        }
+        for (size_t i = 0; i < p_frame.crops.size() && i < crop_outputs.size(); i++) {
+            if (p_frame.crops[i].is_valid()) {
+                upload_plane(crop_outputs[i].texture, p_frame.crops[i]);
+            }
+        }
+    }
+    frame_cache_valid = true;
+    resync_pending = false;
+    
+    if (yuv_material.is_valid() && p_frame.ycocg) {
+        bool frame_has_alpha = p_frame.plane_count == 2;
+        yuv_material->set_shader_parameter("ycocg_texture", plane_textures[0]);
+        yuv_material->set_shader_parameter("alpha_texture", frame_has_alpha ? plane_textures[1] : Ref<ImageTexture>());
+        yuv_material->set_shader_parameter("has_alpha", frame_has_alpha);
+    } else if (yuv_material.is_valid() && p_frame.plane_count > 1) {
+        bool frame_has_alpha = p_frame.plane_count == 4;
+        yuv_material->set_shader_parameter("y_texture", plane_textures[0]);
+        yuv_material->set_shader_parameter("u_texture", plane_textures[1]);
+        yuv_material->set_shader_parameter("v_texture", p_frame.interleaved_chroma ? plane_textures[1] : plane_textures[2]);
+        yuv_material->set_shader_parameter("a_texture", frame_has_alpha ? plane_textures[3] : Ref<ImageTexture>());
+        yuv_material->set_shader_parameter("interleaved_uv", p_frame.interleaved_chroma);
+        yuv_material->set_shader_parameter("has_alpha", frame_has_alpha);
+        yuv_material->set_shader_parameter("full_range", p_frame.color_range == 1);
+        yuv_material->set_shader_parameter("color_space", p_frame.color_space);
+    }
+}
+
+void FFmpegVideoStreamPlayback::present_preloaded_frame(const FFmpegDecoder::DecodedFrame &p_frame) {
+    present_frame(p_frame);
+    last_frame_time = p_frame.time;
+}
+
+void FFmpegVideoStreamPlayback::take_preloaded_decoder(Ref<FFmpegDecoder> p_decoder, const FFmpegDecoder::DecodedFrame &p_frame) {
+    set_decoder(p_decoder);
+    if (decoder.is_null()) {
+        return;
+    }
+    if (p_frame.time >= 0) {
+        present_preloaded_frame(p_frame);
+    }
+    if (is_playing && threaded_decoding) {
+        start_decode_thread();
+    }
+}
+
+void FFmpegVideoStreamPlayback::upload_plane(const Ref<ImageTexture> &p_texture, const Ref<Image> &p_image) {
+    // update() rewrites the existing GPU texture; set_image() replaces it and
+    // is only needed when the size or format changes
+    if (p_texture->get_width() == p_image->get_width() && p_texture->get_height() == p_image->get_height() &&
+        p_texture->get_format() == p_image->get_format()) {
+        p_texture->update(p_image);
+    } else {
+        p_texture->set_image(p_image);
+        texture_allocations++;
+    }
+}
+
+Ref<Texture2D> FFmpegVideoStreamPlayback::get_plane_texture(int p_plane) const {
+    if (p_plane < 0 || p_plane >= FFmpegDecoder::MAX_PLANES) {
+        return Ref<Texture2D>();
+    }
+    return plane_textures[p_plane];
+}
+
+void FFmpegVideoStreamPlayback::set_yuv_material(const Ref<ShaderMaterial> &p_material) {
+    yuv_material = p_material;
+}
+
+int FFmpegVideoStreamPlayback::find_crop_output(const StringName &p_name) const {
+    for (size_t i = 0; i < crop_outputs.size(); i++) {
+        if (crop_outputs[i].name == p_name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void FFmpegVideoStreamPlayback::add_crop_output(const StringName &p_name, const Rect2i &p_region) {
+    int index = find_crop_output(p_name);
+    if (index >= 0) {
+        crop_outputs[index].region = p_region;
+    } else {
+        CropOutput output;
+        output.name = p_name;
+        output.region = p_region;
+        output.texture = Ref<ImageTexture>(memnew(ImageTexture));
+        crop_outputs.push_back(output);
+    }
+    apply_crop_outputs();
+}
+
+void FFmpegVideoStreamPlayback::remove_crop_output(const StringName &p_name) {
+    int index = find_crop_output(p_name);
+    if (index < 0) {
+        return;
+    }
+    crop_outputs.erase(crop_outputs.begin() + index);
+    apply_crop_outputs();
+}
+
+void FFmpegVideoStreamPlayback::clear_crop_outputs() {
+    if (crop_outputs.empty()) {
+        return;
+    }
+    crop_outputs.clear();
+    apply_crop_outputs();
+}
+
+Rect2i FFmpegVideoStreamPlayback::get_crop_output_region(const StringName &p_name) const {
+    int index = find_crop_output(p_name);
+    return index >= 0 ? crop_outputs[index].region : Rect2i();
+}
+
+Ref<Texture2D> FFmpegVideoStreamPlayback::get_crop_texture(const StringName &p_name) const {
+    int index = find_crop_output(p_name);
+    return index >= 0 ? crop_outputs[index].texture : Ref<Texture2D>();
+}
+
+PackedStringArray FFmpegVideoStreamPlayback::get_crop_output_names() const {
+    PackedStringArray names;
+    for (const CropOutput &output : crop_outputs) {
+        names.push_back(output.name);
+    }
+    return names;
+}
+
+void FFmpegVideoStreamPlayback::set_crop_keep_full_frame(bool p_enabled) {
+    if (crop_keep_full_frame == p_enabled) {
+        return;
+    }
+    crop_keep_full_frame = p_enabled;
+    apply_crop_outputs();
+}
+
+void FFmpegVideoStreamPlayback::apply_crop_outputs() {
+    if (!decoder.is_valid()) {
+        return;
+    }
+    
+    // The regions are read while converting, so neither the worker nor the
+    // pre-roll may run while they change
+    bool was_running = decode_thread_running;
+    stop_decode_thread();
+    discard_preroll();
+    // Cached GOPs were converted with the old regions
+    leave_scrub_mode();
+    gop_cache.close();
+    
+    TypedArray<Rect2i> regions;
+    for (const CropOutput &output : crop_outputs) {
+        regions.push_back(output.region);
+    }
+    decoder->set_crop_regions(regions);
+    decoder->set_convert_full_frame(crop_keep_full_frame);
+    if (preroll_decoder.is_valid()) {
+        preroll_decoder->set_crop_regions(regions);
+        preroll_decoder->set_convert_full_frame(crop_keep_full_frame);
+    }
+    reserve_pool_images(4);
+    
+    if (was_running) {
+        // Queued frames were converted with the old regions, decode them again
+        flush_frame_queue();
+        decoder->seek_to_time(playback_position, true);
+        start_decode_thread();
+    }
+}
+
+void FFmpegVideoStreamPlayback::reserve_pool_images(int p_frames) {
+    // Planes and crop regions of one frame each take a pooled image
+    int images_per_frame = (int)crop_outputs.size();
+    if (crop_outputs.empty() || crop_keep_full_frame) {
+        switch (decoder->get_output_mode()) {
+            case FFmpegDecoder::OUTPUT_MODE_YUV_PLANES:
+                images_per_frame += FFmpegDecoder::MAX_PLANES;
+                break;
+            case FFmpegDecoder::OUTPUT_MODE_COMPRESSED:
+                images_per_frame += FFmpegHapUnpacker::MAX_TEXTURES;
+                break;
+            default:
+                images_per_frame += 1;
+                break;
+        }
+    }
+    int required_pool_size = p_frames * images_per_frame;
+    if (decoder->get_frame_pool_size() < required_pool_size) {
+        decoder->set_frame_pool_size(required_pool_size);
+    }
+}
+
+void FFmpegVideoStreamPlayback::start_decode_thread() {
+    if (decode_thread_running || !decoder.is_valid() || !decoder->is_file_open()) {
+        return;
+    }
+    
+    // Keep enough pooled images for a full queue plus the frame on screen,
+    // the decoder's last frame and the one being converted, otherwise the
+    // pool would start allocating
+    reserve_pool_images(frame_queue_size + 4);
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        end_of_stream = false;
+    }
+    decode_thread_running = true;
+    if (sync_group.is_valid()) {
+        decode_pooled = true;
+        FFmpegDecodePool::get_singleton()->add_client(&pool_client);
+    } else {
+        decode_thread = std::thread(&FFmpegVideoStreamPlayback::decode_thread_loop, this);
+    }
+}
+
+void FFmpegVideoStreamPlayback::stop_decode_thread() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        decode_thread_running = false;
+    }
+    queue_cv.notify_all();
+    
+    if (decode_pooled) {
+        FFmpegDecodePool::get_singleton()->remove_client(&pool_client);
+        decode_pooled = false;
+    }
+    if (decode_thread.joinable()) {
+        decode_thread.join();
+    }
+}
+
+void FFmpegVideoStreamPlayback::flush_frame_queue() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    frame_queue.clear();
+    end_of_stream = false;
+    latest_queued_time = -1.0;
+}
+
+void FFmpegVideoStreamPlayback::decode_thread_loop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] {
+                return !decode_thread_running || (!end_of_stream && (int)frame_queue.size() < frame_queue_size);
+            });
+            if (!decode_thread_running) {
+                break;
+            }
+        }
+        
+        decode_one_frame();
+    }
+}
+
+void FFmpegVideoStreamPlayback::decode_one_frame() {
+    // Demux, decode and convert outside the lock so update() never waits on the codec.
+    // Frames that will be dropped on arrival are not converted at all.
+    FFmpegDecoder::DecodedFrame decoded;
+    bool decoded_ok = decoder->decode_frame(decoded, false);
+    if (decoded_ok) {
+        update_catch_up(decoded.time);
+        if (will_be_superseded(decoded)) {
+            skipped_conversions++;
+            return;
+        }
+        decoded_ok = decoder->convert_held_frame(decoded);
+    }
+    
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (!decode_thread_running) {
+        return;
+    }
+    if (!decoded_ok) {
+        end_of_stream = true;
+        return;
+    }
+    latest_queued_time = decoded.time;
+    frame_queue.push_back(decoded);
+}
+
+bool FFmpegVideoStreamPlayback::DecodePoolClient::pool_has_work() {
+    std::lock_guard<std::mutex> lock(playback->queue_mutex);
+    return playback->decode_thread_running && !playback->end_of_stream &&
+           (int)playback->frame_queue.size() < playback->frame_queue_size;
+}
+
+double FFmpegVideoStreamPlayback::DecodePoolClient::pool_get_lead() {
+    std::lock_guard<std::mutex> lock(playback->queue_mutex);
+    return playback->latest_queued_time - playback->clock_position.load();
+}
+
+void FFmpegVideoStreamPlayback::DecodePoolClient::pool_decode_step() {
+    playback->decode_one_frame();
+}
+
+void FFmpegVideoStreamPlayback::join_sync_group(FFmpegSyncGroup *p_group, double p_position) {
+    stop_decode_thread();
+    sync_group = Ref<FFmpegSyncGroup>(p_group);
+    
+    // Members always decode ahead, on the group's worker pool
+    set_threaded_decoding(true);
+    if (decoder.is_valid() && decoder->is_file_open()) {
+        seek(p_position);
+    }
+    group_clock_reference = p_position;
+}
+
+void FFmpegVideoStreamPlayback::leave_sync_group() {
+    // The next update() restarts decoding on a thread of its own
+    stop_decode_thread();
+    sync_group.unref();
+}
+
+bool FFmpegVideoStreamPlayback::is_frame_ready() {
+    if (!threaded_decoding) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return !frame_queue.empty() || end_of_stream;
+}
+
+void FFmpegVideoStreamPlayback::set_threaded_decoding(bool p_enabled) {
+    if (threaded_decoding == p_enabled) {
+        return;
+    }
+    
+    if (!p_enabled) {
+        // The decoder is ahead of the clock by the queued frames, put it back on the clock
+        bool was_running = decode_thread_running;
+        stop_decode_thread();
+        flush_frame_queue();
+        if (was_running && decoder.is_valid()) {
+            decoder->seek_to_time(playback_position, true);
+        }
+    } else {
+        // Hand the frame decoded ahead back to the decoder position
+        if (has_pending_frame && decoder.is_valid()) {
+            decoder->seek_to_time(pending_frame.time, true);
+        }
+        pending_frame = FFmpegDecoder::DecodedFrame();
+        has_pending_frame = false;
+    }
+    
+    threaded_decoding = p_enabled;
+    
+    if (threaded_decoding && is_playing) {
+        start_decode_thread();
+    }
+}
+
+void FFmpegVideoStreamPlayback::set_frame_queue_size(int p_size) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        frame_queue_size = MAX(1, p_size);
+    }
+    queue_cv.notify_all();
+    if (decode_pooled) {
+        FFmpegDecodePool::get_singleton()->notify();
+    }
+}
+
+void FFmpegVideoStreamPlayback::set_resync_threshold(double p_seconds) {
+    resync_threshold = MAX(p_seconds, 0.1);
+}
+
+int FFmpegVideoStreamPlayback::get_queued_frame_count() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return (int)frame_queue.size();
+}
+
+int FFmpegVideoStreamPlayback::get_channels() const {
+    // TODO: Return actual audio channel count
+    return 2;
+}
+
+int FFmpegVideoStreamPlayback::get_mix_rate() const {
+    return mix_rate;
+}
+
+// FFmpegVideoStream implementation
+
+FFmpegVideoStream::FFmpegVideoStream() {
+    decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+    threaded_decoding = false;
+    frame_queue_size = 4;
+    output_mode = FFmpegDecoder::OUTPUT_MODE_RGB;
+    decoder_thread_count = 0;
+    decoder_thread_type = FFmpegDecoder::THREAD_TYPE_AUTO;
+    io_buffer_size = 64 * 1024;
+    read_ahead_size = 0;
+    output_width = 0;
+    output_height = 0;
+    scaling_algorithm = FFmpegDecoder::SCALING_BILINEAR;
+    lowres = 0;
+    filter_threads = 0;
+    looping = false;
+    loop_start = 0.0;
+    loop_end = 0.0;
+    stats_enabled = false;
+    crop_keep_full_frame = false;
+    playback_speed = 1.0;
+    scrub_cache_budget = 256 * 1024 * 1024;
+    scrub_resolution_scale = 1.0;
+    last_playback_id = 0;
+    preload_ready = false;
+    preload_succeeded = false;
+    preload_generation = 0;
+    preload_playback_id = 0;
+}
+
+FFmpegVideoStream::~FFmpegVideoStream() {
+    wait_for_preload();
+    if (decoder.is_valid()) {
+        decoder->close();
+    }
+}
+
+void FFmpegVideoStream::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_file", "file"), &FFmpegVideoStream::set_file);
+    ClassDB::bind_method(D_METHOD("get_file"), &FFmpegVideoStream::get_file);
+    ClassDB::bind_method(D_METHOD("preload_async"), &FFmpegVideoStream::preload_async);
+    ClassDB::bind_method(D_METHOD("cue", "file"), &FFmpegVideoStream::cue);
+    ClassDB::bind_method(D_METHOD("is_preloaded"), &FFmpegVideoStream::is_preloaded);
+    ClassDB::bind_method(D_METHOD("_finish_preload", "generation"), &FFmpegVideoStream::_finish_preload);
+    ClassDB::bind_method(D_METHOD("set_threaded_decoding", "enabled"), &FFmpegVideoStream::set_threaded_decoding);
+    ClassDB::bind_method(D_METHOD("get_threaded_decoding"), &FFmpegVideoStream::get_threaded_decoding);
+    ClassDB::bind_method(D_METHOD("set_frame_queue_size", "size"), &FFmpegVideoStream::set_frame_queue_size);
+    ClassDB::bind_method(D_METHOD("get_frame_queue_size"), &FFmpegVideoStream::get_frame_queue_size);
+    ClassDB::bind_method(D_METHOD("set_output_mode", "mode"), &FFmpegVideoStream::set_output_mode);
+    ClassDB::bind_method(D_METHOD("get_output_mode"), &FFmpegVideoStream::get_output_mode);
+    ClassDB::bind_method(D_METHOD("set_decoder_thread_count", "count"), &FFmpegVideoStream::set_decoder_thread_count);
+    ClassDB::bind_method(D_METHOD("get_decoder_thread_count"), &FFmpegVideoStream::get_decoder_thread_count);
+    ClassDB::bind_method(D_METHOD("set_decoder_thread_type", "type"), &FFmpegVideoStream::set_decoder_thread_type);
+    ClassDB::bind_method(D_METHOD("get_decoder_thread_type"), &FFmpegVideoStream::get_decoder_thread_type);
+    ClassDB::bind_method(D_METHOD("set_io_buffer_size", "size"), &FFmpegVideoStream::set_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("get_io_buffer_size"), &FFmpegVideoStream::get_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("set_read_ahead_size", "size"), &FFmpegVideoStream::set_read_ahead_size);
+    ClassDB::bind_method(D_METHOD("get_read_ahead_size"), &FFmpegVideoStream::get_read_ahead_size);
+    ClassDB::bind_method(D_METHOD("set_output_width", "width"), &FFmpegVideoStream::set_output_width);
+    ClassDB::bind_method(D_METHOD("get_output_width"), &FFmpegVideoStream::get_output_width);
+    ClassDB::bind_method(D_METHOD("set_output_height", "height"), &FFmpegVideoStream::set_output_height);
+    ClassDB::bind_method(D_METHOD("get_output_height"), &FFmpegVideoStream::get_output_height);
+    ClassDB::bind_method(D_METHOD("set_scaling_algorithm", "algorithm"), &FFmpegVideoStream::set_scaling_algorithm);
+    ClassDB::bind_method(D_METHOD("get_scaling_algorithm"), &FFmpegVideoStream::get_scaling_algorithm);
+    ClassDB::bind_method(D_METHOD("set_lowres", "lowres"), &FFmpegVideoStream::set_lowres);
+    ClassDB::bind_method(D_METHOD("get_lowres"), &FFmpegVideoStream::get_lowres);
+    ClassDB::bind_method(D_METHOD("set_video_filter", "filter"), &FFmpegVideoStream::set_video_filter);
+    ClassDB::bind_method(D_METHOD("get_video_filter"), &FFmpegVideoStream::get_video_filter);
+    ClassDB::bind_method(D_METHOD("set_filter_threads", "threads"), &FFmpegVideoStream::set_filter_threads);
+    ClassDB::bind_method(D_METHOD("get_filter_threads"), &FFmpegVideoStream::get_filter_threads);
+    ClassDB::bind_method(D_METHOD("set_looping", "enabled"), &FFmpegVideoStream::set_looping);
+    ClassDB::bind_method(D_METHOD("get_looping"), &FFmpegVideoStream::get_looping);
+    ClassDB::bind_method(D_METHOD("set_loop_start", "seconds"), &FFmpegVideoStream::set_loop_start);
+    ClassDB::bind_method(D_METHOD("get_loop_start"), &FFmpegVideoStream::get_loop_start);
+    ClassDB::bind_method(D_METHOD("set_loop_end", "seconds"), &FFmpegVideoStream::set_loop_end);
+    ClassDB::bind_method(D_METHOD("get_loop_end"), &FFmpegVideoStream::get_loop_end);
+    ClassDB::bind_method(D_METHOD("set_stats_enabled", "enabled"), &FFmpegVideoStream::set_stats_enabled);
+    ClassDB::bind_method(D_METHOD("get_stats_enabled"), &FFmpegVideoStream::get_stats_enabled);
+    ClassDB::bind_method(D_METHOD("set_crop_outputs", "outputs"), &FFmpegVideoStream::set_crop_outputs);
+    ClassDB::bind_method(D_METHOD("get_crop_outputs"), &FFmpegVideoStream::get_crop_outputs);
+    ClassDB::bind_method(D_METHOD("set_crop_keep_full_frame", "enabled"), &FFmpegVideoStream::set_crop_keep_full_frame);
+    ClassDB::bind_method(D_METHOD("get_crop_keep_full_frame"), &FFmpegVideoStream::get_crop_keep_full_frame);
+    ClassDB::bind_method(D_METHOD("set_playback_speed", "speed"), &FFmpegVideoStream::set_playback_speed);
+    ClassDB::bind_method(D_METHOD("get_playback_speed"), &FFmpegVideoStream::get_playback_speed);
+    ClassDB::bind_method(D_METHOD("set_scrub_cache_budget", "bytes"), &FFmpegVideoStream::set_scrub_cache_budget);
+    ClassDB::bind_method(D_METHOD("get_scrub_cache_budget"), &FFmpegVideoStream::get_scrub_cache_budget);
+    ClassDB::bind_method(D_METHOD("set_scrub_resolution_scale", "scale"), &FFmpegVideoStream::set_scrub_resolution_scale);
+    ClassDB::bind_method(D_METHOD("get_scrub_resolution_scale"), &FFmpegVideoStream::get_scrub_resolution_scale);
+    ClassDB::bind_method(D_METHOD("get_playback"), &FFmpegVideoStream::get_playback);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("set_decoder_pool_size", "size"), &FFmpegVideoStream::set_decoder_pool_size);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("get_decoder_pool_size"), &FFmpegVideoStream::get_decoder_pool_size);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("get_pooled_decoder_count"), &FFmpegVideoStream::get_pooled_decoder_count);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("clear_decoder_pool"), &FFmpegVideoStream::clear_decoder_pool);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("set_frame_cache_budget", "bytes"), &FFmpegVideoStream::set_frame_cache_budget);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("get_frame_cache_budget"), &FFmpegVideoStream::get_frame_cache_budget);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("get_frame_cache_stats"), &FFmpegVideoStream::get_frame_cache_stats);
+    ClassDB::bind_static_method("FFmpegVideoStream", D_METHOD("clear_frame_cache"), &FFmpegVideoStream::clear_frame_cache);
+    
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "file", PROPERTY_HINT_FILE, "*.mp4,*.avi,*.mkv,*.mov,*.webm"), "set_file", "get_file");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "threaded_decoding"), "set_threaded_decoding", "get_threaded_decoding");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "frame_queue_size", PROPERTY_HINT_RANGE, "1,64,1"), "set_frame_queue_size", "get_frame_queue_size");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_mode", PROPERTY_HINT_ENUM, "RGB,YUV Planes,Compressed"), "set_output_mode", "get_output_mode");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "decoder_thread_count", PROPERTY_HINT_RANGE, "0,64,1"), "set_decoder_thread_count", "get_decoder_thread_count");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "decoder_thread_type", PROPERTY_HINT_ENUM, "Auto,Frame,Slice"), "set_decoder_thread_type", "get_decoder_thread_type");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "io_buffer_size", PROPERTY_HINT_RANGE, "4096,16777216,4096"), "set_io_buffer_size", "get_io_buffer_size");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "read_ahead_size", PROPERTY_HINT_RANGE, "0,536870912,1048576,suffix:B"), "set_read_ahead_size", "get_read_ahead_size");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_width", PROPERTY_HINT_RANGE, "0,8192,1,suffix:px"), "set_output_width", "get_output_width");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "output_height", PROPERTY_HINT_RANGE, "0,8192,1,suffix:px"), "set_output_height", "get_output_height");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "scaling_algorithm", PROPERTY_HINT_ENUM, "Fast Bilinear,Bilinear,Bicubic,Area,Lanczos,Point"), "set_scaling_algorithm", "get_scaling_algorithm");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "lowres", PROPERTY_HINT_ENUM, "Full,Half,Quarter,Eighth"), "set_lowres", "get_lowres");
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "video_filter"), "set_video_filter", "get_video_filter");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "filter_threads", PROPERTY_HINT_RANGE, "0,64,1"), "set_filter_threads", "get_filter_threads");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "looping"), "set_looping", "get_looping");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_start", PROPERTY_HINT_RANGE, "0.0,3600.0,0.001,or_greater,suffix:s"), "set_loop_start", "get_loop_start");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "loop_end", PROPERTY_HINT_RANGE, "0.0,3600.0,0.001,or_greater,suffix:s"), "set_loop_end", "get_loop_end");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "stats_enabled"), "set_stats_enabled", "get_stats_enabled");
+    ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "crop_outputs"), "set_crop_outputs", "get_crop_outputs");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "crop_keep_full_frame"), "set_crop_keep_full_frame", "get_crop_keep_full_frame");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "playback_speed", PROPERTY_HINT_RANGE, "-8.0,8.0,0.1"), "set_playback_speed", "get_playback_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "scrub_cache_budget", PROPERTY_HINT_RANGE, "0,17179869184,1048576,or_greater,suffix:B"), "set_scrub_cache_budget", "get_scrub_cache_budget");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "scrub_resolution_scale", PROPERTY_HINT_RANGE, "0.1,1.0,0.05"), "set_scrub_resolution_scale", "get_scrub_resolution_scale");
+    
+    ADD_SIGNAL(MethodInfo("preloaded", PropertyInfo(Variant::BOOL, "success")));
+}
+
+void FFmpegVideoStream::set_file(const String &p_file) {
+    // The preload worker uses the decoder
+    wait_for_preload();
+    file_path = p_file;
+    
+    if (decoder.is_valid()) {
+        decoder->close();
+        if (!p_file.is_empty()) {
+            if (!decoder->open_file(p_file)) {
+                UtilityFunctions::print("Error: Failed to open video file: ", p_file);
+            }
+        }
+    }
+}
+
+String FFmpegVideoStream::get_file() const {
+    return file_path;
+}
+
+void FFmpegVideoStream::preload_async() {
+    wait_for_preload();
+    preload_decoder.unref();
+    preload_frame = FFmpegDecoder::DecodedFrame();
+    preload_ready = false;
+    preload_succeeded = false;
+    if (file_path.is_empty() || decoder.is_null()) {
+        return;
+    }
+    
+    preload_settings = get_decoder_settings();
+    preload_generation++;
+    preload_thread = std::thread(&FFmpegVideoStream::preload_thread_func, this);
+}
+
+void FFmpegVideoStream::cue(const String &p_file) {
+    wait_for_preload();
+    file_path = p_file;
+    if (decoder.is_valid() && decoder->get_source_path() != p_file) {
+        decoder->close();
+    }
+    preload_async();
+}
+
+void FFmpegVideoStream::preload_thread_func() {
+    // A cued file is opened here rather than in set_file(); the open fills
+    // the probe cache, so the playback decoder below skips probing
+    bool ok = decoder->is_file_open() && decoder->get_source_path() == preload_settings.path;
+    if (!ok) {
+        ok = decoder->open_file(preload_settings.path);
+    }
+    
+    Ref<FFmpegDecoder> playback_decoder = ok ? create_playback_decoder(preload_settings) : Ref<FFmpegDecoder>();
+    ok = playback_decoder.is_valid() && playback_decoder->decode_frame(preload_frame);
+    preload_decoder = playback_decoder;
+    preload_succeeded = ok;
+    preload_ready = true;
+    
+    // The signal is emitted, and the thread joined, on the main thread
+    call_deferred("_finish_preload", preload_generation);
+}
+
+void FFmpegVideoStream::wait_for_preload() {
+    if (preload_thread.joinable()) {
+        preload_thread.join();
+    }
+    hand_over_preload();
+}
+
+void FFmpegVideoStream::hand_over_preload() {
+    if (preload_playback_id == 0 || !preload_ready) {
+        return;
+    }
+    Ref<FFmpegVideoStreamPlayback> playback = Ref<FFmpegVideoStreamPlayback>(Object::cast_to<FFmpegVideoStreamPlayback>(ObjectDB::get_instance(preload_playback_id)));
+    preload_playback_id = 0;
+    if (playback.is_null()) {
+        return; // Freed meanwhile, the preload stays for the next playback
+    }
+    
+    Ref<FFmpegDecoder> playback_decoder;
+    FFmpegDecoder::DecodedFrame first_frame;
+    if (preload_succeeded) {
+        playback_decoder = preload_decoder;
+        first_frame = preload_frame;
+    }
+    preload_decoder.unref();
+    preload_frame = FFmpegDecoder::DecodedFrame();
+    preload_ready = false;
+    
+    // The first frame failed: the playback decodes it itself, as without a preload
+    if (playback_decoder.is_null() && decoder.is_valid() && decoder->is_file_open()) {
+        playback_decoder = create_playback_decoder(preload_settings);
+    }
+    playback->take_preloaded_decoder(playback_decoder, first_frame);
+}
+
+void FFmpegVideoStream::_finish_preload(uint64_t p_generation) {
+    if (p_generation != preload_generation) {
+        return; // Replaced by a newer preload, which reports for itself
+    }
+    wait_for_preload();
+    if (!preload_succeeded) {
+        UtilityFunctions::print("Error: Failed to preload video file: ", preload_settings.path);
+    }
+    emit_signal("preloaded", preload_succeeded);
+}
+
+void FFmpegVideoStream::set_threaded_decoding(bool p_enabled) {
+    threaded_decoding = p_enabled;
+}
+
+void FFmpegVideoStream::set_frame_queue_size(int p_size) {
+    frame_queue_size = MAX(1, p_size);
+}
+
+void FFmpegVideoStream::set_output_mode(FFmpegDecoder::OutputMode p_mode) {
+    output_mode = p_mode;
+}
+
+void FFmpegVideoStream::set_decoder_thread_count(int p_count) {
+    decoder_thread_count = MAX(0, p_count);
+}
+
+void FFmpegVideoStream::set_decoder_thread_type(FFmpegDecoder::ThreadType p_type) {
+    decoder_thread_type = p_type;
+}
+
+void FFmpegVideoStream::set_io_buffer_size(int p_size) {
+    wait_for_preload();
+    io_buffer_size = CLAMP(p_size, 4096, 16 * 1024 * 1024);
+    if (decoder.is_valid()) {
+        decoder->set_io_buffer_size(io_buffer_size);
+    }
+}
+
+void FFmpegVideoStream::set_read_ahead_size(int p_size) {
+    read_ahead_size = CLAMP(p_size, 0, 512 * 1024 * 1024);
+}
+
+void FFmpegVideoStream::set_output_width(int p_width) {
+    output_width = MAX(0, p_width);
+}
+
+void FFmpegVideoStream::set_output_height(int p_height) {
+    output_height = MAX(0, p_height);
+}
+
+void FFmpegVideoStream::set_scaling_algorithm(FFmpegDecoder::ScalingAlgorithm p_algorithm) {
+    scaling_algorithm = p_algorithm;
+}
+
+void FFmpegVideoStream::set_lowres(int p_lowres) {
+    lowres = CLAMP(p_lowres, 0, 3);
+}
+
+void FFmpegVideoStream::set_video_filter(const String &p_filter) {
+    video_filter = p_filter;
+}
+
+void FFmpegVideoStream::set_filter_threads(int p_threads) {
+    filter_threads = MAX(0, p_threads);
+}
+
+void FFmpegVideoStream::set_looping(bool p_enabled) {
+    looping = p_enabled;
+}
+
+void FFmpegVideoStream::set_loop_start(double p_seconds) {
+    loop_start = MAX(p_seconds, 0.0);
+}
+
+void FFmpegVideoStream::set_loop_end(double p_seconds) {
+    loop_end = MAX(p_seconds, 0.0);
+}
+
+void FFmpegVideoStream::set_stats_enabled(bool p_enabled) {
+    stats_enabled = p_enabled;
+}
+
+void FFmpegVideoStream::set_crop_outputs(const Dictionary &p_outputs) {
+    crop_outputs = p_outputs;
+}
+
+void FFmpegVideoStream::set_crop_keep_full_frame(bool p_enabled) {
+    crop_keep_full_frame = p_enabled;
+}
+
+void FFmpegVideoStream::set_playback_speed(double p_speed) {
+    double magnitude = CLAMP(std::abs(p_speed), 0.1, 8.0);
+    playback_speed = p_speed < 0 ? -magnitude : magnitude;
+}
+
+void FFmpegVideoStream::set_scrub_cache_budget(int64_t p_bytes) {
+    scrub_cache_budget = MAX((int64_t)0, p_bytes);
+}
+
+void FFmpegVideoStream::set_scrub_resolution_scale(double p_scale) {
+    scrub_resolution_scale = CLAMP(p_scale, 0.1, 1.0);
+}
+
+void FFmpegVideoStream::set_decoder_pool_size(int p_size) {
+    FFmpegDecoderPool::set_max_size(p_size);
+}
+
+int FFmpegVideoStream::get_decoder_pool_size() {
+    return FFmpegDecoderPool::get_max_size();
+}
+
+int FFmpegVideoStream::get_pooled_decoder_count() {
+    return FFmpegDecoderPool::get_idle_count();
+}
+
+void FFmpegVideoStream::clear_decoder_pool() {
+    FFmpegDecoderPool::clear();
+}
+
+void FFmpegVideoStream::set_frame_cache_budget(int64_t p_bytes) {
+    FFmpegFrameCache::set_budget(p_bytes);
+}
+
+int64_t FFmpegVideoStream::get_frame_cache_budget() {
+    return FFmpegFrameCache::get_budget();
+}
+
+Dictionary FFmpegVideoStream::get_frame_cache_stats() {
+    return FFmpegFrameCache::get_stats();
+}
+
+void FFmpegVideoStream::clear_frame_cache() {
+    FFmpegFrameCache::clear();
+}
+
+bool FFmpegVideoStream::DecoderSettings::operator==(const DecoderSettings &p_other) const {
+    return path == p_other.path && reuse_key == p_other.reuse_key &&
+           hardware_acceleration == p_other.hardware_acceleration && output_mode == p_other.output_mode &&
+           output_width == p_other.output_width && output_height == p_other.output_height &&
+           scaling_algorithm == p_other.scaling_algorithm && video_filter == p_other.video_filter &&
+           filter_threads == p_other.filter_threads && crop_regions == p_other.crop_regions &&
+           convert_full_frame == p_other.convert_full_frame;
+}
+
+FFmpegVideoStream::DecoderSettings FFmpegVideoStream::get_decoder_settings() const {
+    DecoderSettings settings;
+    settings.path = file_path;
+    settings.hardware_acceleration = decoder.is_valid() && decoder->get_use_hardware_acceleration();
+    settings.output_mode = output_mode;
+    settings.thread_count = decoder_thread_count;
+    settings.thread_type = decoder_thread_type;
+    settings.io_buffer_size = io_buffer_size;
+    settings.read_ahead_size = read_ahead_size;
+    settings.output_width = output_width;
+    settings.output_height = output_height;
+    settings.scaling_algorithm = scaling_algorithm;
+    settings.lowres = lowres;
+    settings.video_filter = video_filter;
+    settings.filter_threads = filter_threads;
+    settings.reuse_key = FFmpegDecoder::make_reuse_key(file_path, settings.hardware_acceleration, decoder_thread_count, decoder_thread_type,
+                                                       io_buffer_size, read_ahead_size, lowres);
+    
+    // Crop regions in the playback's order, so a preloaded first frame already has them
+    Array crop_rects = crop_outputs.values();
+    for (int i = 0; i < crop_rects.size(); i++) {
+        settings.crop_regions.push_back(crop_rects[i]);
+    }
+    settings.convert_full_frame = crop_keep_full_frame;
+    return settings;
+}
+
+Ref<FFmpegVideoStreamPlayback> FFmpegVideoStream::get_playback() const {
+    if (last_playback_id == 0) {
+        return Ref<FFmpegVideoStreamPlayback>();
+    }
+    return Ref<FFmpegVideoStreamPlayback>(Object::cast_to<FFmpegVideoStreamPlayback>(ObjectDB::get_instance(last_playback_id)));
+}
+
+Ref<FFmpegDecoder> FFmpegVideoStream::create_playback_decoder(const DecoderSettings &p_settings) {
+    // Reuse an opened decoder of an earlier playback, or create a new one
+    Ref<FFmpegDecoder> playback_decoder = FFmpegDecoderPool::checkout(p_settings.reuse_key);
+    bool reused = playback_decoder.is_valid();
+    if (!reused) {
+        playback_decoder = Ref<FFmpegDecoder>(memnew(FFmpegDecoder));
+    }
+    playback_decoder->set_reuse_key(p_settings.reuse_key);
+    playback_decoder->set_use_hardware_acceleration(p_settings.hardware_acceleration);
+    playback_decoder->set_output_mode(p_settings.output_mode);
+    playback_decoder->set_thread_count(p_settings.thread_count);
+    playback_decoder->set_thread_type(p_settings.thread_type);
+    playback_decoder->set_io_buffer_size(p_settings.io_buffer_size);
+    playback_decoder->set_read_ahead_size(p_settings.read_ahead_size);
+    playback_decoder->set_output_width(p_settings.output_width);
+    playback_decoder->set_output_height(p_settings.output_height);
+    playback_decoder->set_scaling_algorithm(p_settings.scaling_algorithm);
+    playback_decoder->set_lowres(p_settings.lowres);
+    playback_decoder->set_video_filter(p_settings.video_filter);
+    playback_decoder->set_filter_threads(p_settings.filter_threads);
+    playback_decoder->set_crop_regions(p_settings.crop_regions);
+    playback_decoder->set_convert_full_frame(p_settings.convert_full_frame);
+    
+    if (!reused && !playback_decoder->open_file(p_settings.path)) {
+        return Ref<FFmpegDecoder>();
+    }
+    return playback_decoder;
+}
+
+Ref<VideoStreamPlayback> FFmpegVideoStream::_instantiate_playback() {
+    Ref<FFmpegVideoStreamPlayback> playback = Ref<FFmpegVideoStreamPlayback>(memnew(FFmpegVideoStreamPlayback));
+    
+    // Take over a finished preload opened with the current settings. One
+    // still running keeps the worker's decoder and is handed over by
+    // _finish_preload(), play() must not wait for the open.
+    DecoderSettings settings = get_decoder_settings();
+    bool preload_running = preload_thread.joinable() && !preload_ready;
+    bool preload_matches = preload_settings == settings;
+    Ref<FFmpegDecoder> playback_decoder;
+    FFmpegDecoder::DecodedFrame first_frame;
+    bool preloading = false;
+    if (preload_ready) {
+        wait_for_preload(); // Done, the join returns at once
+        if (preload_ready && preload_succeeded && preload_matches) {
+            playback_decoder = preload_decoder;
+            first_frame = preload_frame;
+        } else if (preload_ready) {
+            // Set up for settings changed since, another playback may reuse it
+            FFmpegDecoderPool::give_back(preload_decoder);
+        }
+        preload_decoder.unref();
+        preload_frame = FFmpegDecoder::DecodedFrame();
+        preload_ready = false;
+    } else if (preload_running && preload_matches) {
+        preloading = true;
+    }
+    
+    // While the worker opens the stream's decoder the file is not checked
+    // here, a new decoder opens it on its own
+    bool file_open = preload_running || (decoder.is_valid() && decoder->is_file_open());
+    if (!preloading && playback_decoder.is_null() && !file_path.is_empty() && file_open) {
+        playback_decoder = create_playback_decoder(settings);
+        if (playback_decoder.is_null()) {
+            UtilityFunctions::print("Error: Failed to create playback decoder for: ", file_path);
+        }
+    }
+    
+    if (playback_decoder.is_valid() || preloading) {
+        if (preloading) {
+            playback->await_preloaded_decoder();
+            preload_playback_id = playback->get_instance_id();
+        } else {
+            playback->set_decoder(playback_decoder);
+        }
+        playback->set_frame_queue_size(frame_queue_size);
+        playback->set_threaded_decoding(threaded_decoding);
+        playback->set_loop_start(loop_start);
+        playback->set_loop_end(loop_end);
+        playback->set_looping(looping);
+        playback->set_stats_enabled(stats_enabled);
+        playback->set_crop_keep_full_frame(crop_keep_full_frame);
+        playback->set_playback_speed(playback_speed);
+        playback->set_scrub_cache_budget(scrub_cache_budget);
+        playback->set_scrub_resolution_scale(scrub_resolution_scale);
+        Array crop_names = crop_outputs.keys();
+        for (int i = 0; i < crop_names.size(); i++) {
+            playback->add_crop_output(crop_names[i], crop_outputs[crop_names[i]]);
+        }
+        if (first_frame.time >= 0) {
+            playback->present_preloaded_frame(first_frame);
+        }
+    }
+    
+    last_playback_id = playback->get_instance_id();
+    return playback;
+}
@@ -5,27 +5,187 @@
 #include <godot_cpp/classes/video_stream_playback.hpp>
 #include <godot_cpp/classes/texture2d.hpp>
 #include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/classes/shader_material.hpp>
 #include <godot_cpp/variant/string.hpp>
 
-namespace godot {
+#include "../decoder/ffmpeg_decoder.h"
+#include "ffmpeg_decode_pool.h"
+#include "ffmpeg_gop_cache.h"
+#include "ffmpeg_sync_group.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-class FFmpegDecoder;
+namespace godot {
 
 class FFmpegVideoStreamPlayback : public VideoStreamPlayback {
     GDCLASS(FFmpegVideoStreamPlayback, VideoStreamPlayback)
+    friend class FFmpegSyncGroup;
 
 private:
     Ref<FFmpegDecoder> decoder;
     Ref<ImageTexture> texture;
+    Ref<ImageTexture> plane_textures[FFmpegDecoder::MAX_PLANES]; // [0] is texture
+    Ref<ShaderMaterial> yuv_material;
     double playback_position;
     bool is_playing;
     bool is_paused;
+    bool awaiting_decoder; // A preload still opens the decoder, play() takes effect when it arrives
     double mix_rate;
     
     // Performance optimization
     double last_frame_time;
     bool frame_cache_valid;
-    Ref<Image> cached_frame;
+    uint64_t texture_allocations;
+    
+    // Background decoding: a worker thread runs ahead of the clock and fills
+    // a bounded queue of converted frames stamped with their presentation time
+    bool threaded_decoding;
+    int frame_queue_size;
+    std::thread decode_thread;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<FFmpegDecoder::DecodedFrame> frame_queue;
+    std::atomic<bool> decode_thread_running;
+    bool end_of_stream;
+    
+    void start_decode_thread();
+    void stop_decode_thread();
+    void flush_frame_queue();
+    void decode_thread_loop();
+    void decode_one_frame();
+    
+    // In a sync group the queue is filled by the shared decode pool instead
+    // of a thread of its own
+    class DecodePoolClient : public FFmpegDecodePool::Client {
+        FFmpegVideoStreamPlayback *playback;
+    
+    public:
+        DecodePoolClient(FFmpegVideoStreamPlayback *p_playback) : playback(p_playback) {}
+        virtual bool pool_has_work() override;
+        virtual double pool_get_lead() override;
+        virtual void pool_decode_step() override;
+    };
+    DecodePoolClient pool_client;
+    bool decode_pooled;
+    double latest_queued_time; // Guarded by queue_mutex
+    Ref<FFmpegSyncGroup> sync_group;
+    double group_clock_reference; // Group clock at the last update
+    void join_sync_group(FFmpegSyncGroup *p_group, double p_position);
+    void leave_sync_group();
+    bool is_frame_ready();
+    // Presentation scheduling driven by decoded pts
+    FFmpegDecoder::DecodedFrame pending_frame; // Decoded but not due yet (synchronous mode)
+    bool has_pending_frame;
+    double resync_threshold;
+    uint64_t dropped_frames;
+    uint64_t repeated_frames;
+    uint64_t resync_count;
+    bool resync_pending; // No discontinuity checks until a frame after the resync is on screen
+    std::atomic<double> clock_position; // playback_position, readable from the decode thread
+    
+    // Catch-up: when decoding lags the clock, drop non-reference frames in
+    // the codec until it is back within catch_up_recovery
+    bool catch_up_enabled;
+    double catch_up_threshold;
+    double catch_up_recovery;
+    std::atomic<bool> catching_up;
+    std::atomic<uint64_t> skipped_conversions;
+    std::atomic<uint64_t> catch_up_count;
+    int64_t skipped_decodes_base;
+    bool stats_enabled;
+    
+    bool will_be_superseded(const FFmpegDecoder::DecodedFrame &p_frame) const;
+    void update_catch_up(double p_decoded_time);
+    void leave_catch_up();
+    
+    // Looping: shortly before the loop end a second decoder seeks to the loop
+    // start and converts its first frame, the decoders swap at the loop point
+    bool looping;
+    double loop_start;
+    double loop_end; // <= 0 plays to the end of the clip
+    double loop_preroll_time;
+    uint64_t loop_count;
+    Ref<FFmpegDecoder> preroll_decoder;
+    FFmpegDecoder::DecodedFrame preroll_frame;
+    std::thread preroll_thread;
+    std::atomic<bool> preroll_ready;
+    bool preroll_succeeded;
+    double preroll_target;
+    int preroll_thread_count; // Of a loop's second decoder, 0 until the first pre-roll
+    uint64_t skipped_decodes_carry;
+    
+    double get_effective_loop_end() const;
+    void start_preroll();
+    void finish_preroll();
+    void discard_preroll();
+    void preroll_thread_func();
+    void wrap_loop(double p_loop_end);
+    void swap_in_preroll(double p_position);
+    
+    // Playlist: the next clip is opened and pre-rolled on the same second
+    // decoder while the current one plays, and swapped in at its end
+    PackedStringArray playlist;
+    int clip_index;
+    bool restart_playlist; // Set by stop(), the next play() starts at the first clip
+    String preroll_path; // Empty pre-rolls the current source for a loop
+    int get_next_clip_index() const;
+    Ref<FFmpegDecoder> open_clip_decoder(const String &p_path);
+    void advance_clip(double p_clip_end);
+    
+    // Crop outputs: named regions of the frame, each converted and uploaded
+    // to its own texture from the single decode per frame
+    struct CropOutput {
+        StringName name;
+        Rect2i region;
+        Ref<ImageTexture> texture;
+    };
+    std::vector<CropOutput> crop_outputs;
+    bool crop_keep_full_frame;
+    int find_crop_output(const StringName &p_name) const;
+    void apply_crop_outputs();
+    void reserve_pool_images(int p_frames);
+    
+    // Scrubbing: reverse playback and frame stepping are served from whole
+    // GOPs decoded once by FFmpegGopCache, the playback decoder waits at the
+    // position it had and is put back on the clock for forward playback
+    double playback_speed;
+    double scrub_resolution_scale;
+    
+    // A jog step the GOP cache has not decoded yet is shown by _present_step(),
+    // deferred to the main thread when the cache worker has decoded a GOP
+    class GopCacheClient : public FFmpegGopCache::Listener {
+        FFmpegVideoStreamPlayback *playback;
+    
+    public:
+        GopCacheClient(FFmpegVideoStreamPlayback *p_playback) : playback(p_playback) {}
+        virtual void gop_cache_updated() override;
+    };
+    GopCacheClient gop_cache_client; // Declared before the cache, whose worker calls it
+    std::atomic<bool> step_pending;
+    double step_target;
+    int step_direction;
+    void _present_step();
+    
+    FFmpegGopCache gop_cache;
+    bool scrubbing;
+    double get_frame_duration() const;
+    bool enter_scrub_mode();
+    void leave_scrub_mode();
+    void update_reverse(double p_delta);
+    
+    bool update_synchronous();
+    bool update_threaded();
+    bool is_discontinuity(double p_latest_time) const;
+    void resync(double p_time);
+    void count_repeated_frame();
+    void count_dropped_frame();
+    void present_frame(const FFmpegDecoder::DecodedFrame &p_frame);
+    void upload_plane(const Ref<ImageTexture> &p_texture, const Ref<Image> &p_image);
     
 protected:
     static void _bind_methods();
@@ -36,6 +196,96 @@ public:
     
     void set_decoder(Ref<FFmpegDecoder> p_decoder);
     
+    // Threaded decoding
+    void set_threaded_decoding(bool p_enabled);
+    bool get_threaded_decoding() const { return threaded_decoding; }
+    void set_frame_queue_size(int p_size);
+    int get_frame_queue_size() const { return frame_queue_size; }
+    int get_queued_frame_count();
+    
+    // Scheduling
+    void set_resync_threshold(double p_seconds);
+    double get_resync_threshold() const { return resync_threshold; }
+    int64_t get_dropped_frames() const { return (int64_t)dropped_frames; }
+    int64_t get_repeated_frames() const { return (int64_t)repeated_frames; }
+    int64_t get_resync_count() const { return (int64_t)resync_count; }
+    void reset_frame_statistics();
+    
+    // Instrumentation, see FFmpegDecoder::get_stats()
+    void set_stats_enabled(bool p_enabled);
+    bool get_stats_enabled() const { return stats_enabled; }
+    Dictionary get_stats();
+    
+    // Catch-up
+    void set_catch_up_enabled(bool p_enabled);
+    bool get_catch_up_enabled() const { return catch_up_enabled; }
+    void set_catch_up_threshold(double p_seconds);
+    double get_catch_up_threshold() const { return catch_up_threshold; }
+    void set_catch_up_recovery(double p_seconds);
+    double get_catch_up_recovery() const { return catch_up_recovery; }
+    bool is_catching_up() const { return catching_up; }
+    int64_t get_catch_up_count() const { return (int64_t)catch_up_count.load(); }
+    int64_t get_skipped_conversions() const { return (int64_t)skipped_conversions.load(); }
+    int64_t get_skipped_decodes() const;
+    
+    // Looping
+    void set_looping(bool p_enabled);
+    bool get_looping() const { return looping; }
+    void set_loop_start(double p_seconds);
+    double get_loop_start() const { return loop_start; }
+    void set_loop_end(double p_seconds);
+    double get_loop_end() const { return loop_end; }
+    void set_loop_preroll_time(double p_seconds);
+    double get_loop_preroll_time() const { return loop_preroll_time; }
+    int64_t get_loop_count() const { return (int64_t)loop_count; }
+    bool is_loop_prerolled() const { return preroll_ready && preroll_succeeded; }
+    
+    // Playlist, see FFmpegPlaylistStream. Position and length are those of
+    // the current clip; a list of fewer than two clips plays as a single file.
+    void set_playlist(const PackedStringArray &p_files);
+    PackedStringArray get_playlist() const { return playlist; }
+    int get_clip_index() const { return clip_index; }
+    
+    // Textures are updated in place, this counts the times one was recreated
+    int64_t get_texture_allocations() const { return (int64_t)texture_allocations; }
+    
+    // Shows a frame decoded ahead of time (FFmpegVideoStream::preload_async()) right away
+    void present_preloaded_frame(const FFmpegDecoder::DecodedFrame &p_frame);
+    // Instantiated while the preload runs: set_decoder() follows when it is done
+    void await_preloaded_decoder() { awaiting_decoder = true; }
+    void take_preloaded_decoder(Ref<FFmpegDecoder> p_decoder, const FFmpegDecoder::DecodedFrame &p_frame);
+    
+    // Set by FFmpegSyncGroup::add_member(), the group then drives the clock
+    Ref<FFmpegSyncGroup> get_sync_group() const { return sync_group; }
+    
+    // Crop outputs, regions in video pixels. Adding an existing name moves its region.
+    void add_crop_output(const StringName &p_name, const Rect2i &p_region);
+    void remove_crop_output(const StringName &p_name);
+    void clear_crop_outputs();
+    bool has_crop_output(const StringName &p_name) const { return find_crop_output(p_name) >= 0; }
+    Rect2i get_crop_output_region(const StringName &p_name) const;
+    Ref<Texture2D> get_crop_texture(const StringName &p_name) const;
+    PackedStringArray get_crop_output_names() const;
+    void set_crop_keep_full_frame(bool p_enabled); // Also convert the whole frame for get_texture()
+    bool get_crop_keep_full_frame() const { return crop_keep_full_frame; }
+    
+    // Variable speed and scrubbing. Speeds are 0.1 to 8 either way, negative
+    // plays backwards from the GOP cache. Ignored in a sync group.
+    void set_playback_speed(double p_speed);
+    double get_playback_speed() const { return playback_speed; }
+    void step_frames(int p_count); // Jog: shows the frame p_count frames away once decoded, also while paused
+    bool is_scrubbing() const { return scrubbing; }
+    void set_scrub_cache_budget(int64_t p_bytes);
+    int64_t get_scrub_cache_budget() const { return gop_cache.get_budget(); }
+    void set_scrub_resolution_scale(double p_scale); // Cached frames at a fraction of the output size
+    double get_scrub_resolution_scale() const { return scrub_resolution_scale; }
+    
+    // YUV plane output: plane textures and yuv_to_rgb.gdshader binding, or
+    // hap_ycocg.gdshader for HAP Q in OUTPUT_MODE_COMPRESSED
+    Ref<Texture2D> get_plane_texture(int p_plane) const;
+    void set_yuv_material(const Ref<ShaderMaterial> &p_material);
+    Ref<ShaderMaterial> get_yuv_material() const { return yuv_material; }
+    
     // VideoStreamPlayback interface
     virtual void stop() override;
     virtual void play() override;
@@ -59,6 +309,72 @@ private:
     String file_path;
     Ref<FFmpegDecoder> decoder;
     
+    // Playback settings forwarded to each instantiated playback
+    bool threaded_decoding;
+    int frame_queue_size;
+    FFmpegDecoder::OutputMode output_mode;
+    int decoder_thread_count;
+    FFmpegDecoder::ThreadType decoder_thread_type;
+    int io_buffer_size;
+    int read_ahead_size;
+    int output_width;
+    int output_height;
+    FFmpegDecoder::ScalingAlgorithm scaling_algorithm;
+    int lowres;
+    String video_filter;
+    int filter_threads;
+    bool looping;
+    double loop_start;
+    double loop_end;
+    bool stats_enabled;
+    Dictionary crop_outputs;
+    bool crop_keep_full_frame;
+    double playback_speed;
+    int64_t scrub_cache_budget;
+    double scrub_resolution_scale;
+    uint64_t last_playback_id;
+    
+    // What a playback decoder is opened with. The preload worker gets a copy
+    // taken on the main thread, so the setters need not wait for it.
+    struct DecoderSettings {
+        String path;
+        String reuse_key;
+        bool hardware_acceleration = false;
+        FFmpegDecoder::OutputMode output_mode = FFmpegDecoder::OUTPUT_MODE_RGB;
+        int thread_count = 0;
+        FFmpegDecoder::ThreadType thread_type = FFmpegDecoder::THREAD_TYPE_AUTO;
+        int io_buffer_size = 0;
+        int read_ahead_size = 0;
+        int output_width = 0;
+        int output_height = 0;
+        FFmpegDecoder::ScalingAlgorithm scaling_algorithm = FFmpegDecoder::SCALING_BILINEAR;
+        int lowres = 0;
+        String video_filter;
+        int filter_threads = 0;
+        TypedArray<Rect2i> crop_regions; // In the playback's order
+        bool convert_full_frame = false;
+        
+        bool operator==(const DecoderSettings &p_other) const;
+    };
+    DecoderSettings get_decoder_settings() const;
+    static Ref<FFmpegDecoder> create_playback_decoder(const DecoderSettings &p_settings);
+    
+    // Preloading: a worker opens the playback decoder and converts the first
+    // frame, the next _instantiate_playback() takes both. A playback
+    // instantiated before the worker is done takes them when it finishes.
+    std::thread preload_thread;
+    std::atomic<bool> preload_ready;
+    bool preload_succeeded;
+    uint64_t preload_generation;
+    DecoderSettings preload_settings;
+    Ref<FFmpegDecoder> preload_decoder;
+    FFmpegDecoder::DecodedFrame preload_frame;
+    uint64_t preload_playback_id;
+    void preload_thread_func();
+    void wait_for_preload();
+    void hand_over_preload();
+    void _finish_preload(uint64_t p_generation);
+    
 protected:
     static void _bind_methods();
 
@@ -69,6 +385,72 @@ public:
     void set_file(const String &p_file);
     String get_file() const;
     
+    // Open and decode the first frame on a worker thread, emits "preloaded".
+    // cue() also defers opening the file itself to the worker.
+    void preload_async();
+    void cue(const String &p_file);
+    bool is_preloaded() const { return preload_ready && preload_succeeded; }
+    
+    void set_threaded_decoding(bool p_enabled);
+    bool get_threaded_decoding() const { return threaded_decoding; }
+    void set_frame_queue_size(int p_size);
+    int get_frame_queue_size() const { return frame_queue_size; }
+    void set_output_mode(FFmpegDecoder::OutputMode p_mode);
+    FFmpegDecoder::OutputMode get_output_mode() const { return output_mode; }
+    void set_decoder_thread_count(int p_count);
+    int get_decoder_thread_count() const { return decoder_thread_count; }
+    void set_decoder_thread_type(FFmpegDecoder::ThreadType p_type);
+    FFmpegDecoder::ThreadType get_decoder_thread_type() const { return decoder_thread_type; }
+    void set_io_buffer_size(int p_size);
+    int get_io_buffer_size() const { return io_buffer_size; }
+    void set_read_ahead_size(int p_size);
+    int get_read_ahead_size() const { return read_ahead_size; }
+    void set_output_width(int p_width);
+    int get_output_width() const { return output_width; }
+    void set_output_height(int p_height);
+    int get_output_height() const { return output_height; }
+    void set_scaling_algorithm(FFmpegDecoder::ScalingAlgorithm p_algorithm);
+    FFmpegDecoder::ScalingAlgorithm get_scaling_algorithm() const { return scaling_algorithm; }
+    void set_lowres(int p_lowres);
+    int get_lowres() const { return lowres; }
+    void set_video_filter(const String &p_filter);
+    String get_video_filter() const { return video_filter; }
+    void set_filter_threads(int p_threads);
+    int get_filter_threads() const { return filter_threads; }
+    void set_looping(bool p_enabled);
+    bool get_looping() const { return looping; }
+    void set_loop_start(double p_seconds);
+    double get_loop_start() const { return loop_start; }
+    void set_loop_end(double p_seconds);
+    double get_loop_end() const { return loop_end; }
+    void set_stats_enabled(bool p_enabled);
+    bool get_stats_enabled() const { return stats_enabled; }
+    void set_crop_outputs(const Dictionary &p_outputs); // { name: Rect2i }
+    Dictionary get_crop_outputs() const { return crop_outputs; }
+    void set_crop_keep_full_frame(bool p_enabled);
+    bool get_crop_keep_full_frame() const { return crop_keep_full_frame; }
+    void set_playback_speed(double p_speed);
+    double get_playback_speed() const { return playback_speed; }
+    void set_scrub_cache_budget(int64_t p_bytes);
+    int64_t get_scrub_cache_budget() const { return scrub_cache_budget; }
+    void set_scrub_resolution_scale(double p_scale);
+    double get_scrub_resolution_scale() const { return scrub_resolution_scale; }
+    
+    // Opened decoders kept for the next playback of the same file
+    static void set_decoder_pool_size(int p_size);
+    static int get_decoder_pool_size();
+    static int get_pooled_decoder_count();
+    static void clear_decoder_pool();
+    
+    // Converted frames shared by all playbacks, see FFmpegFrameCache
+    static void set_frame_cache_budget(int64_t p_bytes); // 0 = off, the default
+    static int64_t get_frame_cache_budget();
+    static Dictionary get_frame_cache_stats();
+    static void clear_frame_cache();
+    
+    // Most recently instantiated playback, for access to its plane textures
+    Ref<FFmpegVideoStreamPlayback> get_playback() const;
+    
     // VideoStream interface
     virtual Ref<VideoStreamPlayback> _instantiate_playback() override;
 };